@@ -0,0 +1,651 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define STB_VORBIS_HEADER_ONLY
+#include <stb_vorbis.c>
+
+#include "audio.hpp"
+#include "mixer.hpp"
+#include "music.hpp"
+#include "resample.hpp"
+#include "ring.hpp"
+#include "sfx.hpp"
+#include "stream.hpp"
+#include "util.hpp"
+#include "wav-out.hpp"
+
+/**
+ * Seconds of audio mixed per mix and resample measurement
+ */
+#define BENCH_SECS 20
+
+/**
+ * Seconds of audio run through the pipeline
+ */
+#define PIPE_SECS 60
+
+/**
+ * Frames played per pass of simulated device, 10 ms
+ */
+#define PASS_FRAMES 480
+#define PASS_MS 10
+
+/**
+ * Rate of pipeline output, the bus is resampled to it
+ */
+#define PIPE_RATE 44100
+
+/**
+ * Milliseconds between sound effects queued by the pipeline
+ */
+#define PIPE_SFX_MS 125
+
+/**
+ * Seeks timed per seek measurement
+ */
+#define SEEKS 200
+
+/**
+ * Samples compared against the full decode after each seek
+ */
+#define SEEK_CHECK 64
+
+/**
+ * Samples cross fade lasts
+ */
+#define FADE_LEN (2 * MIX_RATE)
+
+#define RING_MS 100
+#define TONE_LEN MIX_RATE
+
+/**
+ * Header of mono 16 bit WAV
+ */
+#define WAV_HDR_LEN 44
+
+static int16_t g_tone[TONE_LEN];
+static uint8_t g_tone_wav[WAV_HDR_LEN + sizeof(g_tone)];
+static int16_t g_block[PASS_FRAMES * 2];
+static mixer g_mixer;
+
+/**
+ * @g_ogg: Contents of music file
+ * @g_pcm: Entire music decoded to mono
+ */
+static uint8_t *g_ogg;
+static int g_ogg_size;
+static int16_t *g_pcm;
+static int g_pcm_len;
+static int g_pcm_pos;
+
+/**
+ * now_sec() - Seconds of monotonic clock
+ */
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * read_file() - Read entire file into memory
+ * @path: Path to file
+ * @size: Size of file
+ *
+ * Return: Contents of file, NULL on failure
+ */
+static uint8_t *read_file(const char *path, int *size)
+{
+	FILE *f;
+	uint8_t *data;
+
+	f = fopen(path, "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	data = NULL;
+	if (fseek(f, 0, SEEK_END) == 0) {
+		*size = ftell(f);
+		rewind(f);
+		data = (uint8_t *) malloc(*size);
+		if (data && fread(data, *size, 1, f) != 1) {
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(f);
+	return data;
+}
+
+/**
+ * make_tone() - Fill clip with sine wave at half volume
+ * @dst: Clip to fill
+ * @len: Count of samples
+ * @hz: Frequency of tone
+ */
+static void make_tone(int16_t *dst, int len, double hz)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		dst[i] = 16384.0 * sin(2.0 * M_PI * hz * i / MIX_RATE);
+	}
+}
+
+/**
+ * pack_wav() - Write tone into g_tone_wav as a WAV file
+ *
+ * Gives the pipeline a clip to load the same way as from disk.
+ */
+static void pack_wav(void)
+{
+	static const uint16_t fmt[] = {1, 1};
+	static const uint16_t align[] = {2, 16};
+
+	uint8_t *p;
+	uint32_t n;
+
+	p = g_tone_wav;
+	memcpy(p, "RIFF", 4);
+	n = sizeof(g_tone_wav) - 8;
+	memcpy(p + 4, &n, 4);
+	memcpy(p + 8, "WAVEfmt ", 8);
+	n = 16;
+	memcpy(p + 16, &n, 4);
+	memcpy(p + 20, fmt, 4);
+	n = MIX_RATE;
+	memcpy(p + 24, &n, 4);
+	n = MIX_RATE * 2;
+	memcpy(p + 28, &n, 4);
+	memcpy(p + 32, align, 4);
+	memcpy(p + 36, "data", 4);
+	n = sizeof(g_tone);
+	memcpy(p + 40, &n, 4);
+	memcpy(p + WAV_HDR_LEN, g_tone, sizeof(g_tone));
+}
+
+/**
+ * start_voices() - Restart mixer with looping voices of a clip
+ * @count: Count of voices
+ * @pitch: Pitch of every voice
+ * @clip: Mono PCM
+ * @len: Count of samples
+ */
+static void start_voices(int count, float pitch,
+		const int16_t *clip, int len)
+{
+	int i;
+
+	init_mixer(&g_mixer);
+	for (i = 0; i < count; i++) {
+		int v;
+		float pan;
+
+		v = play_voice(&g_mixer, clip, len, true);
+		pan = count > 1 ? 2.0F * i / (count - 1) - 1.0F : 0.0F;
+		set_voice(&g_mixer, v, 1.0F / count, pan, pitch);
+	}
+}
+
+/**
+ * run_mix() - Mix straight into output backend
+ * @secs: Seconds of audio to mix
+ *
+ * Return: Seconds of CPU time taken
+ */
+static double run_mix(int secs)
+{
+	wav_out out;
+	double begin;
+	long remain;
+
+	open_wav_out(&out, NULL, MIX_RATE);
+	begin = now_sec();
+	remain = (long) secs * MIX_RATE;
+	while (remain > 0) {
+		mix_audio(&g_mixer, g_block, PASS_FRAMES);
+		write_wav_out(&out, g_block, PASS_FRAMES);
+		remain -= PASS_FRAMES;
+	}
+	close_wav_out(&out);
+	return now_sec() - begin;
+}
+
+/**
+ * bench_decode() - Decode entire music track to memory
+ *
+ * Return: Zero on success, negative on failure
+ */
+static int bench_decode(void)
+{
+	stb_vorbis *vorb;
+	double secs;
+	double audio;
+	int err;
+	int n;
+
+	vorb = stb_vorbis_open_memory(g_ogg, g_ogg_size, &err, NULL);
+	if (!vorb) {
+		fprintf(stderr, "decode: Failed to parse music %d\n", err);
+		return -1;
+	}
+
+	g_pcm_len = stb_vorbis_stream_length_in_samples(vorb);
+	g_pcm = (int16_t *) malloc(g_pcm_len * sizeof(*g_pcm));
+	if (!g_pcm) {
+		stb_vorbis_close(vorb);
+		return -1;
+	}
+
+	secs = now_sec();
+	n = stb_vorbis_get_samples_short_interleaved(vorb, 1, g_pcm,
+			g_pcm_len);
+	secs = now_sec() - secs;
+	g_pcm_len = n;
+	stb_vorbis_close(vorb);
+
+	audio = (double) n / MIX_RATE;
+	printf("decode: %.1f s of audio in %.1f ms, %.0fx realtime, "
+			"%.2f ms CPU per second, %.2f MB/s\n", audio,
+			1000.0 * secs, audio / secs, 1000.0 * secs / audio,
+			g_ogg_size / secs / 1e6);
+	return 0;
+}
+
+/**
+ * time_seeks() - Seek to pseudo random samples
+ * @m: Music to seek
+ * @bad: Count of seeks that did not land on the exact sample
+ *
+ * Return: Seconds of CPU time taken
+ */
+static double time_seeks(music *m, int *bad)
+{
+	int16_t got[SEEK_CHECK];
+	double secs;
+	uint32_t seed;
+	int i;
+
+	secs = 0.0;
+	seed = 1;
+	*bad = 0;
+	for (i = 0; i < SEEKS; i++) {
+		uint32_t sample;
+		double begin;
+		int err;
+
+		seed = seed * 1103515245 + 12345;
+		sample = (seed >> 8) % (g_pcm_len - SEEK_CHECK);
+
+		begin = now_sec();
+		err = seek_music(m, sample);
+		secs += now_sec() - begin;
+
+		if (err < 0 || stb_vorbis_get_samples_short_interleaved(
+				m->vorb, 1, got, SEEK_CHECK) != SEEK_CHECK ||
+				memcmp(got, g_pcm + sample, sizeof(got))) {
+			++*bad;
+		}
+	}
+	return secs;
+}
+
+/**
+ * time_loops() - Play across the loop point and past its block
+ * @m: Music to loop
+ * @prep: Seconds taken by prepare_music()
+ * @bad: Count of loops that did not play the exact samples
+ *
+ * Return: Seconds taken reading across the loop point
+ */
+static double time_loops(music *m, double *prep, int *bad)
+{
+	int16_t got[SEEK_CHECK * 2];
+	const track *t;
+	double secs;
+	int i;
+
+	t = m->t;
+	secs = 0.0;
+	*prep = 0.0;
+	*bad = 0;
+	for (i = 0; i < SEEKS; i++) {
+		uint32_t at;
+		double begin;
+		int err;
+		int n;
+
+		if (seek_music(m, t->loop_end - SEEK_CHECK) < 0) {
+			++*bad;
+			continue;
+		}
+		begin = now_sec();
+		n = read_music(m, got, SEEK_CHECK * 2);
+		secs += now_sec() - begin;
+		err = 0;
+		if (n != SEEK_CHECK * 2 || memcmp(got,
+				g_pcm + t->loop_end - SEEK_CHECK,
+				SEEK_CHECK * sizeof(*got)) || memcmp(
+				got + SEEK_CHECK, g_pcm + t->loop_start,
+				SEEK_CHECK * sizeof(*got))) {
+			err = -1;
+		}
+
+		begin = now_sec();
+		if (prepare_music(m) < 0) {
+			err = -1;
+		}
+		*prep += now_sec() - begin;
+
+		/*the decoder takes over from the block part way*/
+		at = t->loop_start + SEEK_CHECK;
+		while (!err && at < t->loop_start + t->block_len +
+				SEEK_CHECK && at + SEEK_CHECK <= t->loop_end) {
+			if (read_music(m, got, SEEK_CHECK) != SEEK_CHECK ||
+					memcmp(got, g_pcm + at,
+					SEEK_CHECK * sizeof(*got))) {
+				err = -1;
+			}
+			at += SEEK_CHECK;
+		}
+		if (err < 0) {
+			++*bad;
+		}
+	}
+	return secs;
+}
+
+/**
+ * time_rewinds() - Play the start of the track after rewinding
+ * @m: Music to rewind
+ * @prep: Seconds taken by prepare_music()
+ * @bad: Count of rewinds that did not play the exact samples
+ *
+ * Return: Seconds taken from rewinding to the first samples read
+ */
+static double time_rewinds(music *m, double *prep, int *bad)
+{
+	int16_t got[SEEK_CHECK];
+	const track *t;
+	double secs;
+	int i;
+
+	t = m->t;
+	secs = 0.0;
+	*prep = 0.0;
+	*bad = 0;
+	for (i = 0; i < SEEKS; i++) {
+		uint32_t at;
+		double begin;
+		int err;
+
+		if (seek_music(m, t->loop_end / 2) < 0) {
+			++*bad;
+			continue;
+		}
+		begin = now_sec();
+		rewind_music(m);
+		err = read_music(m, got, SEEK_CHECK) != SEEK_CHECK ||
+				memcmp(got, g_pcm, sizeof(got)) ? -1 : 0;
+		secs += now_sec() - begin;
+
+		begin = now_sec();
+		if (prepare_music(m) < 0) {
+			err = -1;
+		}
+		*prep += now_sec() - begin;
+
+		/*the decoder takes over from the block part way*/
+		at = SEEK_CHECK;
+		while (!err && at < t->start_len + SEEK_CHECK &&
+				at + SEEK_CHECK <= t->loop_end) {
+			if (read_music(m, got, SEEK_CHECK) != SEEK_CHECK ||
+					memcmp(got, g_pcm + at, sizeof(got))) {
+				err = -1;
+			}
+			at += SEEK_CHECK;
+		}
+		if (err < 0) {
+			++*bad;
+		}
+	}
+	return secs;
+}
+
+/**
+ * bench_seek() - Print cost of seeking music and of looping it
+ */
+static void bench_seek(void)
+{
+	track t;
+	music m;
+	double secs;
+	double prep;
+	int err;
+	int bad;
+
+	memset(&m, 0, sizeof(m));
+	m.vorb = stb_vorbis_open_memory(g_ogg, g_ogg_size, &err, NULL);
+	if (!m.vorb || init_track(&t, m.vorb) < 0) {
+		stb_vorbis_close(m.vorb);
+		return;
+	}
+	m.t = &t;
+
+	secs = time_seeks(&m, &bad);
+	printf("seek: %8.2f us per seek, %d inexact\n",
+			1e6 * secs / SEEKS, bad);
+	secs = time_loops(&m, &prep, &bad);
+	printf("loop: %8.2f us per loop point, %.2f us deferred seek, "
+			"%d inexact\n", 1e6 * secs / SEEKS,
+			1e6 * prep / SEEKS, bad);
+	secs = time_rewinds(&m, &prep, &bad);
+	printf("start: %7.2f us per rewind, %.2f us deferred seek, "
+			"%d inexact\n", 1e6 * secs / SEEKS,
+			1e6 * prep / SEEKS, bad);
+
+	destroy_track(&t);
+	stb_vorbis_close(m.vorb);
+}
+
+/**
+ * bench_resample() - Print cost of linear resampling of mixer voices
+ * @rate: Rate music is treated as
+ */
+static void bench_resample(int rate)
+{
+	double secs;
+	float pitch;
+
+	pitch = rate / (float) MIX_RATE;
+	start_voices(1, pitch, g_pcm, g_pcm_len);
+	secs = run_mix(BENCH_SECS);
+	printf("linear: %5d Hz to %d Hz: %8.2f us per second\n", rate,
+			MIX_RATE, 1e6 * secs / BENCH_SECS);
+}
+
+/**
+ * read_pcm() - Pull decoded music, looping
+ * @ctx: Count of channels, music is copied to each
+ * @dst: Interleaved frames to fill
+ * @count: Count of frames
+ *
+ * Return: Count of frames
+ */
+static int read_pcm(void *ctx, int16_t *dst, int count)
+{
+	int channels;
+	int i;
+	int c;
+
+	channels = *(int *) ctx;
+	for (i = 0; i < count; i++) {
+		for (c = 0; c < channels; c++) {
+			*dst++ = g_pcm[g_pcm_pos];
+		}
+		g_pcm_pos = (g_pcm_pos + 1) % g_pcm_len;
+	}
+	return count;
+}
+
+/**
+ * bench_polyphase() - Print cost of polyphase resampler
+ * @in_rate: Rate of source
+ * @out_rate: Rate of output
+ * @channels: Count of channels
+ */
+static void bench_polyphase(int in_rate, int out_rate, int channels)
+{
+	resampler rs;
+	double secs;
+	long remain;
+
+	if (init_resampler(&rs, in_rate, out_rate, channels,
+			read_pcm, &channels) < 0) {
+		return;
+	}
+
+	g_pcm_pos = 0;
+	secs = now_sec();
+	remain = (long) BENCH_SECS * out_rate;
+	while (remain > 0) {
+		read_resampled(&rs, g_block, PASS_FRAMES);
+		remain -= PASS_FRAMES;
+	}
+	secs = now_sec() - secs;
+
+	printf("polyphase: %5d Hz to %5d Hz, %s: %8.2f us per second\n",
+			in_rate, out_rate, channels > 1 ? "stereo" : "mono",
+			1e6 * secs / BENCH_SECS);
+	destroy_resampler(&rs);
+}
+
+/**
+ * bench_mix() - Print cost of mixing voices
+ * @count: Count of voices
+ * @pitch: Pitch of every voice
+ *
+ * Voices per millisecond is the count of voices one millisecond
+ * of CPU can mix for every millisecond of audio.
+ */
+static void bench_mix(int count, float pitch)
+{
+	double cpu_ms;
+	double audio_ms;
+
+	start_voices(count, pitch, g_tone, TONE_LEN);
+	cpu_ms = 1000.0 * run_mix(BENCH_SECS);
+	audio_ms = 1000.0 * BENCH_SECS;
+
+	printf("mix: %2d voices, pitch %.2f: %8.2f us per voice-second, "
+			"%7.1f voices/ms\n", count, pitch,
+			1000.0 * cpu_ms / (count * BENCH_SECS),
+			count * audio_ms / cpu_ms);
+}
+
+/**
+ * load_tone() - Loader of pipeline, every clip is the tone
+ * @id: SFX_* of clip
+ */
+static void load_tone(int id)
+{
+	load_sfx(id, g_tone_wav, sizeof(g_tone_wav));
+}
+
+/**
+ * bench_pipeline() - Run the stream, ring and device together
+ * @path: WAV file to write output to, NULL to discard
+ *
+ * Drives the same stream as the XAudio2 thread, with the device
+ * played by pull_wav_out() a pass every 10 ms of simulated time.
+ * Output is at 44100 Hz, so the bus goes through the output
+ * resampler. A sound effect is queued every PIPE_SFX_MS, and
+ * halfway through, the track is queued again to cross fade into
+ * itself.
+ */
+static void bench_pipeline(const char *path)
+{
+	wav_out out;
+	long passes;
+	long pass;
+	double secs;
+
+	init_sfx(load_tone);
+	if (init_stream(PIPE_RATE, RING_MS * PIPE_RATE / 1000) < 0) {
+		goto end_sfx;
+	}
+	if (load_stream_track(MUS_SAPPHIRE_LAKE, g_ogg, g_ogg_size) < 0 ||
+			open_wav_out(&out, path, PIPE_RATE) < 0) {
+		goto end_stream;
+	}
+
+	passes = PIPE_SECS * 1000 / PASS_MS;
+	secs = now_sec();
+	for (pass = 0; pass < passes; pass++) {
+		if (pass == 0 || pass == passes / 2) {
+			queue_music(MUS_SAPPHIRE_LAKE);
+		}
+		if (pass % (PIPE_SFX_MS / PASS_MS) == 0) {
+			queue_sfx(pass % COUNTOF_SFX);
+		}
+		update_stream();
+		fill_stream();
+		pull_wav_out(&out, &g_stream_ring, PIPE_RATE * PASS_MS / 1000);
+	}
+	secs = now_sec() - secs;
+
+	printf("pipeline: music + sfx every %d ms, %d s at %d Hz, one "
+			"cross fade: %.2f ms CPU per second of audio, "
+			"%d underruns\n", PIPE_SFX_MS, PIPE_SECS, PIPE_RATE,
+			1000.0 * secs / PIPE_SECS, out.underruns);
+
+	close_wav_out(&out);
+	reset_stream(out.underruns);
+end_stream:
+	end_stream();
+end_sfx:
+	end_sfx();
+}
+
+int main(int argc, char **argv)
+{
+	static const int counts[] = {1, 8, MAX_VOICES};
+
+	const char *music;
+	int i;
+
+	music = argc > 1 ? argv[1] : "res/music/sapphire-lake.ogg";
+	g_ogg = read_file(music, &g_ogg_size);
+	if (!g_ogg) {
+		fprintf(stderr, "Failed to read %s\n", music);
+		return 1;
+	}
+	make_tone(g_tone, TONE_LEN, 440.0);
+	pack_wav();
+
+	if (bench_decode() < 0) {
+		return 1;
+	}
+	bench_seek();
+	bench_resample(44100);
+	bench_resample(22050);
+	bench_polyphase(44100, MIX_RATE, 1);
+	bench_polyphase(22050, MIX_RATE, 1);
+	bench_polyphase(MIX_RATE, 44100, 2);
+	bench_polyphase(MIX_RATE, 96000, 2);
+	for (i = 0; i < (int) (sizeof(counts) / sizeof(*counts)); i++) {
+		bench_mix(counts[i], 1.0F);
+		bench_mix(counts[i], 1.5F);
+	}
+	bench_pipeline(argc > 2 ? argv[2] : NULL);
+
+	free(g_pcm);
+	free(g_ogg);
+	return 0;
+}
@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "map-algo.hpp"
+#include "util.hpp"
+
+/**
+ * Passes over the map per measurement
+ */
+#define PASSES 200
+
+/**
+ * Row the ground starts at, as a fraction of map height
+ */
+#define GROUND_FRAC 0.6
+
+/**
+ * Spawn tiles per thousand tiles above ground
+ */
+#define SPAWN_PERMILLE 2
+
+static game_map g_map;
+
+/**
+ * now_sec() - Seconds of monotonic clock
+ */
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * make_map() - Fill map with sky, a grass surface, ground and spawns
+ * @w: Width of map
+ * @h: Height of map
+ *
+ * Return: Zero on success, negative on failure
+ */
+static int make_map(int w, int h)
+{
+	uint32_t seed;
+	int y;
+
+	g_map.w = w;
+	g_map.h = 0;
+	g_map.rows = (uint8_t **) calloc(h, sizeof(*g_map.rows));
+	if (!g_map.rows) {
+		return -1;
+	}
+	g_map.h = h;
+
+	seed = 1;
+	for (y = 0; y < h; y++) {
+		uint8_t *row;
+		int ground;
+		int x;
+
+		row = (uint8_t *) malloc(w);
+		if (!row) {
+			return -1;
+		}
+		g_map.rows[y] = row;
+
+		ground = h * GROUND_FRAC;
+		for (x = 0; x < w; x++) {
+			seed = seed * 1103515245 + 12345;
+			if (y > ground) {
+				row[x] = TILE_GROUND;
+			} else if (y == ground) {
+				row[x] = TILE_GRASS;
+			} else if ((seed >> 8) % 1000 < SPAWN_PERMILLE) {
+				row[x] = TILE_CRABBY;
+			} else {
+				row[x] = TILE_BLANK;
+			}
+		}
+	}
+	g_map.rows[0][0] = TILE_CAPTAIN;
+	return 0;
+}
+
+/**
+ * free_map() - Free rows of map
+ */
+static void free_map(void)
+{
+	int y;
+
+	for (y = 0; y < g_map.h; y++) {
+		free(g_map.rows[y]);
+	}
+	free(g_map.rows);
+}
+
+/**
+ * scalar_count() - Count tiles of set a tile at a time
+ * @set: TILE_BIT() of each tile to count
+ *
+ * Return: Count of tiles
+ */
+static int scalar_count(unsigned set)
+{
+	int count;
+	int y;
+
+	count = 0;
+	for (y = 0; y < g_map.h; y++) {
+		int x;
+
+		for (x = 0; x < g_map.w; x++) {
+			count += (set >> g_map.rows[y][x]) & 1;
+		}
+	}
+	return count;
+}
+
+/**
+ * scalar_replace() - Replace tile a tile at a time
+ * @from: Tile to replace
+ * @to: Tile to replace with
+ *
+ * Return: Count of tiles replaced
+ */
+static int scalar_replace(int from, int to)
+{
+	int count;
+	int y;
+
+	count = 0;
+	for (y = 0; y < g_map.h; y++) {
+		int x;
+
+		for (x = 0; x < g_map.w; x++) {
+			if (g_map.rows[y][x] == from) {
+				g_map.rows[y][x] = to;
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+/**
+ * find_all() - Find every tile of set in map
+ * @set: TILE_BIT() of each tile to find
+ *
+ * Return: Count of tiles found
+ */
+static int find_all(unsigned set)
+{
+	int count;
+	int y;
+
+	count = 0;
+	for (y = 0; y < g_map.h; y++) {
+		int x;
+
+		x = find_tiles(g_map.rows[y], 0, g_map.w, set);
+		while (x < g_map.w) {
+			count++;
+			x = find_tiles(g_map.rows[y], x + 1, g_map.w, set);
+		}
+	}
+	return count;
+}
+
+/**
+ * print_rate() - Print throughput of passes over map
+ * @name: Name of operation
+ * @secs: Seconds PASSES passes took
+ * @result: Result of last pass, printed so passes are not dropped
+ */
+static void print_rate(const char *name, double secs, long result)
+{
+	double bytes;
+
+	bytes = (double) g_map.w * g_map.h * PASSES;
+	printf("%-16s %7.2f GB/s, %8.1f us per map, result %ld\n",
+			name, bytes / secs / 1e9, 1e6 * secs / PASSES,
+			result);
+}
+
+/**
+ * bench_map() - Print throughput of each map operation
+ * @w: Width of map
+ * @h: Height of map
+ *
+ * Return: Zero on success, negative on failure
+ */
+static int bench_map(int w, int h)
+{
+	int counts[COUNTOF_TILES];
+	unsigned spawns;
+	tile_box box;
+	double secs;
+	long result;
+	int i;
+
+	if (make_map(w, h) < 0) {
+		fprintf(stderr, "Failed to allocate %dx%d map\n", w, h);
+		free_map();
+		return -1;
+	}
+	spawns = TILE_BIT(TILE_CAPTAIN) | TILE_BIT(TILE_CRABBY);
+	printf("%dx%d map:\n", w, h);
+
+	secs = now_sec();
+	for (i = 0; i < PASSES; i++) {
+		result = scalar_count(spawns);
+	}
+	print_rate("scalar count", now_sec() - secs, result);
+
+	secs = now_sec();
+	for (i = 0; i < PASSES; i++) {
+		result = count_tiles(&g_map, spawns);
+	}
+	print_rate("count", now_sec() - secs, result);
+
+	secs = now_sec();
+	for (i = 0; i < PASSES; i++) {
+		result = find_all(spawns);
+	}
+	print_rate("find all", now_sec() - secs, result);
+
+	secs = now_sec();
+	for (i = 0; i < PASSES; i++) {
+		count_each_tile(&g_map, counts);
+	}
+	print_rate("histogram", now_sec() - secs, counts[TILE_GROUND]);
+
+	secs = now_sec();
+	for (i = 0; i < PASSES; i++) {
+		box = bound_tiles(&g_map, spawns);
+	}
+	print_rate("bound spawns", now_sec() - secs,
+			(long) (box.r - box.l + 1) * (box.b - box.t + 1));
+
+	/*swap ground and grass back and forth, so each pass does the same*/
+	secs = now_sec();
+	for (i = 0; i < PASSES; i++) {
+		result = scalar_replace(i & 1 ? TILE_GRASS : TILE_GROUND,
+				i & 1 ? TILE_GROUND : TILE_GRASS);
+	}
+	print_rate("scalar replace", now_sec() - secs, result);
+
+	box.l = 0;
+	box.t = 0;
+	box.r = w - 1;
+	box.b = h - 1;
+	secs = now_sec();
+	for (i = 0; i < PASSES; i++) {
+		result = replace_tiles(&g_map, &box,
+				i & 1 ? TILE_GRASS : TILE_GROUND,
+				i & 1 ? TILE_GROUND : TILE_GRASS);
+	}
+	print_rate("replace", now_sec() - secs, result);
+
+	free_map();
+	return 0;
+}
+
+int main(void)
+{
+	if (bench_map(MAX_MAP_LEN, MAX_MAP_LEN) < 0 ||
+			bench_map(200, 40) < 0) {
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bot.hpp"
+#include "entity.hpp"
+#include "game-map.hpp"
+#include "input.hpp"
+#include "perf.hpp"
+#include "sim.hpp"
+
+/**
+ * Frames simulated per map, 1/60 seconds each
+ */
+#define SIM_FRAMES 100000
+#define SIM_FPS 60
+
+/**
+ * Row the ground starts at, as a fraction of map height
+ */
+#define GROUND_FRAC 0.6
+
+/**
+ * Crabbies per thousand tiles above ground
+ */
+#define SPAWN_PERMILLE 2
+
+/**
+ * make_map() - Fill map with sky, a grass surface, ground and spawns
+ * @w: Width of map
+ * @h: Height of map
+ *
+ * The captain spawns on the surface at the left edge.
+ */
+static void make_map(int w, int h)
+{
+	uint32_t seed;
+	int ground;
+	int y;
+
+	g_gm = create_game_map();
+	size_game_map(g_gm, w, h);
+
+	seed = 1;
+	ground = h * GROUND_FRAC;
+	for (y = 0; y < h; y++) {
+		uint8_t *row;
+		int x;
+
+		row = g_gm->rows[y];
+		for (x = 0; x < w; x++) {
+			seed = seed * 1103515245 + 12345;
+			if (y > ground) {
+				row[x] = TILE_GROUND;
+			} else if (y == ground) {
+				row[x] = TILE_GRASS;
+			} else if ((seed >> 8) % 1000 < SPAWN_PERMILLE) {
+				row[x] = TILE_CRABBY;
+			} else {
+				row[x] = TILE_BLANK;
+			}
+		}
+	}
+	g_gm->rows[ground - 1][0] = TILE_CAPTAIN;
+}
+
+/**
+ * bench_sim() - Print simulated frames per second of generated map
+ * @w: Width of map
+ * @h: Height of map
+ * @seed: Seed of bot playing the captain
+ *
+ * Return: Zero on success, negative on failure
+ */
+static int bench_sim(int w, int h, uint32_t seed)
+{
+	input_src src;
+	bot b;
+	int64_t begin;
+	int64_t end;
+	const entity *e;
+	double ms;
+	int count;
+
+	make_map(w, h);
+	if (start_entities() < 0) {
+		destroy_game_map(g_gm);
+		return -1;
+	}
+
+	count = 0;
+	dl_for_each_entry (e, &g_entities, node) {
+		count++;
+	}
+
+	init_bot(&b, seed, 0);
+	memset(&src, 0, sizeof(src));
+	src.poll = poll_bot;
+	src.ctx = &b;
+	set_input_src(&src);
+
+	begin = query_perf_counter();
+	run_sim(SIM_FRAMES, SIM_FPS);
+	end = query_perf_counter();
+
+	ms = (end - begin) * 1000.0 / query_perf_freq();
+	e = get_captain();
+	printf("%dx%d map, %d entities:\n", w, h, count);
+	printf("%d frames in %.1f ms, %.0f frames/s, "
+			"captain at %.1f, %.1f\n", SIM_FRAMES, ms,
+			SIM_FRAMES * 1000.0 / ms, e->pos.x, e->pos.y);
+
+	end_entities();
+	set_input_src(NULL);
+	destroy_game_map(g_gm);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t seed;
+
+	seed = argc > 1 ? strtoul(argv[1], NULL, 0) : 0;
+	init_tables();
+	if (bench_sim(200, 40, seed) < 0 ||
+			bench_sim(MAX_MAP_LEN, 40, seed) < 0) {
+		return 1;
+	}
+	return 0;
+}
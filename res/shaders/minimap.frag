@@ -0,0 +1,30 @@
+#version 330 core
+
+in vec2 tex_coord;
+in vec2 tile;
+
+uniform sampler2D map;
+uniform vec4 outline;
+
+out vec4 frag_color;
+
+void main()
+{
+	vec2 px;
+	vec2 lo;
+	vec2 hi;
+
+	frag_color = texture(map, tex_coord);
+	if (outline.z <= 0.0F) {
+		return;
+	}
+
+	/*one pixel border along edges of camera*/
+	px = fwidth(tile);
+	lo = tile - outline.xy;
+	hi = outline.xy + outline.zw - tile;
+	if (all(greaterThan(lo, -px)) && all(greaterThan(hi, -px)) &&
+			(any(lessThan(lo, px)) || any(lessThan(hi, px)))) {
+		frag_color = vec4(1.0F);
+	}
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+/*must match MINIMAP_LEN in minimap.hpp*/
+#define MINIMAP_LEN 1024.0F
+
+layout (location = 0) in vec2 corner;
+
+uniform vec2 view;
+uniform vec2 origin;
+uniform vec2 size;
+
+out vec2 tex_coord;
+out vec2 tile;
+
+void main()
+{
+	vec2 upos;
+
+	/*map only fills top left of minimap texture*/
+	tile = corner * size;
+	tex_coord = tile / MINIMAP_LEN;
+
+	/*transform corner of map into screen coords*/
+	upos = origin + tile;
+	upos /= view.xy;
+	upos *= 2.0F; /*move origin from center to corner*/
+	upos -= 1.0F;
+	upos.y = -upos.y; /*flip y-axis*/
+
+	gl_Position = vec4(upos, 0.0F, 1);
+}
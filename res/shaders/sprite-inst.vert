@@ -0,0 +1,53 @@
+#version 330 core
+
+/*must match ATLAS_LEN and TILE_LEN in render.cpp*/
+#define ATLAS_LEN 512.0F
+#define TILE_LEN 32.0F
+
+layout (location = 0) in vec2 corner;
+layout (location = 1) in ivec2 pos;
+layout (location = 2) in uint id; 
+layout (location = 3) in uint flip;
+
+uniform vec2 view;
+uniform usamplerBuffer rects;
+
+out vec3 tex_coord;
+
+void main()
+{
+	uvec4 rect;
+	float page;
+
+	float b;
+	vec2 tl;
+	vec2 br;
+	vec2 uv;
+
+	vec2 upos;
+
+	/*look up atlas rect of sprite, two texels per sprite*/
+	rect = texelFetch(rects, int(id) * 2);
+	page = float(texelFetch(rects, int(id) * 2 + 1).x);
+
+	/*convert rect into text coords*/
+	b = 1.0F / 8192.0F;
+	tl = vec2(rect.xy) / ATLAS_LEN + b;
+	br = vec2(rect.xy + rect.zw) / ATLAS_LEN - b;
+
+	/*mirror corner when flipped*/
+	uv = corner;
+	if (flip != 0u) {
+		uv.x = 1.0F - uv.x;
+	}
+	tex_coord = vec3(mix(tl, br, uv), page);
+
+	/*transform corner into screen coords*/ 
+	upos = (vec2(pos) + corner * vec2(rect.zw)) / TILE_LEN;
+	upos /= view.xy;
+	upos *= 2.0F; /*move origin from center to corner*/
+	upos -= 1.0F;
+	upos.y = -upos.y; /*flip y-axis*/ 
+
+	gl_Position = vec4(upos, 0.0F, 1);
+}
@@ -1,15 +1,12 @@
 #version 330 core
 
-in vec2 tex_coord;
+in vec3 tex_coord;
 
-uniform sampler2D tex;
+uniform sampler2DArray tex;
 
 out vec4 frag_color;
 
 void main()
 {
 	frag_color = texture(tex, tex_coord); 
-	if (frag_color.w < 0.1F) {
-		discard;
-	}
 }
@@ -0,0 +1,132 @@
+#include <string.h>
+
+#include "arena.hpp"
+#include "util.hpp"
+
+/**
+ * align_up() - Round size up to allocation alignment 
+ * @size: Size to round
+ */
+static size_t align_up(size_t size)
+{
+	return (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+}
+
+/**
+ * add_chunk() - Start allocating from new chunk
+ * @a: Arena to add to
+ * @size: Minimum size of data 
+ */
+static void add_chunk(arena *a, size_t size)
+{
+	arena_chunk *c;
+
+	if (a->head && a->head->size * 2 > size) {
+		size = a->head->size * 2;
+	}
+	if (size < a->min_size) {
+		size = a->min_size;
+	}
+
+	c = (arena_chunk *) xmalloc(sizeof(*c) + size);
+	c->prev = a->head;
+	c->size = size;
+	c->used = 0;
+	a->head = c;
+}
+
+/**
+ * free_chunks() - Free every chunk of arena
+ * @a: Arena to free chunks of
+ */
+static void free_chunks(arena *a)
+{
+	arena_chunk *c;
+
+	c = a->head;
+	while (c) {
+		arena_chunk *prev;
+
+		prev = c->prev;
+		free(c);
+		c = prev;
+	}
+	a->head = NULL;
+}
+
+void init_arena(arena *a, size_t min_size)
+{
+	a->head = NULL;
+	a->min_size = min_size;
+	a->used = 0;
+	a->high = 0;
+	a->top = NULL;
+}
+
+void *arena_alloc(arena *a, size_t size)
+{
+	arena_chunk *c;
+	void *ptr;
+
+	size = align_up(size);
+	c = a->head;
+	if (!c || c->size - c->used < size) {
+		add_chunk(a, size);
+		c = a->head;
+	}
+
+	ptr = c->data + c->used;
+	c->used += size;
+	a->used += size;
+	if (a->used > a->high) {
+		a->high = a->used;
+	}
+	a->top = ptr;
+	return ptr;
+}
+
+void *arena_grow(arena *a, void *ptr, size_t old, size_t size)
+{
+	arena_chunk *c;
+	void *grown;
+
+	old = align_up(old);
+	size = align_up(size);
+	c = a->head;
+	if (ptr && ptr == a->top && c->used - old + size <= c->size) {
+		c->used += size - old;
+		a->used += size - old;
+		if (a->used > a->high) {
+			a->high = a->used;
+		}
+		return ptr;
+	}
+
+	grown = arena_alloc(a, size);
+	if (ptr) {
+		memcpy(grown, ptr, old);
+	}
+	return grown;
+}
+
+void reset_arena(arena *a)
+{
+	/*merge chunks so the next frame fits in one*/
+	if (a->head && a->head->prev) {
+		free_chunks(a);
+		add_chunk(a, align_up(a->high));
+	}
+
+	if (a->head) {
+		a->head->used = 0;
+	}
+	a->used = 0;
+	a->top = NULL;
+}
+
+void destroy_arena(arena *a)
+{
+	free_chunks(a);
+	a->used = 0;
+	a->top = NULL;
+}
@@ -0,0 +1,88 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <stddef.h>
+
+/**
+ * Alignment of every allocation 
+ */
+#define ARENA_ALIGN 16
+
+/**
+ * struct arena_chunk - Block of memory that arena allocates from 
+ * @prev: Previously filled chunk, NULL if first
+ * @size: Size of data
+ * @used: Bytes of data handed out
+ * @data: Start of memory
+ */
+struct arena_chunk {
+	arena_chunk *prev;
+	size_t size;
+	size_t used;
+	alignas(ARENA_ALIGN) char data[];
+};
+
+/**
+ * struct arena - Linear allocator reset all at once 
+ * @head: Chunk currently allocated from, NULL if none
+ * @min_size: Minimum size of a new chunk
+ * @used: Bytes handed out since last reset
+ * @high: Most bytes handed out between any two resets
+ * @top: Last allocation, can be grown in place
+ *
+ * When an allocation does not fit, a new chunk is added. 
+ * On reset, chunks are merged into one chunk large enough for
+ * the high water mark, so once the high water mark settles
+ * the arena stops touching the heap. 
+ */
+struct arena {
+	arena_chunk *head;
+	size_t min_size;
+	size_t used;
+	size_t high;
+	void *top;
+};
+
+/**
+ * init_arena() - Initialize empty arena
+ * @a: Arena to initialize
+ * @min_size: Minimum size of chunk
+ */
+void init_arena(arena *a, size_t min_size);
+
+/**
+ * arena_alloc() - Allocate memory from arena, crash on failure 
+ * @a: Arena to allocate from
+ * @size: Size of allocation
+ *
+ * Return: Pointer to allocation, valid until next reset 
+ */
+void *arena_alloc(arena *a, size_t size);
+
+/**
+ * arena_grow() - Grow allocation from arena, crash on failure 
+ * @a: Arena allocation came from
+ * @ptr: Allocation to grow, may be NULL
+ * @old: Old size of allocation
+ * @size: New size of allocation
+ *
+ * Grows in place when allocation is the last one made, 
+ * otherwise contents are copied to a new allocation.
+ *
+ * Return: Pointer to allocation
+ */
+void *arena_grow(arena *a, void *ptr, size_t old, size_t size);
+
+/**
+ * reset_arena() - Release all allocations of arena 
+ * @a: Arena to reset
+ */
+void reset_arena(arena *a);
+
+/**
+ * destroy_arena() - Free all memory held by arena 
+ * @a: Arena to destroy
+ */
+void destroy_arena(arena *a);
+
+#endif
@@ -2,28 +2,39 @@
 #include <stdio.h>
 #include <windows.h>
 
-#include <stb_vorbis.c>
-
 #include "audio.hpp"
+#include "mixer.hpp"
+#include "sfx-load.hpp"
+#include "stream.hpp"
+#include "util.hpp"
 #include "win32.hpp"
 
 /**
- * @MUS_INVALID: Their is no music in queue
- * @MUS_NONE: No music playing
+ * Most frames of silence submitted per pass on underrun
  */
-#define MUS_INVALID -2
-#define MUS_NONE -1
+#define SILENCE_LEN 1024
 
-#define NUM_SBUFS 8
-#define SBUF_LEN 2400 
+/**
+ * Longest wait on callbacks of the source voice, a lost device
+ * must not hang the stream thread
+ */
+#define OUT_WAIT_MS 1000
 
-#define SBUF_MS (1000 * SBUF_LEN / 48000)
+/**
+ * @OUT_PLAY: Stream is playing, underruns are filled with silence
+ * @OUT_DRAIN: Stream ended, end the voice once the ring is played
+ * @OUT_CUT: Stream was cut, end the voice without the ring
+ * @OUT_DONE: Buffer flagged as end of stream was submitted
+ */
+#define OUT_PLAY 0
+#define OUT_DRAIN 1
+#define OUT_CUT 2
+#define OUT_DONE 3
 
 typedef void WINAPI co_uninitialize_fn(void);
 typedef HRESULT WINAPI co_initialize_ex_fn(LPVOID, DWORD);
 typedef HRESULT WINAPI xaudio2_create_fn(
 		IXAudio2 **, UINT32, XAUDIO2_PROCESSOR);
-typedef short sbuf[SBUF_LEN];
 
 struct voice_cb : IXAudio2VoiceCallback {
 	void OnStreamEnd(void) override; 
@@ -35,15 +46,20 @@ struct voice_cb : IXAudio2VoiceCallback {
 	void OnVoiceError(void *buf_ctx, HRESULT err) override;
 }; 
 
-static const WAVEFORMATEX g_wave_fmt = {
+/**
+ * Rate is changed to the rate of the device before use
+ */
+static WAVEFORMATEX g_wave_fmt = {
 	.wFormatTag = WAVE_FORMAT_PCM, 
-	.nChannels = 1,
-	.nSamplesPerSec = 48000,
-	.nAvgBytesPerSec = 96000,
-	.nBlockAlign = 2,
+	.nChannels = 2,
+	.nSamplesPerSec = MIX_RATE,
+	.nAvgBytesPerSec = MIX_RATE * 4,
+	.nBlockAlign = 4,
 	.wBitsPerSample = 16
 };
 
+static int16_t g_silence[SILENCE_LEN * 2];
+
 static const wchar_t *const g_music_paths[COUNTOF_MUS] = {
 	[MUS_SAPPHIRE_LAKE] = L"sapphire-lake.ogg"
 };
@@ -56,28 +72,140 @@ static IXAudio2 *g_xaudio2;
 static IXAudio2MasteringVoice *g_master;
 static IXAudio2SourceVoice *g_source;
 
-static HANDLE g_buf_end_ev;
+/**
+ * @g_stream_ev: Wakes idle stream thread when work is queued
+ * @g_fill_ev: Set by callback once the ring has room to be filled
+ * @g_end_ev: Set by callback once the end of stream has played
+ */
 static HANDLE g_stream_ev; 
+static HANDLE g_fill_ev;
+static HANDLE g_end_ev;
 static HANDLE g_stream_thrd;
 
 /**
- * @g_mus_qi: The music queued
+ * @g_out_rate: Rate of device, and of frames in ring
+ * @g_ring_frames: Frames the stream thread keeps the ring filled to
+ * @g_submit_pos: Ring cursor of next frame to submit, callback only
+ * @g_underruns: Passes the ring could not cover
  */
-static volatile long g_mus_qi = MUS_INVALID;
+static int g_out_rate;
+static int g_ring_frames;
+static uint32_t g_submit_pos;
+static volatile long g_underruns;
 
 /**
- * voice_cb::OnStreamEnd() - Play when audio is done streaming 
+ * @g_out_on: Source voice is running, callback may submit
+ * @g_out_end: OUT_* of stream, moved to OUT_DONE by callback only
+ * @g_stream_idle: Stream thread is waiting to be woken
  */
-void voice_cb::OnStreamEnd(void) 
+static volatile bool g_out_on;
+static int g_out_end;
+static volatile bool g_stream_idle;
+
+/**
+ * @g_mus_files: Every track, mapped so switching never waits on disk
+ */
+static mapped_file g_mus_files[COUNTOF_MUS];
+
+/**
+ * voice_cb::OnStreamEnd() - Wake stream thread waiting on end of stream
+ *
+ * Buffers play in order, so every buffer from the ring has
+ * ended by the time the buffer flagged as the end has.
+ */
+void voice_cb::OnStreamEnd(void)
 {
-	SetEvent(g_buf_end_ev); 
+	SetEvent(g_end_ev);
 }
 
 void voice_cb::OnVoiceProcessingPassEnd(void) {}
 
-void voice_cb::OnVoiceProcessingPassStart(UINT32 min_samples) {}
+/**
+ * submit_pcm() - Queue frames on source voice
+ * @pcm: Interleaved stereo frames, must stay valid until played
+ * @frames: Count of frames
+ * @ring: Frames come from the ring and are released when played
+ * @last: Buffer ends the stream, OnStreamEnd() is called once played
+ */
+static void submit_pcm(const int16_t *pcm, int frames, bool ring, bool last)
+{
+	XAUDIO2_BUFFER xbuf;
+
+	memset(&xbuf, 0, sizeof(xbuf));
+	xbuf.pAudioData = (const BYTE *) pcm;
+	xbuf.AudioBytes = frames * 4;
+	if (ring) {
+		xbuf.pContext = (void *) (uintptr_t) frames;
+	}
+	if (last) {
+		xbuf.Flags = XAUDIO2_END_OF_STREAM;
+	}
+	g_source->SubmitSourceBuffer(&xbuf);
+}
+
+/**
+ * voice_cb::OnVoiceProcessingPassStart() - Drain ring into voice
+ * @min_bytes: Bytes needed to keep the voice from starving
+ *
+ * Runs on the XAudio2 thread. Frames are submitted straight
+ * from the ring without copying, and released once played.
+ * Once the stream ended, the ring running dry or being cut
+ * submits a last buffer of silence flagged as the end.
+ */
+void voice_cb::OnVoiceProcessingPassStart(UINT32 min_bytes) 
+{
+	int end;
+	int need;
+
+	end = __atomic_load_n(&g_out_end, __ATOMIC_ACQUIRE);
+	if (!g_out_on || end == OUT_DONE) {
+		return;
+	}
+
+	need = min_bytes / 4;
+	while (need > 0 && end != OUT_CUT) {
+		const int16_t *pcm;
+		int n;
 
-void voice_cb::OnBufferEnd(void *buf_ctx) {}
+		pcm = ring_read_ptr(&g_stream_ring, g_submit_pos, &n);
+		if (!n) {
+			break;
+		}
+		n = min(n, need);
+		submit_pcm(pcm, n, true, false);
+		g_submit_pos += n;
+		need -= n;
+	}
+
+	if (need <= 0) {
+		return;
+	}
+	if (end) {
+		submit_pcm(g_silence, min(need, SILENCE_LEN), false, true);
+		__atomic_store_n(&g_out_end, OUT_DONE, __ATOMIC_RELEASE);
+	} else {
+		g_underruns++;
+		submit_pcm(g_silence, min(need, SILENCE_LEN), false, false);
+	}
+}
+
+/**
+ * voice_cb::OnBufferEnd() - Give played frames back to ring
+ * @buf_ctx: Count of frames from ring, NULL for silence
+ *
+ * Wakes the stream thread once it has room to fill, which
+ * fill_ring() waits for a quarter of the ring to be free.
+ */
+void voice_cb::OnBufferEnd(void *buf_ctx) 
+{
+	if (!buf_ctx) {
+		return;
+	}
+	release_ring(&g_stream_ring, (uintptr_t) buf_ctx);
+	if (ring_count(&g_stream_ring) <= g_ring_frames - g_ring_frames / 4) {
+		SetEvent(g_fill_ev);
+	}
+}
 
 void voice_cb::OnBufferStart(void *buf_ctx) {}
 
@@ -125,194 +253,169 @@ static void end_com(void)
 	}
 }
 
-void play_music(int mus_i)
+/**
+ * wake_stream() - Wake stream thread if it is idle
+ *
+ * Work must be published before calling, the stream thread
+ * checks for work after marking itself idle.
+ */
+static void wake_stream(void)
 {
-	if (g_xaudio2_lib) {
-		g_mus_qi = mus_i;
+	if (__atomic_load_n(&g_stream_idle, __ATOMIC_SEQ_CST)) {
 		SetEvent(g_stream_ev);
 	}
 }
 
-void stop_music(void) 
+void play_sfx(int id)
+{
+	if (g_xaudio2_lib && queue_sfx(id) == 0) {
+		wake_stream();
+	}
+}
+
+void play_music(int mus_i)
 {
 	if (g_xaudio2_lib) {
-		g_mus_qi = MUS_NONE;
+		queue_music(mus_i);
+		wake_stream();
 	}
 }
 
-static void stop(void)
+void set_music_fade(int ms, int curve)
 {
-	g_source->Stop(0);
-	g_source->FlushSourceBuffers();
+	set_stream_fade(ms, curve);
 }
 
-static stb_vorbis *update_vorbis(stb_vorbis *vorb)
+void stop_music(void) 
 {
-	long i;
-	const wchar_t *path;
-	wchar_t full_path[260];
-	FILE *f;
-
-	i = InterlockedExchange(&g_mus_qi, MUS_INVALID);
-	if (i == MUS_INVALID) {
-		return vorb;
-	}
-
-	stb_vorbis_close(vorb);
-	path = g_music_paths[i];
-	if (i == MUS_NONE) {
-		stop();
-		return NULL;
-	} 
-
-	get_res_pathf(full_path, L"music\\%s", path);
-	f = _wfopen(full_path, L"rb");
-	if (!f) {
-		MessageBoxW(NULL, full_path, L"Error", MB_ICONERROR); 
-		fprintf(stderr, "vorbis: Failed to open %ld\n", i);
-		return NULL;
-	}
-
-	vorb = stb_vorbis_open_file(f, TRUE, NULL, NULL);
-	if (!vorb) {
-		fprintf(stderr, "vorbis: Failed to parse %ld\n", i);
-	} 
-	return vorb;
+	if (g_xaudio2_lib) {
+		queue_music(MUS_NONE);
+		wake_stream();
+	}
 }
 
 /**
- * wait_full() - Wait if all buffers are in use
+ * start() - Start source voice if not yet running
+ *
+ * Return: Zero on success, negative on failure
  */
-static void wait_full(void)
+static int start(void)
 {
-	while (1) {
-		XAUDIO2_VOICE_STATE vs;
-
-		if (g_mus_qi == MUS_NONE) {
-			stop();
-			break;
-		} 
-		g_source->GetState(&vs);
-		if (vs.BuffersQueued < NUM_SBUFS - 1) {
-			break;
+	if (!g_out_on) {
+		g_out_on = true;
+		if (FAILED(g_source->Start(0))) {
+			g_out_on = false;
+			fprintf(stderr, "audio: Start failed\n");
+			return -1;
 		}
-		WaitForSingleObject(g_buf_end_ev, SBUF_MS);
 	}
+	return 0;
 }
 
 /**
- * wait_nonempty - Wait if some buffers are in use
+ * end_out() - Stop source voice once the end of stream has played
+ * @end: OUT_DRAIN to play out the ring first, OUT_CUT to drop it
+ *
+ * Nothing is left queued on the voice afterwards, so the ring
+ * can be reset. A voice never started has nothing queued.
  */
-static void wait_nonempty(void)
+static void end_out(int end)
 {
-	XAUDIO2_VOICE_STATE vs;
-
-	while (1) {
-		g_source->GetState(&vs);
-		if (vs.BuffersQueued <= 0) {
-			break;
-		}
-		WaitForSingleObject(g_buf_end_ev, SBUF_MS);
+	if (end == OUT_DRAIN) {
+		start();
+	}
+	if (g_out_on) {
+		__atomic_store_n(&g_out_end, end, __ATOMIC_RELEASE);
+		WaitForSingleObject(g_end_ev, OUT_WAIT_MS);
+		g_out_on = false;
+		g_source->Stop(0);
 	}
+	g_out_end = OUT_PLAY;
+	g_submit_pos = 0;
 }
 
-static int get_samples(stb_vorbis *vorb, short *buf)
+/**
+ * update_audio() - Keep ring filled ahead until nothing is playing
+ *
+ * While the ring is full the stream thread waits on the callback
+ * to free room rather than on a timer.
+ */
+static void update_audio(void)
 {
-	bool zero;
-	int remain;
-
-	zero = false;
-	remain = SBUF_LEN;
-	while (remain > 0) {
-		int count;
-
-		count = stb_vorbis_get_samples_short(vorb, 1, &buf, remain);
-		if (count <= 0) {
-			if (zero) {
-				return -1;
+	g_underruns = 0;
+	while (update_stream() > 0) {
+		if (!fill_stream()) {
+			if (start() < 0) {
+				break;
 			}
-			zero = true;
-                    	stb_vorbis_seek_start(vorb);
-		} else {
-			remain -= count;
+			WaitForSingleObject(g_fill_ev, OUT_WAIT_MS);
 		}
 	}
 
-	return SBUF_LEN - remain;
+	/*play out what is left unless music was stopped*/
+	end_out(drain_stream() ? OUT_DRAIN : OUT_CUT);
+	reset_stream(g_underruns);
 }
 
-static void update_audio(void)
+/**
+ * close_events() - Close events of stream thread, safe if not created
+ */
+static void close_events(void)
 {
-	sbuf *bufs;
-	stb_vorbis *vorb;
+	HANDLE *evs[] = {&g_stream_ev, &g_fill_ev, &g_end_ev};
 	int i;
 
-	bufs = (sbuf *) malloc(NUM_SBUFS * sizeof(*bufs)); 
-	if (!bufs) {
-		fprintf(stderr, "music: OOM\n");
-		return;
-	}
-
-	vorb = NULL;
-	i = 0;
-	while (1) {
-		short *buf;
-		int count;
-		XAUDIO2_BUFFER xbuf;
-		HRESULT hr;
-
-		vorb = update_vorbis(vorb);
-		if (!vorb) {
-			break;
+	for (i = 0; i < 3; i++) {
+		if (*evs[i]) {
+			CloseHandle(*evs[i]);
+			*evs[i] = NULL;
 		}
+	}
+}
 
-		buf = bufs[i]; 
-		count = get_samples(vorb, buf);
-		if (count < 0) {
-			break;
-		}
-
-		memset(&xbuf, 0, sizeof(xbuf));
-		xbuf.Flags = XAUDIO2_END_OF_STREAM; 
-		xbuf.pAudioData = (BYTE *) buf;
-		xbuf.AudioBytes = count * 2; 
-
-		hr = g_source->SubmitSourceBuffer(&xbuf);
-		if (FAILED(hr)) {
-			fprintf(stderr, "music: SubmitSourceBuffer failed\n");
-			break;
-		}
+static DWORD stream_proc(LPVOID ctx)
+{
+	UNREFERENCED_PARAMETER(ctx);
 
-		hr = g_source->Start(0);
-		if (FAILED(hr)) {
-			fprintf(stderr, "music: Start failed\n");
+	while (1) {
+		__atomic_store_n(&g_stream_idle, true, __ATOMIC_SEQ_CST);
+		if (!stream_has_work() && WaitForSingleObject(g_stream_ev, 
+				INFINITE) != WAIT_OBJECT_0) {
 			break;
 		}
-
-		i++;
-		if (i >= NUM_SBUFS) {
-			i = 0;
-		}
-		wait_full();
+		g_stream_idle = false;
+		update_audio();
 	}
 
-	stb_vorbis_close(vorb);
-	wait_nonempty();
-	free(bufs);
+	return 0;
 }
 
-static DWORD stream_proc(LPVOID ctx)
+/**
+ * load_track() - Map track and ready its decoders
+ * @i: MUS_* of track
+ *
+ * Track is left unmapped on failure.
+ */
+static void load_track(int i)
 {
-	UNREFERENCED_PARAMETER(ctx);
+	wchar_t path[MAX_PATH];
+	mapped_file *mf;
 
-	while (WaitForSingleObject(g_stream_ev, INFINITE) == WAIT_OBJECT_0) {
-		update_audio();
+	mf = g_mus_files + i;
+	get_res_pathf(path, L"music\\%s", g_music_paths[i]);
+	if (map_file(mf, path) < 0) {
+		err_wnd(NULL, path);
+		return;
 	}
+	prefetch_file(mf);
 
-	return 0;
+	if (load_stream_track(i, mf->data, mf->size) < 0) {
+		fprintf(stderr, "vorbis: Failed to load %d\n", i);
+		unmap_file(mf);
+	}
 }
 
-int init_xaudio2(void)
+int init_xaudio2(int ring_ms)
 {
 	static const char *const paths[] = {
 		"XAudio2_9.dll",
@@ -328,9 +431,11 @@ int init_xaudio2(void)
 
 	static voice_cb vcb;
 
+	XAUDIO2_VOICE_DETAILS details;
 	FARPROC proc;
 	xaudio2_create_fn *xaudio2_create;
 	HRESULT hr;
+	int i;
 
 	if (start_com() < 0) {
 		return -1;
@@ -356,32 +461,51 @@ int init_xaudio2(void)
 		goto release_xaudio2;
 	}
 
+	/*convert to the device rate here rather than in XAudio2*/
+	g_master->GetVoiceDetails(&details);
+	g_out_rate = details.InputSampleRate;
+	g_wave_fmt.nSamplesPerSec = g_out_rate;
+	g_wave_fmt.nAvgBytesPerSec = g_out_rate * 4;
+
     	hr = g_xaudio2->CreateSourceVoice(&g_source, &g_wave_fmt, 0, 
 			XAUDIO2_DEFAULT_FREQ_RATIO, &vcb, NULL, NULL);
 	if (FAILED(hr)) {
 		goto release_xaudio2;
 	}
 
-	g_buf_end_ev = CreateEvent(NULL, FALSE, FALSE, NULL);
-	if (!g_buf_end_ev) {
+	g_ring_frames = ring_ms * g_out_rate / 1000;
+	if (init_stream(g_out_rate, g_ring_frames) < 0) {
 		goto release_xaudio2;
 	}
 
 	g_stream_ev = CreateEvent(NULL, FALSE, FALSE, NULL);
-	if (!g_stream_ev) {
-		goto close_buf_end_ev;
+	g_fill_ev = CreateEvent(NULL, FALSE, FALSE, NULL);
+	g_end_ev = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (!g_stream_ev || !g_fill_ev || !g_end_ev) {
+		goto close_events;
+	}
+
+	/*tracks that fail to load only fail when played*/
+	for (i = 0; i < COUNTOF_MUS; i++) {
+		load_track(i);
 	}
 
 	g_stream_thrd = CreateThread(NULL, 0, stream_proc, NULL, 0, 0);
 	if (!g_stream_thrd) {
-		goto close_stream_ev;
+		goto unmap_music;
 	}	
 
+	/*effects are optional, audio works without them*/
+	init_sfx_load();
+
 	return 0;
-close_stream_ev:
-	CloseHandle(g_stream_ev);
-close_buf_end_ev:
-	CloseHandle(g_buf_end_ev);
+unmap_music:
+	for (i = 0; i < COUNTOF_MUS; i++) {
+		unmap_file(g_mus_files + i);
+	}
+close_events:
+	close_events();
+	end_stream();
 release_xaudio2:
 	g_xaudio2->Release();
 free_lib:
@@ -395,11 +519,17 @@ end_com:
 
 void end_xaudio2(void)
 {
+	int i;
+
 	if (g_xaudio2_lib) { 
 		TerminateThread(g_stream_thrd, 0);
 		CloseHandle(g_stream_thrd);
-		CloseHandle(g_stream_ev);
-		CloseHandle(g_buf_end_ev);
+		end_sfx_load();
+		end_stream();
+		for (i = 0; i < COUNTOF_MUS; i++) {
+			unmap_file(g_mus_files + i);
+		}
+		close_events();
 		g_xaudio2->Release();
 		FreeLibrary(g_xaudio2_lib);
 		g_xaudio2_lib = NULL;
@@ -1,17 +1,59 @@
+#include "music.hpp"
+
 #define MUS_SAPPHIRE_LAKE 0
 #define COUNTOF_MUS 1
 
+#define SFX_JUMP 0
+#define SFX_HIT 1
+#define SFX_ATTACK 2
+#define COUNTOF_SFX 3
+
+/**
+ * Default depth of audio ring in milliseconds
+ */
+#define AUDIO_RING_MS 100
+
 /**
  * init_xaudio2() - Init sound engine
+ * @ring_ms: Milliseconds of audio mixed ahead of playback
  *
  * Retrun: Return zero and success and negative on failure
  */
-int init_xaudio2(void);
+int init_xaudio2(int ring_ms);
 
 /**
  * end_xaudio2() - End xaudio2 engine
  */
 void end_xaudio2(void);
 
+/**
+ * Default length of cross fade between tracks in milliseconds
+ */
+#define MUSIC_FADE_MS 1000
+
+/**
+ * play_music() - Switch to track, cross fading from music playing
+ * @mus_i: MUS_* of track
+ */
 void play_music(int mus_i);
+
+/**
+ * set_music_fade() - Set cross fade used by later switches
+ * @ms: Length of cross fade in milliseconds
+ * @curve: FADE_* shape of cross fade
+ */
+void set_music_fade(int ms, int curve);
+
+/**
+ * stop_music() - Cut music and sound effects, dropping queued audio
+ */
 void stop_music(void);
+
+/**
+ * play_sfx() - Queue sound effect to be started by the audio thread
+ * @id: SFX_* to play
+ *
+ * Does no decoding or allocation, only called from game thread.
+ * Dropped if the clip is not resident or too many are queued.
+ */
+void play_sfx(int id);
@@ -0,0 +1,110 @@
+#include <math.h>
+#include <string.h>
+
+#include "bot.hpp"
+#include "entity.hpp"
+#include "perf.hpp"
+
+/**
+ * Captain has made no progress if it moved less than this many tiles
+ */
+#define BOT_STUCK_DIST 0.05F
+
+/**
+ * Seconds without progress before jumping and before turning around
+ */
+#define BOT_STUCK_JUMP 0.2F
+#define BOT_STUCK_TURN 1.5F
+
+#define BOT_JUMP_HOLD 0.25F
+
+/**
+ * next_rand() - Advance xorshift generator
+ * @b: Bot
+ *
+ * Return: Next random value
+ */
+static uint32_t next_rand(bot *b)
+{
+	b->rng ^= b->rng << 13;
+	b->rng ^= b->rng >> 17;
+	b->rng ^= b->rng << 5;
+	return b->rng;
+}
+
+/**
+ * rand_range() - Random float in range
+ * @b: Bot
+ * @lo: Lower bound
+ * @hi: Upper bound
+ *
+ * Return: Random value from lo to hi
+ */
+static float rand_range(bot *b, float lo, float hi)
+{
+	return lo + (hi - lo) * (next_rand(b) >> 8) * (1.0F / (1 << 24));
+}
+
+void init_bot(bot *b, uint32_t seed, int64_t start)
+{
+	memset(b, 0, sizeof(*b));
+
+	/*xorshift must never be zero*/
+	b->rng = seed ? seed : 0x9E3779B9;
+	b->freq = query_perf_freq();
+	b->last = start;
+	b->last_x = NAN;
+	b->turn = rand_range(b, 2.0F, 6.0F);
+	b->hop = rand_range(b, 0.5F, 3.0F);
+	b->dir = next_rand(b) & 1 ? 1 : -1;
+}
+
+void poll_bot(void *ctx, int64_t stamp)
+{
+	bot *b;
+	const entity *e;
+	float dt;
+	bool want[COUNTOF_BT];
+	int i;
+
+	b = (bot *) ctx;
+	e = get_captain();
+	if (!e || stamp <= b->last) {
+		return;
+	}
+	dt = (stamp - b->last) / (float) b->freq;
+	b->last = stamp;
+
+	if (fabsf(e->pos.x - b->last_x) < BOT_STUCK_DIST) {
+		b->stuck += dt;
+	} else {
+		b->stuck = 0.0F;
+		b->last_x = e->pos.x;
+	}
+	b->turn -= dt;
+	b->hop -= dt;
+	b->jump -= dt;
+
+	if (b->stuck > BOT_STUCK_TURN || b->turn <= 0.0F) {
+		b->dir = -b->dir;
+		b->stuck = 0.0F;
+		b->turn = rand_range(b, 2.0F, 6.0F);
+	}
+
+	/*jump is only counted when pressed, so release it first*/
+	if (!b->held[BT_JUMP] && (b->stuck > BOT_STUCK_JUMP ||
+			b->hop <= 0.0F)) {
+		b->jump = BOT_JUMP_HOLD;
+		b->hop = rand_range(b, 0.5F, 3.0F);
+	}
+
+	want[BT_LEFT] = b->dir < 0;
+	want[BT_RIGHT] = b->dir > 0;
+	want[BT_JUMP] = b->jump > 0.0F;
+	for (i = 0; i < COUNTOF_BT; i++) {
+		if (want[i] != b->held[i]) {
+			push_button(i, want[i], stamp);
+			b->held[i] = want[i];
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef BOT_HPP
+#define BOT_HPP
+
+#include <stdint.h>
+
+#include "input.hpp"
+
+/**
+ * bot - Input source that plays the captain
+ * @rng: State of xorshift generator
+ * @freq: Frequency of performance counter
+ * @last: Performance counter of last poll
+ * @last_x: Position captain last made progress from
+ * @stuck: Seconds since captain last made progress
+ * @turn: Seconds till direction is reversed
+ * @hop: Seconds till next jump
+ * @jump: Seconds jump is still held for
+ * @dir: Direction walked in, -1 left or 1 right
+ * @held: Buttons currently held
+ *
+ * Timers run on the stamps given to poll_bot(), so a seed plays
+ * the same whether the game runs in real time or headless.
+ */
+struct bot {
+	uint32_t rng;
+	int64_t freq;
+	int64_t last;
+	float last_x;
+	float stuck;
+	float turn;
+	float hop;
+	float jump;
+	int dir;
+	bool held[COUNTOF_BT];
+};
+
+/**
+ * init_bot() - Initialize bot
+ * @b: Bot to initialize
+ * @seed: Seed of decisions, any value
+ * @start: Performance counter bot starts at
+ */
+void init_bot(bot *b, uint32_t seed, int64_t start);
+
+/**
+ * poll_bot() - Queue buttons bot changed, an input_poll_fn
+ * @ctx: Bot
+ * @stamp: Performance counter of poll
+ */
+void poll_bot(void *ctx, int64_t stamp);
+
+#endif
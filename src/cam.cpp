@@ -0,0 +1,40 @@
+#include "cam.hpp"
+
+rect g_cam = {0, 0, VIEW_TW, VIEW_TH}; 
+
+/**
+ * bound_coord() - Bound coordinate inside camera
+ * @v: Camera value to bound
+ * @gm: Dimension of game map
+ * @cam: Dimension of camera
+ *
+ * Return: 
+ * Return -1 if bounded left
+ * Return 1 if bounded right
+ * Return 0 if no bound needed
+ */
+static int bound_coord(float *v, float gm, float cam)
+{
+	float dif;
+
+	dif = gm - cam;
+
+	if (*v < 0.0F || dif < 0.0F) {
+		*v = 0.0F;
+		return -1;
+	} 
+
+	if (*v > dif) {
+		*v = dif; 
+		return 1;
+	} 
+	return 0;
+}
+
+bool bound_cam(void) 
+{
+	bool bound;
+	bound = !!bound_coord(&g_cam.x, g_gm->w, g_cam.w); 
+	bound_coord(&g_cam.y, g_gm->h, g_cam.h);
+	return bound;
+}
@@ -0,0 +1,37 @@
+#ifndef CAM_HPP
+#define CAM_HPP
+
+#include "game-map.hpp"
+
+#define TILE_LEN 32 
+
+#define VIEW_TW 8
+#define VIEW_TH 6
+
+/**
+ * rect - Rectangle 
+ * @x: left-most pos 
+ * @y: top-most pos 
+ * @w: width
+ * @h: height
+ */
+struct rect {
+	float x;
+	float y;
+	float w;
+	float h;
+};
+
+/**
+ * g_cam - Camera rect in tiles, moved by the simulation
+ */
+extern rect g_cam;
+
+/**
+ * bound_cam() - Bounds camera to inside borders 
+ *
+ * Return: Returns true if camera position changed
+ */
+bool bound_cam(void); 
+
+#endif
@@ -0,0 +1,151 @@
+#include <stdint.h>
+#include <string.h>
+#include <xinput.h>
+
+#include "device.hpp"
+#include "win32.hpp"
+
+static const uint16_t g_bt_to_gp[] = {
+	[BT_LEFT] = XINPUT_GAMEPAD_DPAD_LEFT,
+	[BT_RIGHT] = XINPUT_GAMEPAD_DPAD_RIGHT,
+	[BT_JUMP] = XINPUT_GAMEPAD_A
+};
+
+static const uint8_t g_bt_to_key[] = {
+	[BT_LEFT] = VK_LEFT,
+	[BT_RIGHT] = VK_RIGHT,
+	[BT_JUMP] = 'Z' 
+};
+
+int g_key_down[256];
+
+/**
+ * @g_pad: Gamepad buttons seen at last poll
+ */
+static uint16_t g_pad;
+
+typedef DWORD WINAPI xinput_get_state_fn(DWORD, XINPUT_STATE *);
+
+static DWORD WINAPI xinput_get_state_stub(DWORD ui, XINPUT_STATE *xs);
+xinput_get_state_fn *g_xinput_get_state = xinput_get_state_stub;
+
+static DWORD WINAPI xinput_get_state_stub(DWORD ui, XINPUT_STATE *xs)
+{
+	UNREFERENCED_PARAMETER(ui);
+	UNREFERENCED_PARAMETER(xs);
+	return ERROR_DEVICE_NOT_CONNECTED;
+}
+
+void init_devices(void)
+{
+	static const char *const paths[] = {
+		"xinput1_4.dll",
+		"xinput1_3.dll",
+		"xinput9_1_0.dll",
+		NULL
+	};
+
+	static const char *const names[] = {
+		"XInputGetState",
+		NULL
+	};
+
+	HMODULE lib;
+	FARPROC proc;
+
+	lib = load_procs_ver(paths, names, &proc);
+	if (lib) {
+		g_xinput_get_state = (xinput_get_state_fn *) proc;
+	}
+}
+
+static uint16_t unify_xinput(void)
+{
+	XINPUT_STATE xs;
+	XINPUT_GAMEPAD *gp;	
+
+	if (g_xinput_get_state(0, &xs) != ERROR_SUCCESS) {
+		return 0;
+	}
+
+	gp = &xs.Gamepad;
+        if (gp->sThumbLY > XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) {
+            gp->wButtons |= XINPUT_GAMEPAD_DPAD_UP;
+        } 
+        if (gp->sThumbLX < -XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) {
+            gp->wButtons |= XINPUT_GAMEPAD_DPAD_LEFT;
+        }
+        if (gp->sThumbLY < -XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) {
+            gp->wButtons |= XINPUT_GAMEPAD_DPAD_DOWN;
+        }
+        if (gp->sThumbLX > XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) {
+            gp->wButtons |= XINPUT_GAMEPAD_DPAD_RIGHT;
+        } 
+
+	return gp->wButtons;
+}
+
+void push_key(int vk, bool down, int64_t stamp)
+{
+	int i;
+
+	if (down) {
+		g_key_down[vk]++;
+	} else {
+		g_key_down[vk] = 0;
+	}
+
+	/*ignore auto repeat*/
+	if (get_input_src() != &g_device_input ||
+			(down && g_key_down[vk] > 1)) {
+		return;
+	}
+	for (i = 0; i < COUNTOF_BT; i++) {
+		if (g_bt_to_key[i] == vk) {
+			push_input(i, SRC_KEY, down, stamp);
+		}
+	}
+}
+
+/**
+ * poll_devices() - Queue changes of gamepad since last poll
+ * @ctx: Unused
+ * @stamp: Performance counter of poll
+ *
+ * Keys are queued by the window procedure instead.
+ */
+static void poll_devices(void *ctx, int64_t stamp)
+{
+	uint16_t wb;
+	uint16_t changed;
+	int i;
+
+	UNREFERENCED_PARAMETER(ctx);
+
+	wb = unify_xinput();
+	changed = wb ^ g_pad;
+	g_pad = wb;
+	for (i = 0; i < COUNTOF_BT; i++) {
+		if (changed & g_bt_to_gp[i]) {
+			push_input(i, SRC_GAMEPAD, wb & g_bt_to_gp[i], stamp);
+		}
+	}
+}
+
+/**
+ * clear_devices() - Forget held keys and gamepad buttons
+ * @ctx: Unused
+ */
+static void clear_devices(void *ctx)
+{
+	UNREFERENCED_PARAMETER(ctx);
+
+	memset(g_key_down, 0, sizeof(g_key_down));
+	g_pad = 0;
+}
+
+const input_src g_device_input = {
+	.poll = poll_devices,
+	.clear = clear_devices,
+	.ctx = NULL
+};
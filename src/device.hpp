@@ -0,0 +1,31 @@
+#ifndef DEVICE_HPP
+#define DEVICE_HPP
+
+#include <stdint.h>
+
+#include "input.hpp"
+
+extern int g_key_down[256];
+
+/**
+ * g_device_input - Keyboard and gamepad, the default source
+ */
+extern const input_src g_device_input;
+
+/**
+ * init_devices() - Load gamepad library
+ */
+void init_devices(void);
+
+/**
+ * push_key() - Queue change of key from window procedure
+ * @vk: Virtual key
+ * @down: Key is down
+ * @stamp: Performance counter when message was received
+ *
+ * g_key_down is updated at once, buttons only change when
+ * the event is applied. Only queued while reading devices.
+ */
+void push_key(int vk, bool down, int64_t stamp);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef DL_HPP
 #define DL_HPP
 
+#include <stddef.h>
 #include <stdlib.h>
 
 /**
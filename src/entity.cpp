@@ -1,8 +1,10 @@
 #include <math.h>
+#include <stdio.h>
 
+#include "audio.hpp"
+#include "cam.hpp"
 #include "input.hpp"
-#include "render.hpp"
-#include "win32.hpp"
+#include "map-algo.hpp"
 
 #define TLF 1
 #define TRF 2
@@ -24,6 +26,41 @@ const uint8_t g_def_anims[COUNTOF_EM] = {
 	[EM_CRABBY] = ANIM_CRABBY_IDLE
 };
 
+/**
+ * no_sfx() - Play no sound effect, used with no host
+ * @id: Unused
+ */
+static void no_sfx(int id)
+{
+}
+
+/**
+ * no_tiles() - Redraw no tiles, used with no host
+ * @l: Unused
+ * @t: Unused
+ * @r: Unused
+ * @b: Unused
+ */
+static void no_tiles(int l, int t, int r, int b)
+{
+}
+
+/**
+ * print_err() - Print error to standard error, used with no host
+ * @err: Error message
+ */
+static void print_err(const wchar_t *err)
+{
+	fprintf(stderr, "entity: %ls\n", err);
+}
+
+static const entity_host g_no_host = {
+	.play_sfx = no_sfx,
+	.invalidate_tiles = no_tiles,
+	.err = print_err
+};
+
+static const entity_host *g_host = &g_no_host;
 static entity *g_captain;
 static float g_focus;
 
@@ -73,6 +110,11 @@ static void set_animation(entity *e, int aid)
 	e->sprite = a->start;
 }
 
+void set_entity_host(const entity_host *host)
+{
+	g_host = host ? host : &g_no_host;
+}
+
 entity *create_entity(int tx, int ty, uint8_t em)
 {
 	entity *e;
@@ -103,7 +145,7 @@ void destroy_entity(entity *e)
 	free(e);
 }
 
-static int spawn_entity(int x, int y)
+static void spawn_entity(int x, int y)
 {
 	uint8_t *tile;
 	int em;
@@ -111,43 +153,51 @@ static int spawn_entity(int x, int y)
 
 	tile = &g_gm->rows[y][x]; 
 	em = g_tile_to_em[*tile];
-	if (em == EM_INVALID) {
-		return 0;
-	}
 	e = create_entity(x, y, em); 
 	if (em == EM_CAPTAIN) {
-		if (g_captain) {
-			err_wnd(g_wnd, L"Too many captains");
-			return -1;
-		}
 		g_captain = e;
 	}
 	*tile = 0;
-	return 1;
+	g_host->invalidate_tiles(x, y, x, y);
 }
 
 int start_entities(void)
 {
+	unsigned spawns;
+	int captains;
+	int t;
 	int y;
 
-	for (y = 0; y < g_gm->h; y++) {
-		int x;
+	/*captains are counted first, so a bad map spawns nothing*/
+	captains = count_tiles(g_gm, TILE_BIT(TILE_CAPTAIN));
+	if (captains > 1) {
+		g_host->err(L"Too many captains");
+		return -1;
+	}
+	if (!captains) {
+		g_host->err(L"No captain found");
+		return -1;
+	}
 
-		for (x = 0; x < g_gm->w; x++) {
-			if (spawn_entity(x, y) < 0) {
-				goto end;
-			}
+	spawns = 0;
+	for (t = 0; t < COUNTOF_TILES; t++) {
+		if (g_tile_to_em[t] != EM_INVALID) {
+			spawns |= TILE_BIT(t);
 		}
 	}
 
-	if (!g_captain) {
-		err_wnd(g_wnd, L"No captain found");
-		goto end;
+	for (y = 0; y < g_gm->h; y++) {
+		const uint8_t *row;
+		int x;
+
+		row = g_gm->rows[y];
+		x = find_tiles(row, 0, g_gm->w, spawns);
+		while (x < g_gm->w) {
+			spawn_entity(x, y);
+			x = find_tiles(row, x + 1, g_gm->w, spawns);
+		}
 	}
 	return 0;
-end:
-	end_entities();
-	return -1;
 }
 
 /**
@@ -404,6 +454,32 @@ static void update_cam(entity *e)
 	}
 }
 
+/**
+ * touch_enemy() - Check if entity overlaps any other entity
+ * @e: Entity to check
+ */
+static bool touch_enemy(const entity *e)
+{
+	box ebox;
+	entity *o;
+
+	ebox = g_masks[e->em] + e->pos;
+	dl_for_each_entry(o, &g_entities, node) {
+		box obox;
+		bool horz, vert;
+
+		if (o == e) {
+			continue;
+		}
+		obox = g_masks[o->em] + o->pos;
+		horz = ebox.tl.x < obox.br.x && ebox.br.x > obox.tl.x;
+		vert = ebox.tl.y < obox.br.y && ebox.br.y > obox.tl.y;
+		if (horz && vert) {
+			return true;
+		}
+	}
+	return false;
+}
 
 /**
  * update_captain() - Update captain specific behavoir
@@ -416,6 +492,7 @@ static void update_captain(entity *e)
 	if (g_buttons[BT_JUMP] == 1 && can_jump(e)) {
 		e->vel.y = -10.0F;
 		e->flags &= ~EF_GROUND;
+		g_host->play_sfx(SFX_JUMP);
 	}
 
 	if (g_buttons[BT_LEFT]) {
@@ -438,6 +515,13 @@ static void update_captain(entity *e)
 
 	update_physics(e);
 	update_cam(e);
+
+	if (!touch_enemy(e)) {
+		e->flags &= ~EF_HIT;
+	} else if (!(e->flags & EF_HIT)) {
+		e->flags |= EF_HIT;
+		g_host->play_sfx(SFX_HIT);
+	}
 }
 
 static bool crabby_to_player(entity *e)
@@ -504,7 +588,14 @@ static void crabby_walk(entity *e)
 
 static void update_crabby(entity *e)
 {
-	if (!crabby_to_player(e)) {
+	/*attack sound plays once each time crabby closes in*/
+	if (crabby_to_player(e)) {
+		if (!(e->flags & EF_ATTACK)) {
+			e->flags |= EF_ATTACK;
+			g_host->play_sfx(SFX_ATTACK);
+		}
+	} else {
+		e->flags &= ~EF_ATTACK;
 		crabby_walk(e);
 	}
 	idle_or_run_anim(e, ANIM_CRABBY_RUN, ANIM_CRABBY_IDLE);
@@ -550,7 +641,13 @@ void clear_entities(void)
 
 		tile = g_gm->rows[e->spawn.y] + e->spawn.x;
 		*tile = g_em_to_tile[e->em];
+		g_host->invalidate_tiles(e->spawn.x, e->spawn.y,
+				e->spawn.x, e->spawn.y);
 		destroy_entity(e);
 	}
 }
 
+const entity *get_captain(void)
+{
+	return g_captain;
+}
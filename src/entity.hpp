@@ -14,6 +14,8 @@
 #define EF_FLIP 1
 #define EF_GROUND 2
 #define EF_CEIL 4
+#define EF_HIT 8
+#define EF_ATTACK 16
 
 /**
  * struct box - Box
@@ -48,8 +50,8 @@ struct entity {
 	float health;
 	float anim_time;
 	v2i spawn;
+	uint16_t sprite;	
 	uint8_t flags;
-	uint8_t sprite;	
 	uint8_t anim;
 	uint8_t em;
 };
@@ -63,6 +65,18 @@ extern float g_dt;
 extern dl_head g_entities;
 extern const uint8_t g_def_anims[COUNTOF_EM]; 
 
+/**
+ * entity_host - Effects of entities outside of the simulation
+ * @play_sfx: Play SFX_*
+ * @invalidate_tiles: Redraw tiles from l, t to r, b inclusive
+ * @err: Show why entities could not start
+ */
+struct entity_host {
+	void (*play_sfx)(int id);
+	void (*invalidate_tiles)(int l, int t, int r, int b);
+	void (*err)(const wchar_t *err);
+};
+
 /**
  * operator+ - Offset box by 2D vector
  * @b: Box to offset
@@ -75,6 +89,15 @@ inline box operator+(box b, v2 v)
 	return (box) {b.tl + v, b.br + v};
 }
 
+/**
+ * set_entity_host() - Set where effects of entities go
+ * @host: Host of entities, NULL for none
+ *
+ * With no host nothing is played or redrawn, and errors are
+ * printed to standard error, as when simulating headless.
+ */
+void set_entity_host(const entity_host *host);
+
 /**
  * create_entity() - Creates an entity
  * @tx: Spawn x-pos
@@ -91,7 +114,7 @@ entity *create_entity(int tx, int ty, uint8_t meta, float health, float max_heal
  *
  * Return: Returns zero on success and negative on failure
  *
- * Failure occurs if no player is found
+ * Failure occurs unless exactly one player is found
 */
 int start_entities(void);
 
@@ -116,4 +139,11 @@ void destroy_entity(entity *e);
  */
 void clear_entities(void);
 
+/**
+ * get_captain() - Entity controlled by player
+ *
+ * Return: The captain, NULL if entities are not started
+ */
+const entity *get_captain(void);
+
 #endif
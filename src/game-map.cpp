@@ -1,11 +1,10 @@
 #include <string.h>
 
-#include "menu.hpp"
 #include "game-map.hpp"
 #include "util.hpp"
 #include "sprites.hpp"
 
-uint8_t g_tile_to_spr[COUNTOF_TILES] = {
+uint16_t g_tile_to_spr[COUNTOF_TILES] = {
 	[TILE_BLANK] = SPR_INVALID,
 	[TILE_SOLID] = SPR_INVALID, 
 	[TILE_GRASS] = SPR_GRASS, 
@@ -27,17 +26,6 @@ const uint8_t g_em_to_tile[COUNTOF_EM] = {
 	[EM_CAPTAIN] = TILE_CAPTAIN, 
 	[EM_CRABBY] = TILE_CRABBY
 };
-
-const uint8_t g_idm_to_tile[] = {
-	[IDM_BLANK - IDM_BLANK] = TILE_BLANK,
-	[IDM_GRASS - IDM_BLANK] = TILE_GRASS,
-	[IDM_GROUND - IDM_BLANK] = TILE_GROUND
-};
-
-const uint8_t g_idm_to_entity[] = {
-	[IDM_PLAYER - IDM_PLAYER] = TILE_CAPTAIN,
-	[IDM_CRABBY - IDM_PLAYER] = TILE_CRABBY
-};
 	
 /*redudant table*/
 uint8_t g_tile_to_em[COUNTOF_TILES];
@@ -152,6 +140,46 @@ void destroy_game_map(game_map *gm)
 	free(gm);
 }
 
+void grow_box(tile_box *dst, int l, int t, int r, int b)
+{
+	if (l > r || t > b) {
+		return;
+	}
+	if (dst->l > dst->r || dst->t > dst->b) {
+		dst->l = l;
+		dst->t = t;
+		dst->r = r;
+		dst->b = b;
+	} else {
+		dst->l = min(dst->l, l);
+		dst->t = min(dst->t, t);
+		dst->r = max(dst->r, r);
+		dst->b = max(dst->b, b);
+	}
+}
+
+bool copy_stamp(stamp *s, const game_map *gm, const tile_box *box)
+{
+	int l, t, r, b;
+	int y;
+
+	l = max(box->l, 0);
+	t = max(box->t, 0);
+	r = min(box->r, gm->w - 1);
+	b = min(box->b, gm->h - 1);
+	if (l > r || t > b) {
+		return false;
+	}
+
+	s->w = r - l + 1;
+	s->h = b - t + 1;
+	s->tiles = (uint8_t *) xrealloc(s->tiles, s->w * s->h);
+	for (y = t; y <= b; y++) {
+		memcpy(s->tiles + (y - t) * s->w, gm->rows[y] + l, s->w);
+	}
+	return true;
+}
+
 uint8_t get_tile(float x, float y)
 {
 	if (y < 0.0F) {
@@ -26,16 +26,29 @@ struct game_map {
 	int h;
 };
 
-extern uint8_t g_tile_to_spr[COUNTOF_TILES];
+/**
+ * tile_box - Inclusive rect of tiles
+ * @l: Left-most tile
+ * @t: Top-most tile
+ * @r: Right-most tile
+ * @b: Bottom-most tile
+ *
+ * Box is empty if l > r or t > b.
+ */
+struct tile_box {
+	int l;
+	int t;
+	int r;
+	int b;
+};
+
+extern uint16_t g_tile_to_spr[COUNTOF_TILES];
 extern const uint8_t g_tile_props[COUNTOF_TILES];
 
 extern const uint8_t g_em_to_tile[COUNTOF_EM];
 extern uint8_t g_tile_to_em[COUNTOF_TILES];
 extern uint8_t g_anim_to_tile[COUNTOF_ANIM];
 
-extern const uint8_t g_idm_to_tile[];
-extern const uint8_t g_idm_to_entity[];
-
 extern game_map *g_gm;
 
 /**
@@ -65,6 +78,50 @@ void size_game_map(game_map *gm, int w, int h);
  */
 void destroy_game_map(game_map *gm);
 
+/**
+ * stamp - Tiles copied out of a map
+ * @tiles: Rows of tiles, packed
+ * @w: Width
+ * @h: Height
+ */
+struct stamp {
+	uint8_t *tiles;
+	int w;
+	int h;
+};
+
+/**
+ * empty_box() - Get box with no tiles
+ *
+ * Return: Empty box
+ */
+inline tile_box empty_box(void)
+{
+	return (tile_box) {0, 0, -1, -1};
+}
+
+/**
+ * grow_box() - Grow box to contain another
+ * @dst: Box to grow
+ * @l: Left of other box
+ * @t: Top of other box
+ * @r: Right of other box
+ * @b: Bottom of other box
+ *
+ * Growing by an empty box does nothing.
+ */
+void grow_box(tile_box *dst, int l, int t, int r, int b);
+
+/**
+ * copy_stamp() - Copy box of map into stamp
+ * @s: Stamp to copy into, reuses its tiles
+ * @gm: Game map
+ * @box: Tiles to copy, clamped to map
+ *
+ * Return: True if any tile was copied
+ */
+bool copy_stamp(stamp *s, const game_map *gm, const tile_box *box);
+
 /**
  * get_tile() - get a tile at a given coordninate
  * @x: x coordinate in tiles
@@ -1,94 +1,182 @@
+#include <limits.h>
 #include <stdint.h>
-#include <xinput.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "input.hpp"
-#include "win32.hpp"
-
-static const uint16_t g_bt_to_gp[] = {
-	[BT_LEFT] = XINPUT_GAMEPAD_DPAD_LEFT,
-	[BT_RIGHT] = XINPUT_GAMEPAD_DPAD_RIGHT,
-	[BT_JUMP] = XINPUT_GAMEPAD_A
-};
-
-static const uint8_t g_bt_to_key[] = {
-	[BT_LEFT] = VK_LEFT,
-	[BT_RIGHT] = VK_RIGHT,
-	[BT_JUMP] = 'Z' 
+#include "perf.hpp"
+
+/**
+ * Most events waiting to be applied, a power of two
+ */
+#define MAX_INPUT_EVENTS 256
+
+/**
+ * Buckets of latency histogram, each LAT_BIN_US wide, the last
+ * holds every slower event
+ */
+#define LAT_BINS 64
+#define LAT_BIN_US 500
+
+/**
+ * input_event - Change of button from one source
+ * @stamp: Performance counter when change was seen
+ * @bt: BT_* that changed
+ * @src: SRC_* that changed
+ * @down: Button is now down
+ */
+struct input_event {
+	int64_t stamp;
+	uint8_t bt;
+	uint8_t src;
+	bool down;
 };
 
-int g_key_down[256];
 int g_buttons[COUNTOF_BT];
 
-typedef DWORD WINAPI xinput_get_state_fn(DWORD, XINPUT_STATE *);
+/**
+ * @g_events: Events waiting to be applied, in order of stamp
+ * @g_event_head: Count of events ever queued
+ * @g_event_tail: Count of events ever applied
+ * @g_held: Applied state of every button from each source
+ */
+static input_event g_events[MAX_INPUT_EVENTS];
+static uint32_t g_event_head;
+static uint32_t g_event_tail;
+static bool g_held[COUNTOF_SRC][COUNTOF_BT];
+
+static int g_lat_hist[LAT_BINS];
+static int64_t g_lat_max;
+
+/**
+ * poll_none() - Poll of source with no buttons, queues nothing
+ * @ctx: Unused
+ * @stamp: Unused
+ */
+static void poll_none(void *ctx, int64_t stamp)
+{
+}
 
-static DWORD WINAPI xinput_get_state_stub(DWORD ui, XINPUT_STATE *xs);
-xinput_get_state_fn *g_xinput_get_state = xinput_get_state_stub;
+/**
+ * g_no_input - Source read before init_input() or if it was given none
+ */
+static const input_src g_no_input = {
+	.poll = poll_none,
+	.clear = NULL,
+	.ctx = NULL
+};
 
-static DWORD WINAPI xinput_get_state_stub(DWORD ui, XINPUT_STATE *xs)
+/**
+ * @g_def_src: Source read when no other is set
+ * @g_src: Source buttons are read from
+ * @g_record: File events are written to, NULL if not recording
+ * @g_record_start: Performance counter recorded events are timed from
+ */
+static const input_src *g_def_src = &g_no_input;
+static const input_src *g_src = &g_no_input;
+static FILE *g_record;
+static int64_t g_record_start;
+
+/**
+ * pop_event() - Apply oldest event
+ * @now: Performance counter the event is applied at
+ */
+static void pop_event(int64_t now)
 {
-	UNREFERENCED_PARAMETER(ui);
-	UNREFERENCED_PARAMETER(xs);
-	return ERROR_DEVICE_NOT_CONNECTED;
+	const input_event *ev;
+	int64_t lat;
+
+	ev = g_events + (g_event_tail++ & (MAX_INPUT_EVENTS - 1));
+	g_held[ev->src][ev->bt] = ev->down;
+
+	lat = now > ev->stamp ? (now - ev->stamp) * 1000000 /
+			query_perf_freq() : 0;
+	g_lat_hist[lat < LAT_BIN_US * (LAT_BINS - 1) ?
+			lat / LAT_BIN_US : LAT_BINS - 1]++;
+	if (lat > g_lat_max) {
+		g_lat_max = lat;
+	}
 }
 
-void init_input(void)
+void push_input(int bt, int src, bool down, int64_t stamp)
 {
-	static const char *const paths[] = {
-		"xinput1_4.dll",
-		"xinput1_3.dll",
-		"xinput9_1_0.dll",
-		NULL
-	};
-
-	static const char *const names[] = {
-		"XInputGetState",
-		NULL
-	};
-
-	HMODULE lib;
-	FARPROC proc;
-
-	lib = load_procs_ver(paths, names, &proc);
-	if (lib) {
-		g_xinput_get_state = (xinput_get_state_fn *) proc;
+	input_event *ev;
+
+	if (g_event_head - g_event_tail == MAX_INPUT_EVENTS) {
+		pop_event(stamp);
+	}
+	ev = g_events + (g_event_head++ & (MAX_INPUT_EVENTS - 1));
+	ev->stamp = stamp;
+	ev->bt = bt;
+	ev->src = src;
+	ev->down = down;
+
+	if (g_record) {
+		int64_t us;
+
+		us = (stamp - g_record_start) * 1000000 / query_perf_freq();
+		fprintf(g_record, "%lld %d %d\n", (long long) us, bt, down);
 	}
 }
 
-static uint16_t unify_xinput(void)
+void init_input(const input_src *def)
 {
-	XINPUT_STATE xs;
-	XINPUT_GAMEPAD *gp;	
+	g_def_src = def ? def : &g_no_input;
+	g_src = g_def_src;
+}
 
-	if (g_xinput_get_state(0, &xs) != ERROR_SUCCESS) {
-		return 0;
+void set_input_src(const input_src *src)
+{
+	g_src = src ? src : g_def_src;
+	clear_input();
+}
+
+const input_src *get_input_src(void)
+{
+	return g_src;
+}
+
+void poll_input(int64_t stamp)
+{
+	g_src->poll(g_src->ctx, stamp);
+}
+
+void push_button(int bt, bool down, int64_t stamp)
+{
+	push_input(bt, SRC_SCRIPT, down, stamp);
+}
+
+void record_input(FILE *f, int64_t start)
+{
+	g_record = f;
+	g_record_start = start;
+}
+
+int64_t next_input(void)
+{
+	if (g_event_head == g_event_tail) {
+		return INT64_MAX;
 	}
+	return g_events[g_event_tail & (MAX_INPUT_EVENTS - 1)].stamp;
+}
+
+void apply_input(int64_t stamp)
+{
+	int64_t now;
 
-	gp = &xs.Gamepad;
-        if (gp->sThumbLY > XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) {
-            gp->wButtons |= XINPUT_GAMEPAD_DPAD_UP;
-        } 
-        if (gp->sThumbLX < -XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) {
-            gp->wButtons |= XINPUT_GAMEPAD_DPAD_LEFT;
-        }
-        if (gp->sThumbLY < -XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) {
-            gp->wButtons |= XINPUT_GAMEPAD_DPAD_DOWN;
-        }
-        if (gp->sThumbLX > XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) {
-            gp->wButtons |= XINPUT_GAMEPAD_DPAD_RIGHT;
-        } 
-
-	return gp->wButtons;
+	now = query_perf_counter();
+	while (next_input() <= stamp) {
+		pop_event(now);
+	}
 }
 
 void update_input(void)
 {
-	uint16_t wb;
 	int i;
 
-	wb = unify_xinput();
-
 	for (i = 0; i < COUNTOF_BT; i++) {
-		if (g_key_down[g_bt_to_key[i]] || (wb & g_bt_to_gp[i])) {
+		if (g_held[SRC_KEY][i] || g_held[SRC_GAMEPAD][i] ||
+				g_held[SRC_SCRIPT][i]) {
 			if (g_buttons[i] < INT_MAX) {
 				g_buttons[i]++;
 			}
@@ -100,6 +188,53 @@ void update_input(void)
 
 void clear_input(void)
 {
-	memset(g_key_down, 0, sizeof(g_key_down));
 	memset(g_buttons, 0, sizeof(g_buttons));
+	memset(g_held, 0, sizeof(g_held));
+	g_event_tail = g_event_head;
+	if (g_src->clear) {
+		g_src->clear(g_src->ctx);
+	}
+}
+
+/**
+ * lat_percentile() - Latency below which a share of events fall
+ * @count: Count of events in histogram
+ * @p: Share of events, from zero to one
+ *
+ * Return: Upper edge of bucket in microseconds
+ */
+static int lat_percentile(int count, double p)
+{
+	int sum;
+	int i;
+
+	sum = 0;
+	for (i = 0; i < LAT_BINS - 1; i++) {
+		sum += g_lat_hist[i];
+		if (sum >= count * p) {
+			break;
+		}
+	}
+	return (i + 1) * LAT_BIN_US;
+}
+
+void print_input_latency(void)
+{
+	int count;
+	int i;
+
+	count = 0;
+	for (i = 0; i < LAT_BINS; i++) {
+		count += g_lat_hist[i];
+	}
+
+	if (count) {
+		fprintf(stderr, "input: %d events, latency p50 < %.1f ms, "
+				"p99 < %.1f ms, max %.1f ms\n", count,
+				lat_percentile(count, 0.5) / 1000.0,
+				lat_percentile(count, 0.99) / 1000.0,
+				g_lat_max / 1000.0);
+	}
+	memset(g_lat_hist, 0, sizeof(g_lat_hist));
+	g_lat_max = 0;
 }
@@ -1,29 +1,136 @@
 #ifndef INPUT_HPP
 #define INPUT_HPP
 
+#include <stdint.h>
+#include <stdio.h>
+
 #define BT_LEFT 0
 #define BT_RIGHT 1
 #define BT_JUMP 2
 #define COUNTOF_BT 3
 
-extern int g_key_down[256];
+#define SRC_KEY 0
+#define SRC_GAMEPAD 1
+#define SRC_SCRIPT 2
+#define COUNTOF_SRC 3
+
+/**
+ * input_poll_fn - Queue changes of source since last poll
+ * @ctx: Context of source
+ * @stamp: Performance counter of poll
+ */
+typedef void input_poll_fn(void *ctx, int64_t stamp);
+
+/**
+ * input_clear_fn - Forget state of source when buttons are cleared
+ * @ctx: Context of source
+ */
+typedef void input_clear_fn(void *ctx);
+
+/**
+ * input_src - Backend that buttons are read from
+ * @poll: Called every frame and while waiting for the next
+ * @clear: Called by clear_input() while source is read, may be NULL
+ * @ctx: Passed to poll and clear
+ */
+struct input_src {
+	input_poll_fn *poll;
+	input_clear_fn *clear;
+	void *ctx;
+};
+
 extern int g_buttons[COUNTOF_BT];
 
 /**
  * init_input() - Initialize input
+ * @def: Source read when no other is set, NULL for none
+ */
+void init_input(const input_src *def);
+
+/**
+ * set_input_src() - Change source buttons are read from
+ * @src: Source to read from, NULL for the default of init_input()
+ */
+void set_input_src(const input_src *src);
+
+/**
+ * get_input_src() - Get source buttons are read from
+ *
+ * Return: Source being read, never NULL
+ */
+const input_src *get_input_src(void);
+
+/**
+ * poll_input() - Poll current source
+ * @stamp: Performance counter of poll
+ */
+void poll_input(int64_t stamp);
+
+/**
+ * push_input() - Queue change of button from a source
+ * @bt: BT_* that changed
+ * @src: SRC_* that changed
+ * @down: Button is now down
+ * @stamp: Performance counter of change
+ *
+ * Buttons only change when the event is applied. When the queue
+ * is full the oldest event is applied early rather than dropping
+ * a release.
+ */
+void push_input(int bt, int src, bool down, int64_t stamp);
+
+/**
+ * push_button() - Queue change of button from a scripted source
+ * @bt: BT_* that changed
+ * @down: Button is now down
+ * @stamp: Performance counter of change, not before earlier events
+ */
+void push_button(int bt, bool down, int64_t stamp);
+
+/**
+ * record_input() - Write every queued event to file
+ * @f: File to write to, NULL to stop recording
+ * @start: Performance counter events are timed from
+ *
+ * Each line is the microseconds since start, the BT_* and
+ * whether it is down, the format read by open_replay().
+ */
+void record_input(FILE *f, int64_t start);
+
+/**
+ * next_input() - Stamp of oldest queued event
+ *
+ * Return: Performance counter of event, INT64_MAX if none
  */
-void init_input(void);
+int64_t next_input(void);
 
 /**
- * update_input() - Update button values
+ * apply_input() - Apply queued events up to stamp
+ * @stamp: Performance counter to apply events up to
  *
- * NOTE: Does not update g_key_down
+ * Latency from each event to being applied is recorded.
+ */
+void apply_input(int64_t stamp);
+
+/**
+ * update_input() - Update button values for a simulation step
+ *
+ * Buttons count the steps they have been held for. Every event
+ * starts a new step, so a press is seen by at least one step
+ * however soon it is released.
  */
 void update_input(void);
 
 /**
- * clear_input() - Set buttons and keys to clear
+ * clear_input() - Set buttons to clear, dropping events
+ *
+ * Also clears the source being read, such as keys it saw held.
  */
 void clear_input(void);
 
+/**
+ * print_input_latency() - Print and reset latency of applied events
+ */
+void print_input_latency(void);
+
 #endif
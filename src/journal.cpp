@@ -0,0 +1,1009 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "journal.hpp"
+#include "map-algo.hpp"
+#include "util.hpp"
+
+#define REC_STROKE 0
+#define REC_RESIZE 1
+#define REC_ROWS 2
+#define REC_SPANS 3
+#define REC_BLIT 4
+
+/**
+ * Bytes before payload of record, type and size, and after, size
+ */
+#define REC_HEAD 5
+#define REC_TAIL 4
+
+/**
+ * Most bytes one tile of a stroke or the head of one span can take
+ */
+#define MAX_TILE_BYTES 12
+#define MAX_SPAN_BYTES 15
+
+#define NO_STROKE SIZE_MAX
+
+static uint32_t get_u32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+static uint8_t **get_rows(const uint8_t *p)
+{
+	uint8_t **rows;
+
+	memcpy(&rows, p, sizeof(rows));
+	return rows;
+}
+
+/**
+ * get_first() - First row of map moved out by resize
+ * @dims: Width and height before and after resize
+ *
+ * Rows of a resize that keeps the width are kept in the map
+ * if they are not cut, others are moved out.
+ */
+static int get_first(const uint16_t *dims)
+{
+	return dims[0] == dims[2] ? min(dims[1], dims[3]) : 0;
+}
+
+/**
+ * grow_resize() - Grow box to contain tiles a resize changes
+ * @changed: Box to grow
+ * @dims: Width and height before and after resize
+ *
+ * Covers both extents, so tiles lost and tiles gained are
+ * redrawn.
+ */
+static void grow_resize(tile_box *changed, const uint16_t *dims)
+{
+	grow_box(changed, 0, get_first(dims), max(dims[0], dims[2]) - 1,
+			max(dims[1], dims[3]) - 1);
+}
+
+/**
+ * free_record() - Free rows held by record
+ * @j: Journal
+ * @rec: Offset of record
+ *
+ * Return: Offset of next record
+ */
+static size_t free_record(journal *j, size_t rec)
+{
+	const uint8_t *p;
+	uint16_t dims[4];
+	uint8_t **rows;
+	int count;
+	int i;
+
+	p = j->data + rec + REC_HEAD;
+	switch (j->data[rec]) {
+	case REC_RESIZE:
+		memcpy(dims, p, sizeof(dims));
+		rows = get_rows(p + sizeof(dims));
+		count = dims[1] - get_first(dims);
+		if (rows && rows[0]) {
+			j->held -= (size_t) count * dims[0];
+		}
+		break;
+	case REC_ROWS:
+		memcpy(dims, p, 3 * sizeof(*dims));
+		rows = get_rows(p + 3 * sizeof(*dims));
+		count = dims[1];
+		j->held -= (size_t) count * dims[2];
+		break;
+	default:
+		rows = NULL;
+		count = 0;
+	}
+
+	if (rows) {
+		for (i = 0; i < count; i++) {
+			free(rows[i]);
+		}
+		free(rows);
+	}
+	return rec + REC_HEAD + get_u32(j->data + rec + 1) + REC_TAIL;
+}
+
+/**
+ * drop_redo() - Drop every undone record
+ * @j: Journal
+ */
+static void drop_redo(journal *j)
+{
+	size_t rec;
+
+	rec = j->cur;
+	while (rec < j->end) {
+		rec = free_record(j, rec);
+	}
+	j->end = j->cur;
+}
+
+/**
+ * put_varint() - Write signed integer in as few bytes as fit
+ * @p: Where to write
+ * @v: Value to write
+ *
+ * Return: End of written bytes
+ */
+static uint8_t *put_varint(uint8_t *p, int v)
+{
+	uint32_t u;
+
+	/*zigzag so small negatives stay small*/
+	u = ((uint32_t) v << 1) ^ (uint32_t) (v >> 31);
+	while (u >= 0x80) {
+		*p++ = u | 0x80;
+		u >>= 7;
+	}
+	*p++ = u;
+	return p;
+}
+
+/**
+ * get_varint() - Read integer written by put_varint()
+ * @p: Where to read
+ * @v: Value read
+ *
+ * Return: End of read bytes
+ */
+static const uint8_t *get_varint(const uint8_t *p, int *v)
+{
+	uint32_t u;
+	int shift;
+
+	u = 0;
+	shift = 0;
+	do {
+		u |= (uint32_t) (*p & 0x7F) << shift;
+		shift += 7;
+	} while (*p++ & 0x80);
+	*v = (u >> 1) ^ -(u & 1);
+	return p;
+}
+
+/**
+ * drop_oldest() - Drop oldest record
+ * @j: Journal
+ *
+ * Return: Zero on success, negative if no applied record is left
+ */
+static int drop_oldest(journal *j)
+{
+	if (j->head >= j->cur) {
+		return -1;
+	}
+	j->head = free_record(j, j->head);
+	return 0;
+}
+
+/**
+ * reserve() - Make room at end of journal
+ * @j: Journal
+ * @n: Bytes needed
+ *
+ * Return: End of journal, valid until next reserve
+ */
+static uint8_t *reserve(journal *j, size_t n)
+{
+	while (j->end - j->head + j->held + n > JOURNAL_BUDGET) {
+		if (drop_oldest(j) < 0) {
+			break;
+		}
+	}
+
+	if (j->end + n <= j->cap) {
+		return j->data + j->end;
+	}
+
+	if (j->head > 0 && j->head >= j->cap / 2) {
+		memmove(j->data, j->data + j->head, j->end - j->head);
+		j->cur -= j->head;
+		j->end -= j->head;
+		if (j->stroke != NO_STROKE) {
+			j->stroke -= j->head;
+		}
+		j->head = 0;
+	}
+
+	if (j->end + n > j->cap) {
+		j->cap = j->cap ? j->cap * 2 : 4096;
+		if (j->cap < j->end + n) {
+			j->cap = j->end + n;
+		}
+		j->data = (uint8_t *) xrealloc(j->data, j->cap);
+	}
+	return j->data + j->end;
+}
+
+void init_journal(journal *j)
+{
+	memset(j, 0, sizeof(*j));
+	j->stroke = NO_STROKE;
+	j->changed = empty_box();
+}
+
+void reset_journal(journal *j)
+{
+	end_stroke(j);
+	while (j->head < j->end) {
+		j->head = free_record(j, j->head);
+	}
+	j->head = 0;
+	j->cur = 0;
+	j->end = 0;
+	j->stroke = NO_STROKE;
+}
+
+/**
+ * open_record() - Start writing record after last applied record
+ * @j: Journal
+ * @type: REC_* of record, closed by end_stroke()
+ */
+static void open_record(journal *j, int type)
+{
+	uint8_t *p;
+
+	drop_redo(j);
+	p = reserve(j, REC_HEAD);
+	*p = type;
+	j->stroke = j->end;
+	j->end += REC_HEAD;
+	j->x = 0;
+	j->y = 0;
+}
+
+void end_stroke(journal *j)
+{
+	uint32_t size;
+
+	if (j->stroke == NO_STROKE) {
+		return;
+	}
+
+	size = j->end - j->stroke - REC_HEAD;
+	put_u32(j->data + j->stroke + 1, size);
+	put_u32(reserve(j, REC_TAIL), size);
+	j->end += REC_TAIL;
+	j->cur = j->end;
+	j->stroke = NO_STROKE;
+}
+
+bool record_place(journal *j, game_map *gm, int x, int y, int tile)
+{
+	uint8_t *tp;
+	uint8_t *p;
+
+	tp = gm->rows[y] + x;
+	if (*tp == tile) {
+		return false;
+	}
+
+	if (j->stroke == NO_STROKE) {
+		open_record(j, REC_STROKE);
+	}
+	p = reserve(j, MAX_TILE_BYTES);
+	p = put_varint(p, x - j->x);
+	p = put_varint(p, y - j->y);
+	*p++ = *tp;
+	*p++ = tile;
+	j->end = p - j->data;
+	j->x = x;
+	j->y = y;
+
+	*tp = tile;
+	return true;
+}
+
+/**
+ * clip_line() - Clip line to tiles of map
+ * @gm: Game map
+ * @x0: X of start of line, clipped in place
+ * @y0: Y of start of line, clipped in place
+ * @x1: X of end of line, clipped in place
+ * @y1: Y of end of line, clipped in place
+ *
+ * Clipped with Liang-Barsky, so ends only move along the line
+ * and it keeps its direction.
+ *
+ * Return: False if line misses map
+ */
+static bool clip_line(const game_map *gm, int *x0, int *y0,
+		int *x1, int *y1)
+{
+	float p[4], q[4];
+	float t0, t1;
+	int dx, dy;
+	int i;
+
+	dx = *x1 - *x0;
+	dy = *y1 - *y0;
+	p[0] = -dx;
+	q[0] = *x0;
+	p[1] = dx;
+	q[1] = gm->w - 1 - *x0;
+	p[2] = -dy;
+	q[2] = *y0;
+	p[3] = dy;
+	q[3] = gm->h - 1 - *y0;
+
+	t0 = 0.0F;
+	t1 = 1.0F;
+	for (i = 0; i < 4; i++) {
+		float r;
+
+		if (p[i] == 0.0F) {
+			if (q[i] < 0.0F) {
+				return false;
+			}
+			continue;
+		}
+		r = q[i] / p[i];
+		if (p[i] < 0.0F) {
+			t0 = fmaxf(t0, r);
+		} else {
+			t1 = fminf(t1, r);
+		}
+		if (t0 > t1) {
+			return false;
+		}
+	}
+
+	*x1 = *x0 + lroundf(t1 * dx);
+	*y1 = *y0 + lroundf(t1 * dy);
+	*x0 += lroundf(t0 * dx);
+	*y0 += lroundf(t0 * dy);
+	return true;
+}
+
+bool record_line(journal *j, game_map *gm, int x0, int y0,
+		int x1, int y1, int tile)
+{
+	int dx, dy;
+	int sx, sy;
+	int err;
+
+	j->changed = empty_box();
+	if (!clip_line(gm, &x0, &y0, &x1, &y1)) {
+		return false;
+	}
+
+	dx = abs(x1 - x0);
+	dy = -abs(y1 - y0);
+	sx = x0 < x1 ? 1 : -1;
+	sy = y0 < y1 ? 1 : -1;
+	err = dx + dy;
+	for (;;) {
+		int e2;
+
+		if (x0 >= 0 && x0 < gm->w && y0 >= 0 && y0 < gm->h &&
+				record_place(j, gm, x0, y0, tile)) {
+			grow_box(&j->changed, x0, y0, x0, y0);
+		}
+		if (x0 == x1 && y0 == y1) {
+			break;
+		}
+
+		e2 = 2 * err;
+		if (e2 >= dy) {
+			err += dy;
+			x0 += sx;
+		}
+		if (e2 <= dx) {
+			err += dx;
+			y0 += sy;
+		}
+	}
+	return j->changed.l <= j->changed.r;
+}
+
+/**
+ * write_record() - Append record after last applied record
+ * @j: Journal
+ * @type: REC_* of record
+ * @payload: Payload of record
+ * @size: Size of payload
+ */
+static void write_record(journal *j, int type, const void *payload,
+		uint32_t size)
+{
+	uint8_t *p;
+
+	end_stroke(j);
+	drop_redo(j);
+	p = reserve(j, REC_HEAD + size + REC_TAIL);
+	*p = type;
+	put_u32(p + 1, size);
+	memcpy(p + REC_HEAD, payload, size);
+	put_u32(p + REC_HEAD + size, size);
+	j->end += REC_HEAD + size + REC_TAIL;
+	j->cur = j->end;
+}
+
+/**
+ * resize_rows() - Resize map, moving rows that change out of map
+ * @j: Journal
+ * @gm: Game map
+ * @dims: Width and height before and after resize
+ * @rows: Rows moved out of map
+ */
+static void resize_rows(journal *j, game_map *gm, const uint16_t *dims,
+		uint8_t **rows)
+{
+	int first;
+	int y;
+
+	first = get_first(dims);
+	memcpy(rows, gm->rows + first, (dims[1] - first) * sizeof(*rows));
+	j->held += (size_t) (dims[1] - first) * dims[0];
+
+	gm->rows = (uint8_t **) xrealloc(gm->rows,
+			dims[3] * sizeof(*gm->rows));
+	for (y = first; y < dims[3]; y++) {
+		gm->rows[y] = (uint8_t *) xcalloc(dims[2], 1);
+		if (y < dims[1]) {
+			memcpy(gm->rows[y], rows[y - first],
+					min(dims[0], dims[2]));
+		}
+	}
+	gm->w = dims[2];
+	gm->h = dims[3];
+}
+
+void record_resize(journal *j, game_map *gm, int w, int h)
+{
+	uint8_t payload[sizeof(uint16_t) * 4 + sizeof(uint8_t **)];
+	uint16_t dims[4];
+	uint8_t **rows;
+	int count;
+
+	dims[0] = gm->w;
+	dims[1] = gm->h;
+	dims[2] = w;
+	dims[3] = h;
+
+	/*rows array is kept while undone so redo need not allocate*/
+	count = dims[1] - get_first(dims);
+	rows = count > 0 ? (uint8_t **) xcalloc(count, sizeof(*rows)) : NULL;
+
+	memcpy(payload, dims, sizeof(dims));
+	memcpy(payload + sizeof(dims), &rows, sizeof(rows));
+	write_record(j, REC_RESIZE, payload, sizeof(payload));
+	j->changed = empty_box();
+	grow_resize(&j->changed, dims);
+	if (rows) {
+		resize_rows(j, gm, dims, rows);
+	} else {
+		size_game_map(gm, w, h);
+	}
+}
+
+void record_rows(journal *j, game_map *gm, int top, int bottom)
+{
+	uint8_t payload[sizeof(uint16_t) * 3 + sizeof(uint8_t **)];
+	uint16_t dims[3];
+	uint8_t **rows;
+	int y;
+
+	dims[0] = top;
+	dims[1] = bottom - top;
+	dims[2] = gm->w;
+	rows = (uint8_t **) xmalloc(dims[1] * sizeof(*rows));
+
+	/*copy on write, journal keeps rows and map edits copies*/
+	for (y = top; y < bottom; y++) {
+		rows[y - top] = gm->rows[y];
+		gm->rows[y] = (uint8_t *) xmalloc(gm->w);
+		memcpy(gm->rows[y], rows[y - top], gm->w);
+	}
+	j->held += (size_t) dims[1] * gm->w;
+
+	memcpy(payload, dims, sizeof(dims));
+	memcpy(payload + sizeof(dims), &rows, sizeof(rows));
+	write_record(j, REC_ROWS, payload, sizeof(payload));
+}
+
+/**
+ * push_seed() - Push tile to fill from
+ * @stack: Stack of seeds
+ * @n: Count of seeds
+ * @cap: Count of seeds stack fits
+ * @x: X of seed
+ * @y: Y of seed
+ */
+static void push_seed(v2i **stack, size_t *n, size_t *cap, int x, int y)
+{
+	if (*n == *cap) {
+		*cap = *cap ? *cap * 2 : 256;
+		*stack = (v2i *) xrealloc(*stack, *cap * sizeof(**stack));
+	}
+	(*stack)[*n].x = x;
+	(*stack)[*n].y = y;
+	++*n;
+}
+
+/**
+ * push_runs() - Push first tile of every run to fill in span of row
+ * @stack: Stack of seeds
+ * @n: Count of seeds
+ * @cap: Count of seeds stack fits
+ * @row: Row to scan
+ * @y: Y of row
+ * @l: Left of span
+ * @r: Right of span, inclusive
+ * @old: Tile being filled
+ */
+static void push_runs(v2i **stack, size_t *n, size_t *cap,
+		const uint8_t *row, int y, int l, int r, int old)
+{
+	while (l <= r) {
+		if (row[l] != old) {
+			l++;
+			continue;
+		}
+		push_seed(stack, n, cap, l, y);
+		while (l <= r && row[l] == old) {
+			l++;
+		}
+	}
+}
+
+bool record_fill(journal *j, game_map *gm, int x, int y, int tile)
+{
+	v2i *stack;
+	size_t n, cap;
+	uint8_t *p;
+	int old;
+
+	old = gm->rows[y][x];
+	if (old == tile) {
+		return false;
+	}
+
+	end_stroke(j);
+	open_record(j, REC_SPANS);
+	j->changed = empty_box();
+	p = reserve(j, 2);
+	p[0] = old;
+	p[1] = tile;
+	j->end += 2;
+
+	stack = NULL;
+	n = 0;
+	cap = 0;
+	push_seed(&stack, &n, &cap, x, y);
+	while (n > 0) {
+		uint8_t *row;
+		int l, r;
+
+		n--;
+		x = stack[n].x;
+		y = stack[n].y;
+		row = gm->rows[y];
+		if (row[x] != old) {
+			continue;
+		}
+
+		/*grow seed to whole span, then fill it in one run*/
+		l = x;
+		while (l > 0 && row[l - 1] == old) {
+			l--;
+		}
+		r = x;
+		while (r + 1 < gm->w && row[r + 1] == old) {
+			r++;
+		}
+		memset(row + l, tile, r - l + 1);
+		grow_box(&j->changed, l, y, r, y);
+
+		p = reserve(j, MAX_SPAN_BYTES);
+		p = put_varint(p, y - j->y);
+		p = put_varint(p, l);
+		p = put_varint(p, r - l + 1);
+		j->end = p - j->data;
+		j->y = y;
+
+		if (y > 0) {
+			push_runs(&stack, &n, &cap, gm->rows[y - 1], y - 1,
+					l, r, old);
+		}
+		if (y + 1 < gm->h) {
+			push_runs(&stack, &n, &cap, gm->rows[y + 1], y + 1,
+					l, r, old);
+		}
+	}
+	free(stack);
+	end_stroke(j);
+	return true;
+}
+
+/**
+ * blit_span() - Overwrite span of row, keeping the tiles it held
+ * @j: Journal
+ * @row: Row of map
+ * @y: Y of row
+ * @l: Left of span
+ * @r: Right of span, inclusive
+ * @src: Tiles to write from l
+ *
+ * Span is trimmed to the tiles that change, a span that would
+ * change nothing is not kept. Opens a blit if none is being
+ * written.
+ */
+static void blit_span(journal *j, uint8_t *row, int y, int l, int r,
+		const uint8_t *src)
+{
+	uint8_t *p;
+	int n;
+
+	while (l <= r && row[l] == *src) {
+		l++;
+		src++;
+	}
+	while (r >= l && row[r] == src[r - l]) {
+		r--;
+	}
+	if (l > r) {
+		return;
+	}
+
+	if (j->stroke == NO_STROKE) {
+		open_record(j, REC_BLIT);
+	}
+	n = r - l + 1;
+	p = reserve(j, MAX_SPAN_BYTES + n);
+	p = put_varint(p, y - j->y);
+	p = put_varint(p, l);
+	p = put_varint(p, n);
+	memcpy(p, row + l, n);
+	memcpy(row + l, src, n);
+	j->end = p + n - j->data;
+	j->y = y;
+	grow_box(&j->changed, l, y, r, y);
+}
+
+bool record_rect(journal *j, game_map *gm, int x0, int y0,
+		int x1, int y1, int tile)
+{
+	uint8_t src[MAX_MAP_LEN];
+	int l, t, r, b;
+	int y;
+
+	l = max(min(x0, x1), 0);
+	r = min(max(x0, x1), gm->w - 1);
+	t = max(min(y0, y1), 0);
+	b = min(max(y0, y1), gm->h - 1);
+	if (l > r || t > b) {
+		return false;
+	}
+
+	end_stroke(j);
+	j->changed = empty_box();
+	memset(src, tile, r - l + 1);
+	for (y = t; y <= b; y++) {
+		blit_span(j, gm->rows[y], y, l, r, src);
+	}
+	end_stroke(j);
+	return j->changed.l <= j->changed.r;
+}
+
+bool record_stamp(journal *j, game_map *gm, int x, int y, const stamp *s)
+{
+	const uint8_t *src;
+	int l, t, r, b;
+	int i;
+
+	l = max(x, 0);
+	t = max(y, 0);
+	r = min(x + s->w, gm->w) - 1;
+	b = min(y + s->h, gm->h) - 1;
+	if (l > r || t > b) {
+		return false;
+	}
+
+	end_stroke(j);
+	j->changed = empty_box();
+	src = s->tiles + (t - y) * s->w + (l - x);
+	for (i = t; i <= b; i++) {
+		blit_span(j, gm->rows[i], i, l, r, src);
+		src += s->w;
+	}
+	end_stroke(j);
+	return j->changed.l <= j->changed.r;
+}
+
+bool record_replace(journal *j, game_map *gm, int from, int to)
+{
+	tile_box box;
+
+	if (from == to) {
+		return false;
+	}
+	box = bound_tiles(gm, TILE_BIT(from));
+	if (box.l > box.r) {
+		return false;
+	}
+
+	record_rows(j, gm, box.t, box.b + 1);
+	replace_tiles(gm, &box, from, to);
+	j->changed = box;
+	return true;
+}
+
+/**
+ * undo_stroke() - Restore tiles before stroke
+ * @j: Journal
+ * @gm: Game map
+ * @p: Payload of stroke
+ * @end: End of payload
+ *
+ * Tiles are restored newest first, in case a tile was placed
+ * twice in the stroke.
+ */
+static void undo_stroke(journal *j, game_map *gm,
+		const uint8_t *p, const uint8_t *end)
+{
+	journal_tile *t;
+	size_t max;
+	int x, y;
+
+	/*every tile takes at least four bytes*/
+	max = (end - p) / 4;
+	if (max > j->scratch_cap) {
+		j->scratch_cap = max;
+		j->scratch = (journal_tile *) xrealloc(j->scratch,
+				max * sizeof(*j->scratch));
+	}
+
+	t = j->scratch;
+	x = 0;
+	y = 0;
+	while (p < end) {
+		int dx, dy;
+
+		p = get_varint(p, &dx);
+		p = get_varint(p, &dy);
+		x += dx;
+		y += dy;
+		t->x = x;
+		t->y = y;
+		t->old = *p;
+		p += 2;
+		t++;
+	}
+
+	while (t-- > j->scratch) {
+		gm->rows[t->y][t->x] = t->old;
+		grow_box(&j->changed, t->x, t->y, t->x, t->y);
+	}
+}
+
+/**
+ * undo_resize() - Restore rows moved out by resize
+ * @j: Journal
+ * @gm: Game map
+ * @p: Payload of resize
+ *
+ * Rows that were added or changed can be made again from the
+ * restored rows, so they are freed.
+ */
+static void undo_resize(journal *j, game_map *gm, const uint8_t *p)
+{
+	uint16_t dims[4];
+	uint8_t **rows;
+	int first;
+	int y;
+
+	memcpy(dims, p, sizeof(dims));
+	rows = get_rows(p + sizeof(dims));
+	grow_resize(&j->changed, dims);
+	if (!rows) {
+		size_game_map(gm, dims[0], dims[1]);
+		return;
+	}
+
+	first = get_first(dims);
+	for (y = first; y < dims[3]; y++) {
+		free(gm->rows[y]);
+	}
+	gm->rows = (uint8_t **) xrealloc(gm->rows,
+			dims[1] * sizeof(*gm->rows));
+	memcpy(gm->rows + first, rows, (dims[1] - first) * sizeof(*rows));
+	memset(rows, 0, (dims[1] - first) * sizeof(*rows));
+	j->held -= (size_t) (dims[1] - first) * dims[0];
+	gm->w = dims[0];
+	gm->h = dims[1];
+}
+
+/**
+ * set_spans() - Set every span of fill to tile
+ * @gm: Game map
+ * @p: Spans of fill
+ * @end: End of spans
+ * @tile: Tile to set
+ * @changed: Grown to contain spans
+ */
+static void set_spans(game_map *gm, const uint8_t *p, const uint8_t *end,
+		int tile, tile_box *changed)
+{
+	int y;
+
+	y = 0;
+	while (p < end) {
+		int dy, x, n;
+
+		p = get_varint(p, &dy);
+		p = get_varint(p, &x);
+		p = get_varint(p, &n);
+		y += dy;
+		memset(gm->rows[y] + x, tile, n);
+		grow_box(changed, x, y, x + n - 1, y);
+	}
+}
+
+/**
+ * swap_spans() - Swap every span of blit with tiles of map
+ * @gm: Game map
+ * @p: Spans of blit
+ * @end: End of spans
+ * @changed: Grown to contain spans
+ *
+ * The record holds whichever tiles the map does not, so undo
+ * and redo are the same swap.
+ */
+static void swap_spans(game_map *gm, uint8_t *p, const uint8_t *end,
+		tile_box *changed)
+{
+	uint8_t tmp[MAX_MAP_LEN];
+	int y;
+
+	y = 0;
+	while (p < end) {
+		uint8_t *row;
+		int dy, x, n;
+
+		p = (uint8_t *) get_varint(p, &dy);
+		p = (uint8_t *) get_varint(p, &x);
+		p = (uint8_t *) get_varint(p, &n);
+		y += dy;
+		row = gm->rows[y];
+		memcpy(tmp, row + x, n);
+		memcpy(row + x, p, n);
+		memcpy(p, tmp, n);
+		grow_box(changed, x, y, x + n - 1, y);
+		p += n;
+	}
+}
+
+/**
+ * swap_rows() - Swap rows of map with rows kept by record
+ * @gm: Game map
+ * @p: Payload of record
+ * @changed: Grown to contain rows
+ */
+static void swap_rows(game_map *gm, const uint8_t *p, tile_box *changed)
+{
+	uint16_t dims[3];
+	uint8_t **rows;
+	int i;
+
+	memcpy(dims, p, sizeof(dims));
+	rows = get_rows(p + sizeof(dims));
+	for (i = 0; i < dims[1]; i++) {
+		uint8_t *row;
+
+		row = gm->rows[dims[0] + i];
+		gm->rows[dims[0] + i] = rows[i];
+		rows[i] = row;
+	}
+	grow_box(changed, 0, dims[0], gm->w - 1, dims[0] + dims[1] - 1);
+}
+
+bool undo_journal(journal *j, game_map *gm)
+{
+	const uint8_t *p;
+	uint32_t size;
+	size_t rec;
+
+	end_stroke(j);
+	if (j->cur <= j->head) {
+		return false;
+	}
+	j->changed = empty_box();
+
+	size = get_u32(j->data + j->cur - REC_TAIL);
+	rec = j->cur - REC_TAIL - size - REC_HEAD;
+	p = j->data + rec + REC_HEAD;
+	switch (j->data[rec]) {
+	case REC_STROKE:
+		undo_stroke(j, gm, p, p + size);
+		break;
+	case REC_RESIZE:
+		undo_resize(j, gm, p);
+		break;
+	case REC_ROWS:
+		swap_rows(gm, p, &j->changed);
+		break;
+	case REC_SPANS:
+		set_spans(gm, p + 2, p + size, p[0], &j->changed);
+		break;
+	case REC_BLIT:
+		swap_spans(gm, j->data + rec + REC_HEAD, p + size,
+				&j->changed);
+		break;
+	}
+	j->cur = rec;
+	return true;
+}
+
+bool redo_journal(journal *j, game_map *gm)
+{
+	const uint8_t *p;
+	const uint8_t *end;
+	uint16_t dims[4];
+	uint8_t **rows;
+	uint32_t size;
+	int x, y;
+
+	end_stroke(j);
+	if (j->cur >= j->end) {
+		return false;
+	}
+	j->changed = empty_box();
+
+	size = get_u32(j->data + j->cur + 1);
+	p = j->data + j->cur + REC_HEAD;
+	end = p + size;
+	switch (j->data[j->cur]) {
+	case REC_STROKE:
+		x = 0;
+		y = 0;
+		while (p < end) {
+			int dx, dy;
+
+			p = get_varint(p, &dx);
+			p = get_varint(p, &dy);
+			x += dx;
+			y += dy;
+			gm->rows[y][x] = p[1];
+			grow_box(&j->changed, x, y, x, y);
+			p += 2;
+		}
+		break;
+	case REC_RESIZE:
+		memcpy(dims, p, sizeof(dims));
+		rows = get_rows(p + sizeof(dims));
+		grow_resize(&j->changed, dims);
+		if (rows) {
+			resize_rows(j, gm, dims, rows);
+		} else {
+			size_game_map(gm, dims[2], dims[3]);
+		}
+		break;
+	case REC_ROWS:
+		swap_rows(gm, p, &j->changed);
+		break;
+	case REC_SPANS:
+		set_spans(gm, p + 2, end, p[1], &j->changed);
+		break;
+	case REC_BLIT:
+		swap_spans(gm, j->data + j->cur + REC_HEAD, end,
+				&j->changed);
+		break;
+	}
+	j->cur += REC_HEAD + size + REC_TAIL;
+	return true;
+}
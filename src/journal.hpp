@@ -0,0 +1,238 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game-map.hpp"
+
+/**
+ * Bytes of history kept before the oldest records are dropped
+ */
+#define JOURNAL_BUDGET (4 << 20)
+
+/**
+ * struct journal_tile - Tile of stroke being undone
+ * @x: X of tile
+ * @y: Y of tile
+ * @old: Tile before stroke
+ */
+struct journal_tile {
+	int16_t x;
+	int16_t y;
+	uint8_t old;
+};
+
+/**
+ * struct journal - Undo history of map edits
+ * @data: Records, oldest first
+ * @cap: Size of data
+ * @head: Offset of oldest record
+ * @cur: End of last applied record, undo reads back from here
+ * @end: End of last record, redo reads up to here
+ * @held: Bytes of map rows kept by records
+ * @stroke: Offset of stroke being written, SIZE_MAX if none
+ * @x: X of last tile written to stroke
+ * @y: Y of last tile written to stroke
+ * @scratch: Tiles of stroke being undone
+ * @scratch_cap: Count of tiles scratch fits
+ * @changed: Tiles changed by last undo, redo, bulk edit or resize
+ *
+ * Each record is a type, the size of its payload, the payload,
+ * and the size again, so records can be walked both ways. A
+ * stroke stores each tile as the offset from the previous tile
+ * with the old and new tile, usually four bytes a tile.
+ *
+ * A fill stores the spans it set, one old and new tile for all.
+ * Rectangles and stamps store the spans they set with the tiles
+ * each held, which undo and redo swap with the map. Resizes and
+ * replaces move the rows they change out of the map into the
+ * journal instead of copying tiles. A row is only ever owned by
+ * either the map or the journal, so undo swaps pointers in
+ * O(rows changed) and nothing is shared.
+ *
+ * Once records and rows pass JOURNAL_BUDGET the oldest are
+ * dropped. The buffer slides down only once half of it is
+ * dropped, so data can grow to twice the budget.
+ */
+struct journal {
+	uint8_t *data;
+	size_t cap;
+	size_t head;
+	size_t cur;
+	size_t end;
+	size_t held;
+	size_t stroke;
+	int x;
+	int y;
+	journal_tile *scratch;
+	size_t scratch_cap;
+	tile_box changed;
+};
+
+/**
+ * init_journal() - Initialize empty journal
+ * @j: Journal to initialize
+ */
+void init_journal(journal *j);
+
+/**
+ * reset_journal() - Drop every record
+ * @j: Journal to reset
+ */
+void reset_journal(journal *j);
+
+/**
+ * end_stroke() - Finish stroke being written, if any
+ * @j: Journal
+ *
+ * Tiles placed after start a new stroke.
+ */
+void end_stroke(journal *j);
+
+/**
+ * record_place() - Place tile and add it to stroke
+ * @j: Journal
+ * @gm: Game map
+ * @x: X of tile, must be in map
+ * @y: Y of tile, must be in map
+ * @tile: Tile to place
+ *
+ * Begins a stroke if none is being written. Drops redo.
+ *
+ * Return: True if tile changed
+ */
+bool record_place(journal *j, game_map *gm, int x, int y, int tile);
+
+/**
+ * record_line() - Place line of tiles and add them to stroke
+ * @j: Journal
+ * @gm: Game map
+ * @x0: X of start of line
+ * @y0: Y of start of line
+ * @x1: X of end of line
+ * @y1: Y of end of line
+ * @tile: Tile to place
+ *
+ * Tiles are stepped with Bresenham's algorithm, so the line
+ * has no gaps. Ends may be outside map, the line is clipped
+ * to it first without changing direction. Tiles placed are
+ * bounded by changed.
+ *
+ * Return: True if any tile changed
+ */
+bool record_line(journal *j, game_map *gm, int x0, int y0,
+		int x1, int y1, int tile);
+
+/**
+ * record_fill() - Flood fill tiles connected to tile as one undo
+ * @j: Journal
+ * @gm: Game map
+ * @x: X of tile to fill from, must be in map
+ * @y: Y of tile to fill from, must be in map
+ * @tile: Tile to fill with
+ *
+ * Fills a span of a row at a time, only spans are kept.
+ * Tiles filled are bounded by changed.
+ *
+ * Return: True if any tile changed
+ */
+bool record_fill(journal *j, game_map *gm, int x, int y, int tile);
+
+/**
+ * record_rect() - Fill rectangle of tiles as one undo
+ * @j: Journal
+ * @gm: Game map
+ * @x0: X of one corner
+ * @y0: Y of one corner
+ * @x1: X of opposite corner
+ * @y1: Y of opposite corner
+ * @tile: Tile to fill with
+ *
+ * Corners are inclusive and clamped to map. Only the span of
+ * each row that changes is kept. Tiles filled are bounded by
+ * changed.
+ *
+ * Return: True if any tile changed
+ */
+bool record_rect(journal *j, game_map *gm, int x0, int y0,
+		int x1, int y1, int tile);
+
+/**
+ * record_stamp() - Blit stamp into map as one undo
+ * @j: Journal
+ * @gm: Game map
+ * @x: X of left of stamp
+ * @y: Y of top of stamp
+ * @s: Stamp to blit
+ *
+ * Stamp is clipped to map and copied a row at a time, only
+ * the span of each row that changes is kept. Tiles blitted are
+ * bounded by changed.
+ *
+ * Return: True if any tile changed
+ */
+bool record_stamp(journal *j, game_map *gm, int x, int y, const stamp *s);
+
+/**
+ * record_replace() - Replace every tile of a kind as one undo
+ * @j: Journal
+ * @gm: Game map
+ * @from: Tile to replace
+ * @to: Tile to replace with
+ *
+ * Only rows between the first and last tile replaced are kept.
+ * Tiles replaced are bounded by changed.
+ *
+ * Return: True if any tile changed
+ */
+bool record_replace(journal *j, game_map *gm, int from, int to);
+
+/**
+ * record_resize() - Resize map as its own undo
+ * @j: Journal
+ * @gm: Game map
+ * @w: New width
+ * @h: New height
+ *
+ * Rows cut off or changed in width are kept so undo restores
+ * them exactly. Tiles lost or gained are bounded by changed.
+ */
+void record_resize(journal *j, game_map *gm, int w, int h);
+
+/**
+ * record_rows() - Keep rows before a bulk edit as its own undo
+ * @j: Journal
+ * @gm: Game map
+ * @top: First row to keep
+ * @bottom: Row after last row to keep
+ *
+ * The journal keeps the rows and the map gets copies, so edit
+ * the map directly after. Undo and redo swap the rows back.
+ */
+void record_rows(journal *j, game_map *gm, int top, int bottom);
+
+/**
+ * undo_journal() - Undo last applied record
+ * @j: Journal
+ * @gm: Game map
+ *
+ * Tiles changed are bounded by changed, which covers both
+ * sizes of a resize from the first row it moved out.
+ *
+ * Return: True if map changed
+ */
+bool undo_journal(journal *j, game_map *gm);
+
+/**
+ * redo_journal() - Redo last undone record
+ * @j: Journal
+ * @gm: Game map
+ *
+ * Tiles changed are bounded by changed, as with undo_journal().
+ *
+ * Return: True if map changed
+ */
+bool redo_journal(journal *j, game_map *gm);
+
+#endif
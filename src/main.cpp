@@ -14,39 +14,29 @@
 #include <glad/glad.h>
 
 #include "audio.hpp"
+#include "bot.hpp"
+#include "device.hpp"
 #include "menu.hpp"
 #include "render.hpp"
 #include "input.hpp"
+#include "journal.hpp"
+#include "perf.hpp"
+#include "replay.hpp"
+#include "save.hpp"
+#include "sim.hpp"
 #include "win32.hpp"
 
-#define MAX_EDITS 256ULL
-
 #define KEY_IS_UP 0x80000000
 
-enum edit_type {
-	EDIT_NONE,
-	EDIT_PLACE,
-	EDIT_RESIZE
-};
-
-struct edit_place {
-	int x;
-	int y;
-	int tile;
-};
+#define ID_AUTOSAVE 1
+#define AUTOSAVE_MS 60000
 
-struct edit_resize {
-	int w;
-	int h;
-};
+#define SIM_BENCH_FRAMES 100000
 
-struct edit {
-	edit_type type;
-	union {
-		edit_place place;
-		edit_resize resize;
-	};
-};
+/**
+ * Mouse samples of a brush stroke queued before they are applied
+ */
+#define BRUSH_SAMPLES 64
 
 static HINSTANCE g_ins;
 static HACCEL g_acc; 
@@ -56,18 +46,70 @@ static int g_client_height = VIEW_HEIGHT;
 
 static wchar_t g_map_path[MAX_PATH];
 
+/**
+ * @g_change: Map changed since it was last saved
+ * @g_edits: Count of edits ever made to map
+ * @g_autosaved: g_edits when last autosave was queued
+ */
 static bool g_change;
+static uint32_t g_edits;
+static uint32_t g_autosaved;
 
-static edit g_edits[MAX_EDITS];
-static size_t g_edit_next;
+static journal g_journal;
 
 static uint16_t g_place_select = IDM_GRASS;
+static uint16_t g_tool = IDM_PENCIL;
+static v2i g_rect_start;
+static bool g_rect_set;
+static v2i g_sel_start;
+static bool g_sel_set;
+static stamp g_stamp;
 static uint8_t g_place = TILE_GRASS;
 
+static const uint8_t g_idm_to_tile[] = {
+	[IDM_BLANK - IDM_BLANK] = TILE_BLANK,
+	[IDM_GRASS - IDM_BLANK] = TILE_GRASS,
+	[IDM_GROUND - IDM_BLANK] = TILE_GROUND
+};
+
+static const uint8_t g_idm_to_entity[] = {
+	[IDM_PLAYER - IDM_PLAYER] = TILE_CAPTAIN,
+	[IDM_CRABBY - IDM_PLAYER] = TILE_CRABBY
+};
+
+/**
+ * Brush stroke being dragged
+ * @g_brush: Tiles under mouse samples not yet applied
+ * @g_brush_count: Count of g_brush
+ * @g_brush_last: Tile line to first sample starts from
+ * @g_brush_tile: Tile being painted
+ * @g_brush_on: Stroke is anchored at g_brush_last
+ */
+static v2i g_brush[BRUSH_SAMPLES];
+static int g_brush_count;
+static v2i g_brush_last;
+static int g_brush_tile;
+static bool g_brush_on;
+
 static int64_t g_perf_freq;
 
 static rect g_old_cam;
 
+/**
+ * @g_script: Source replacing devices while game runs, poll is NULL
+ * if devices are read
+ * @g_replay_path: File played back by g_replay
+ * @g_record_path: File input is recorded to, empty if not recording
+ * @g_record: Open while game runs if recording
+ */
+static input_src g_script;
+static replay g_replay;
+static bot g_bot;
+static uint32_t g_bot_seed;
+static wchar_t g_replay_path[MAX_PATH];
+static wchar_t g_record_path[MAX_PATH];
+static FILE *g_record;
+
 /** 
  * set_default_directory() - Set working directory to be repository folder 
  */
@@ -110,6 +152,7 @@ static void update_scrollbars(int width, int height)
 	si.nPage = height + 1;
 	si.nPos = g_cam.y * height / g_cam.h;
 	SetScrollInfo(g_wnd, SB_VERT, &si, TRUE);
+	invalidate_view();
 }
 
 /**
@@ -124,7 +167,16 @@ static void update_size(int width, int height)
 
 	g_client_width = width;
 	g_client_height = height;
-	glViewport(0, 0, width, height);
+	resize_viewport(width, height);
+}
+
+/**
+ * mark_change() - Mark map as changed since last save and autosave
+ */
+static void mark_change(void)
+{
+	g_change = true;
+	g_edits++;
 }
 
 /**
@@ -142,55 +194,48 @@ static bool unsaved_warning(void)
 }
 
 /**
- * write_map() - Save map to file.
+ * write_map() - Queue map to be saved to file
  * @path - Path to map
  *
- * Display message box on failure
+ * Display message box on failure, failure while writing is
+ * reported once WM_SAVED arrives.
  *
  * Return: Returns zero on success, and negative number on failure
  */
 static int write_map(const wchar_t *path) 
 {
-	int err;
-	FILE *f;
-	uint16_t v[2];
-	uint8_t **row;
-	int n;
-
-	err = -1;
-	f = _wfopen(path, L"wb");
-	if (!f) {
-		goto err0;
+	if (save_map(g_gm, path, false) < 0) {
+		err_wnd(g_wnd, L"Could not save map");
+		return -1;
 	}
+	g_change = false;
+	return 0;
+}
 
-	/*write width and height of map*/
-	v[0] = g_gm->w;
-	v[1] = g_gm->h;
-	if (fwrite(v, sizeof(v), 1, f) < 1) {
-		goto err1;
-	}
+/**
+ * autosave() - Save changed map beside the map
+ *
+ * Unsaved maps are saved to maps/autosave.gm. Skipped if a save
+ * is still being written, or if nothing was edited since the last
+ * autosave.
+ */
+static void autosave(void)
+{
+	wchar_t path[MAX_PATH];
 
-	row = g_gm->rows;
-	n = g_gm->h;
-	while (n-- > 0) {
-		if (fwrite(*row, g_gm->w, 1, f) < 1) {
-			goto err1;
-		}
-		row++;
+	if (!g_change || g_edits == g_autosaved) {
+		return;
 	}
 
-	/*error handling and cleanup*/
-	err = 0;
-err1:
-	fclose(f);
-	if (err >= 0) {
-		g_change = false;
+	if (!g_map_path[0]) {
+		get_res_path(path, L"maps\\autosave.gm");
+	} else if (_snwprintf(path, MAX_PATH, L"%s.autosave",
+			g_map_path) < 0) {
+		return;
 	}
-err0:
-	if (err < 0) {
-		err_wnd(g_wnd, L"Could not save map"); 
+	if (save_map(g_gm, path, true) >= 0) {
+		g_autosaved = g_edits;
 	}
-	return err;
 }
 
 /**
@@ -268,24 +313,6 @@ err0:
 	return err;
 }
 
-/**
- * reset_edits() - Reset edit buffer
- *
- * Action buffer refers to the buffer for
- * undo and redo.
- */
-static void reset_edits(void)
-{
-	int undo;
-
-	/*establish barrier for redo*/
-	g_edits[g_edit_next].type = EDIT_NONE;
-
-	/*acts as barrier for undo*/
-	undo = (g_edit_next - 1ULL) % MAX_EDITS;
-	g_edits[undo].type = EDIT_NONE;
-}
-
 /**
  * open() - Open map dialog 
  */
@@ -314,7 +341,9 @@ static void open(void)
 
 	if (GetOpenFileName(&ofn) && read_map(g_map_path) >= 0) {
 		g_change = false;
-		reset_edits();
+		reset_journal(&g_journal);
+		invalidate_map();
+		g_sel = empty_box();
 		g_cam.x = 0;
 		g_cam.y = 0;
 		update_scrollbars(g_client_width, g_client_height);
@@ -363,101 +392,133 @@ static void save(void)
 }
 
 /**
- * resize_edit() - Use resize edit to resize map
- * @ed: Edit
+ * invalidate_changed() - Redraw tiles changed by last journal edit
  */
-static void resize_edit(edit *ed)
+static void invalidate_changed(void)
 {
-	int w, h;
-
-	w = ed->resize.w;
-	h = ed->resize.h;
-	ed->resize.w = g_gm->w; 
-	ed->resize.h = g_gm->h; 
-	size_game_map(g_gm, w, h);
-	update_scrollbars(g_client_width, g_client_height);
+	const tile_box *c;
+
+	c = &g_journal.changed;
+	invalidate_tiles(c->l, c->t, c->r, c->b);
 }
 
 /**
- * undo() - Undos edit
+ * undo() - Undos last stroke or resize
  */
 static void undo(void)
 {
-	edit *ed;
-	uint8_t *tp;
-	int tile;
-	
-	g_edit_next = (g_edit_next - 1ULL) % MAX_EDITS;
-	ed = g_edits + g_edit_next;
-	switch (ed->type) {
-	case EDIT_NONE:
-		g_edit_next = (g_edit_next + 1ULL) % MAX_EDITS; 
-		break;
-	case EDIT_PLACE:
-		tp = &g_gm->rows[ed->place.y][ed->place.x];
-		tile = *tp;
-		*tp = ed->place.tile;
-		ed->place.tile = tile;
-		break;
-	case EDIT_RESIZE:
-		resize_edit(ed);
-		break;
+	if (undo_journal(&g_journal, g_gm)) {
+		invalidate_changed();
+		update_scrollbars(g_client_width, g_client_height);
+		mark_change();
 	}
 }
 
 /**
- * redo() - Redos edit 
+ * redo() - Redos last undone stroke or resize
  */
 static void redo(void)
 {
-	edit *ed;
-	uint8_t *tp;
-	int tile;
-	
-	ed = g_edits + g_edit_next;
-	g_edit_next = (g_edit_next + 1ULL) % MAX_EDITS;
-	switch (ed->type) {
-	case EDIT_NONE:
-		g_edit_next = (g_edit_next - 1ULL) % MAX_EDITS;
-		break;
-	case EDIT_PLACE:
-		tp = &g_gm->rows[ed->place.y][ed->place.x];
-		tile = *tp;
-		*tp = ed->place.tile;
-		ed->place.tile = tile;
-		break;
-	case EDIT_RESIZE:
-		resize_edit(ed);
-		break;
+	if (redo_journal(&g_journal, g_gm)) {
+		invalidate_changed();
+		update_scrollbars(g_client_width, g_client_height);
+		mark_change();
 	}
 }
 
 /**
- * update_place() - Update selected tile base on menu command
- * @id: ID of menu item, must be valid tile submenu ID 
+ * client_to_tile() - Convert cursor to tile
+ * @x: Client window x coord
+ * @y: Client window y coord
+ * @tx: X of tile
+ * @ty: Y of tile
+ *
+ * Return: True if tile is in map
  */
-static void update_place(int id)
+static bool client_to_tile(int x, int y, int *tx, int *ty)
 {
-	CheckMenuItem(g_menu, g_place_select, MF_UNCHECKED);
-	CheckMenuItem(g_menu, id, MF_CHECKED);
-	g_place_select = id;
+	*tx = g_cam.x + (float) x * g_cam.w / g_client_width;
+	*ty = g_cam.y + (float) y * g_cam.h / g_client_height;
+	return *tx >= 0 && *tx < g_gm->w && *ty >= 0 && *ty < g_gm->h;
+}
+
+/**
+ * cut_sel() - Copy selected tiles into stamp, then blank them
+ *
+ * Blanking is one undo.
+ */
+static void cut_sel(void)
+{
+	if (copy_stamp(&g_stamp, g_gm, &g_sel) &&
+			record_rect(&g_journal, g_gm, g_sel.l, g_sel.t,
+			g_sel.r, g_sel.b, TILE_BLANK)) {
+		invalidate_tiles(g_sel.l, g_sel.t, g_sel.r, g_sel.b);
+		mark_change();
+	}
 }
 
 /**
- * push_edit() - Addes new edit
- * Return: New edit pointer
+ * paste() - Blit stamp at cursor as one undo
+ *
+ * If the cursor is not over the map the stamp goes to the
+ * top left of the selection, or of the camera if nothing is
+ * selected. The pasted tiles become the selection.
  */
-static edit *push_edit(void)
+static void paste(void)
 {
-	edit *ed, *br;
+	POINT pt;
+	int tx;
+	int ty;
+
+	if (!g_stamp.w) {
+		return;
+	}
+
+	GetCursorPos(&pt);
+	ScreenToClient(g_wnd, &pt);
+	if (pt.x < 0 || pt.x >= g_client_width ||
+			pt.y < 0 || pt.y >= g_client_height ||
+			!client_to_tile(pt.x, pt.y, &tx, &ty)) {
+		if (g_sel.l <= g_sel.r) {
+			tx = g_sel.l;
+			ty = g_sel.t;
+		} else {
+			tx = g_cam.x;
+			ty = g_cam.y;
+		}
+	}
 
-	ed = g_edits + g_edit_next;
-	g_edit_next = (g_edit_next + 1ULL) % MAX_EDITS; 
+	g_sel.l = tx;
+	g_sel.t = ty;
+	g_sel.r = min(tx + g_stamp.w, g_gm->w) - 1;
+	g_sel.b = min(ty + g_stamp.h, g_gm->h) - 1;
+	invalidate_view();
+	if (record_stamp(&g_journal, g_gm, tx, ty, &g_stamp)) {
+		invalidate_changed();
+		mark_change();
+	}
+}
 
-	br = g_edits + g_edit_next;
-	br->type = EDIT_NONE;
+/**
+ * update_tool() - Update selected tool base on menu command
+ * @id: ID of menu item, must be valid tool submenu ID
+ */
+static void update_tool(int id)
+{
+	CheckMenuItem(g_menu, g_tool, MF_UNCHECKED);
+	CheckMenuItem(g_menu, id, MF_CHECKED);
+	g_tool = id;
+}
 
-	return ed;
+/**
+ * update_place() - Update selected tile base on menu command
+ * @id: ID of menu item, must be valid tile submenu ID 
+ */
+static void update_place(int id)
+{
+	CheckMenuItem(g_menu, g_place_select, MF_UNCHECKED);
+	CheckMenuItem(g_menu, id, MF_CHECKED);
+	g_place_select = id;
 }
 
 /**
@@ -492,14 +553,9 @@ static void attempt_resize(HWND wnd)
 	}
 
 	if (err >= 0) {
-		edit *ed;
-
-		ed = push_edit();
-		ed->type = EDIT_RESIZE;
-		ed->resize.w = g_gm->w;
-		ed->resize.h = g_gm->h;
-
-		size_game_map(g_gm, width, height);
+		record_resize(&g_journal, g_gm, width, height);
+		invalidate_changed();
+		mark_change();
 		update_scrollbars(g_client_width, g_client_height);
 
 		EndDialog(wnd, 0);
@@ -540,6 +596,49 @@ static __stdcall INT_PTR dlg_proc(HWND wnd, UINT msg,
 	return 0;
 }
 
+/**
+ * start_input() - Start source of input for new run of game
+ *
+ * Replays and recordings are timed from here.
+ */
+static void start_input(void)
+{
+	int64_t now;
+
+	QueryPerformanceCounter((LARGE_INTEGER *) &now);
+	if (g_script.poll == poll_replay) {
+		close_replay(&g_replay);
+		open_replay(&g_replay, g_replay_path, now);
+	} else if (g_script.poll == poll_bot) {
+		init_bot(&g_bot, g_bot_seed, now);
+	}
+	set_input_src(g_script.poll ? &g_script : NULL);
+
+	if (*g_record_path) {
+		g_record = _wfopen(g_record_path, L"w");
+		if (!g_record) {
+			fprintf(stderr, "input: Failed to record to %ls\n",
+					g_record_path);
+		}
+		record_input(g_record, now);
+	}
+}
+
+/**
+ * show_entity_err() - Show why entities could not start
+ * @err: Error message
+ */
+static void show_entity_err(const wchar_t *err)
+{
+	err_wnd(g_wnd, err);
+}
+
+static const entity_host g_entity_host = {
+	.play_sfx = play_sfx,
+	.invalidate_tiles = invalidate_tiles,
+	.err = show_entity_err
+};
+
 /**
  * start_game() - Start running game
  */
@@ -552,7 +651,7 @@ static void start_game(void)
 	}
 
 	g_running = true;
-	for (i = 0; i < 5; i++) {
+	for (i = 0; i < 6; i++) {
 		MENUITEMINFOW info;
 
 		memset(&info, 0, sizeof(info));	
@@ -570,7 +669,7 @@ static void start_game(void)
 	g_cam.w = VIEW_TW;
 	g_cam.h = VIEW_TH;
 	play_music(MUS_SAPPHIRE_LAKE);
-	clear_input();
+	start_input();
 }
 
 /**
@@ -585,19 +684,125 @@ static bool in_submenu(int id, int first)
 	return (id & 0xF000) == first;
 }
 
+/**
+ * replace_all() - Replace every tile like the one under cursor
+ *
+ * Tiles are replaced with the tile being placed, as one undo.
+ */
+static void replace_all(void)
+{
+	POINT pt;
+	int tx;
+	int ty;
+
+	GetCursorPos(&pt);
+	ScreenToClient(g_wnd, &pt);
+	if (pt.x < 0 || pt.x >= g_client_width ||
+			pt.y < 0 || pt.y >= g_client_height ||
+			!client_to_tile(pt.x, pt.y, &tx, &ty)) {
+		return;
+	}
+
+	if (record_replace(&g_journal, g_gm, g_gm->rows[ty][tx], g_place)) {
+		invalidate_changed();
+		mark_change();
+	}
+}
+
+/**
+ * flush_brush() - Apply queued samples of brush stroke in one pass
+ *
+ * Lines are drawn between successive samples, so fast drags
+ * leave no gaps, and the tiles they change are redrawn once.
+ */
+static void flush_brush(void)
+{
+	tile_box box;
+	int i;
+
+	box = empty_box();
+	for (i = 0; i < g_brush_count; i++) {
+		const tile_box *c;
+
+		if (record_line(&g_journal, g_gm,
+				g_brush_last.x, g_brush_last.y,
+				g_brush[i].x, g_brush[i].y, g_brush_tile)) {
+			c = &g_journal.changed;
+			grow_box(&box, c->l, c->t, c->r, c->b);
+		}
+		g_brush_last = g_brush[i];
+	}
+	g_brush_count = 0;
+
+	if (box.l <= box.r) {
+		invalidate_tiles(box.l, box.t, box.r, box.b);
+		mark_change();
+	}
+}
+
+/**
+ * queue_brush() - Queue mouse sample of brush stroke
+ * @x: Client window x coord
+ * @y: Client window y coord
+ * @tile: Tile to paint
+ *
+ * Samples on the tile of the previous sample are dropped.
+ */
+static void queue_brush(int x, int y, int tile)
+{
+	const v2i *last;
+	int tx;
+	int ty;
+
+	/*tiles past the map only steer lines, record_line() clips them*/
+	client_to_tile(x, y, &tx, &ty);
+	if (!g_brush_on || tile != g_brush_tile) {
+		flush_brush();
+		g_brush_on = true;
+		g_brush_tile = tile;
+		g_brush_last.x = tx;
+		g_brush_last.y = ty;
+	}
+
+	last = g_brush_count ? g_brush + g_brush_count - 1 : &g_brush_last;
+	if (last->x == tx && last->y == ty && g_brush_count) {
+		return;
+	}
+	if (g_brush_count == BRUSH_SAMPLES) {
+		flush_brush();
+	}
+	g_brush[g_brush_count].x = tx;
+	g_brush[g_brush_count].y = ty;
+	g_brush_count++;
+}
+
+/**
+ * end_brush() - Apply brush stroke and end stroke being written
+ */
+static void end_brush(void)
+{
+	flush_brush();
+	g_brush_on = false;
+	end_stroke(&g_journal);
+}
+
 /**
  * process_editor_cmds() - Process editor menu commands
  */
 static void process_editor_cmds(int id)
 {
+	/*commands act on map after strokes dragged before them*/
+	flush_brush();
 	switch (id) {
 	case IDM_NEW:
 		if (unsaved_warning()) {
 			g_map_path[0] = '\0';
-			reset_edits();
+			reset_journal(&g_journal);
 			destroy_game_map(g_gm);
 			g_gm = create_game_map();
 			size_game_map(g_gm, VIEW_TW, VIEW_TH);
+			invalidate_map();
+			g_sel = empty_box();
 			g_cam.x = 0;
 			g_cam.y = 0;
 			update_scrollbars(g_client_width, g_client_height);
@@ -621,7 +826,9 @@ static void process_editor_cmds(int id)
 		}
 		break;
 	case IDM_ZOOM_OUT:
-		if (g_cam.w < 160.0F) {
+		/*far zoom is drawn from the map overview*/
+		if (g_cam.w < 160.0F || g_cam.w < g_gm->w ||
+				g_cam.h < g_gm->h) {
 			g_cam.w *= 2.0F;
 			g_cam.h *= 2.0F;
 			update_scrollbars(g_client_width, g_client_height);
@@ -635,6 +842,18 @@ static void process_editor_cmds(int id)
 	case IDM_UNDO:
 		undo();
 		break;
+	case IDM_CUT:
+		cut_sel();
+		break;
+	case IDM_COPY:
+		copy_stamp(&g_stamp, g_gm, &g_sel);
+		break;
+	case IDM_PASTE:
+		paste();
+		break;
+	case IDM_REPLACE:
+		replace_all();
+		break;
 	case IDM_REDO:
 		redo();
 		break;
@@ -646,6 +865,13 @@ static void process_editor_cmds(int id)
 			g_grid_on = true;
 			CheckMenuItem(g_menu, IDM_GRID, MF_CHECKED);
 		}
+		invalidate_view();
+		break;
+	case IDM_MINIMAP:
+		g_minimap_on = !g_minimap_on;
+		CheckMenuItem(g_menu, IDM_MINIMAP,
+				g_minimap_on ? MF_CHECKED : MF_UNCHECKED);
+		invalidate_view();
 		break;
 	case IDM_RESIZE:
             	DialogBoxParamW(NULL, MAKEINTRESOURCEW(ID_RESIZE), 
@@ -661,61 +887,111 @@ static void process_editor_cmds(int id)
 		} else if (in_submenu(id, IDM_PLAYER)) {
 			update_place(id);
 			g_place = g_idm_to_entity[id - IDM_PLAYER];
+		} else if (in_submenu(id, IDM_PENCIL)) {
+			update_tool(id);
 		}
 	}
 }
 
 /**
- * push_place_tile() - Adds tile edit to edit buffer 
- * @x: x position of tile
- * @y: y position of tile
- * @tile: tile to add
+ * drag_sel() - Select tiles from anchor to cursor
+ * @x: Client window x coord
+ * @y: Client window y coord
  */
-static void push_place_tile(int x, int y, int tile)
+static void drag_sel(int x, int y)
 {
-	edit *ed;
+	int tx;
+	int ty;
 
-	ed = push_edit();
-	ed->type = EDIT_PLACE;
-	ed->place.x = x;
-	ed->place.y = y;
-	ed->place.tile = tile;
+	client_to_tile(x, y, &tx, &ty);
+	tx = min(max(tx, 0), g_gm->w - 1);
+	ty = min(max(ty, 0), g_gm->h - 1);
+	g_sel.l = min(g_sel_start.x, tx);
+	g_sel.t = min(g_sel_start.y, ty);
+	g_sel.r = max(g_sel_start.x, tx);
+	g_sel.b = max(g_sel_start.y, ty);
+	invalidate_view();
 }
 
 /**
- * place_tile() - Place tile using cursor
- * @x: Client window x coord 
- * @y: Client window y coord 
- * @tile: Tile to place
+ * button_down() - Respond to mouse button down 
+ * @wp: WPARAM from wnd_proc
+ * @lp: LPARAM from wnd_proc
+ * @tile: Tile to add
+ *
+ * Starts a new stroke, tiles placed until the button is
+ * released are undone together. Fills happen at once,
+ * rectangles and selections are anchored until the button
+ * is released.
  */
-static void place_tile(int x, int y, int tile)
+static void button_down(WPARAM wp, LPARAM lp, int tile)
 {
+	int x;
+	int y;
 	int tx;
 	int ty;
-	uint8_t *tp;
 
-	tx = g_cam.x + (float) x * g_cam.w / g_client_width;
-	ty = g_cam.y + (float) y * g_cam.h / g_client_height;
-
-	if (tx >= 0 && tx < g_gm->w && ty >= 0 && ty < g_gm->h) {
-		tp = &g_gm->rows[ty][tx];
-		if (*tp != tile) {
-			push_place_tile(tx, ty, *tp);
-			*tp = tile;
-			g_change = true;
+	end_brush();
+	x = GET_X_LPARAM(lp);
+	y = GET_Y_LPARAM(lp);
+	switch (g_tool) {
+	case IDM_PENCIL:
+		queue_brush(x, y, tile);
+		break;
+	case IDM_FILL:
+		if (client_to_tile(x, y, &tx, &ty) &&
+				record_fill(&g_journal, g_gm, tx, ty, tile)) {
+			invalidate_changed();
+			mark_change();
 		}
+		break;
+	case IDM_RECT:
+		g_rect_set = client_to_tile(x, y, &tx, &ty);
+		g_rect_start.x = tx;
+		g_rect_start.y = ty;
+		break;
+	case IDM_SELECT:
+		g_sel_set = client_to_tile(x, y, &tx, &ty);
+		g_sel_start.x = tx;
+		g_sel_start.y = ty;
+		if (g_sel_set) {
+			drag_sel(x, y);
+		} else {
+			g_sel = empty_box();
+			invalidate_view();
+		}
+		break;
 	}
 }
 
 /**
- * button_down() - Respond to mouse button down 
- * @wp: WPARAM from wnd_proc
+ * button_up() - Respond to mouse button up
  * @lp: LPARAM from wnd_proc
  * @tile: Tile to add
+ *
+ * Fills rectangle from where button went down.
  */
-static void button_down(WPARAM wp, LPARAM lp, int tile)
+static void button_up(LPARAM lp, int tile)
 {
-	place_tile(GET_X_LPARAM(lp), GET_Y_LPARAM(lp), tile);
+	int tx;
+	int ty;
+
+	end_brush();
+	g_sel_set = false;
+	if (g_tool != IDM_RECT || !g_rect_set) {
+		return;
+	}
+	g_rect_set = false;
+
+	client_to_tile(GET_X_LPARAM(lp), GET_Y_LPARAM(lp), &tx, &ty);
+	if (record_rect(&g_journal, g_gm, g_rect_start.x, g_rect_start.y,
+			tx, ty, tile)) {
+		invalidate_tiles(min(g_rect_start.x, tx),
+				min(g_rect_start.y, ty),
+				max(g_rect_start.x, tx),
+				max(g_rect_start.y, ty));
+		mark_change();
+	}
 }
 
 /**
@@ -731,11 +1007,17 @@ static void mouse_move(WPARAM wp, LPARAM lp)
 	x = GET_X_LPARAM(lp);
 	y = GET_Y_LPARAM(lp);
 
-	if (wp & MK_SHIFT) {
+	if (!(wp & (MK_LBUTTON | MK_RBUTTON))) {
+		end_brush();
+		g_rect_set = false;
+		g_sel_set = false;
+	} else if (g_tool == IDM_SELECT && g_sel_set) {
+		drag_sel(x, y);
+	} else if (g_tool == IDM_PENCIL && (wp & MK_SHIFT)) {
 		if (wp & MK_LBUTTON) {
-			place_tile(x, y, g_place);
+			queue_brush(x, y, g_place);
 		} else if (wp & MK_RBUTTON) {
-			place_tile(x, y, 0);
+			queue_brush(x, y, 0);
 		}
 	}
 }
@@ -746,7 +1028,8 @@ static void mouse_move(WPARAM wp, LPARAM lp)
  */
 static void update_horz_scroll(WPARAM wp)
 {
-	if (LOWORD(wp) == SB_THUMBPOSITION) {
+	/*follow thumb while dragged, pan stays smooth on large maps*/
+	if (LOWORD(wp) == SB_THUMBPOSITION || LOWORD(wp) == SB_THUMBTRACK) {
 		SCROLLINFO si;
 
 		si.cbSize = sizeof(si);
@@ -755,6 +1038,7 @@ static void update_horz_scroll(WPARAM wp)
 		SetScrollInfo(g_wnd, SB_HORZ, &si, TRUE);
 
 		g_cam.x = si.nPos * g_cam.w / g_client_width;
+		invalidate_view();
 	}
 }
 
@@ -764,7 +1048,8 @@ static void update_horz_scroll(WPARAM wp)
  */
 static void update_vert_scroll(WPARAM wp)
 {
-	if (LOWORD(wp) == SB_THUMBPOSITION) {
+	/*follow thumb while dragged, pan stays smooth on large maps*/
+	if (LOWORD(wp) == SB_THUMBPOSITION || LOWORD(wp) == SB_THUMBTRACK) {
 		SCROLLINFO si;
 
 		si.cbSize = sizeof(si);
@@ -773,6 +1058,7 @@ static void update_vert_scroll(WPARAM wp)
 		SetScrollInfo(g_wnd, SB_VERT, &si, TRUE);
 
 		g_cam.y = si.nPos * g_cam.h / g_client_height;
+		invalidate_view();
 	}
 }
 
@@ -805,9 +1091,24 @@ static LRESULT editor_proc(HWND wnd, UINT msg, WPARAM wp, LPARAM lp)
 	case WM_RBUTTONDOWN:
 		button_down(wp, lp, 0);
 		return 0;
+	case WM_LBUTTONUP:
+		button_up(lp, g_place);
+		return 0;
+	case WM_RBUTTONUP:
+		button_up(lp, 0);
+		return 0;
 	case WM_MOUSEMOVE:
 		mouse_move(wp, lp);
 		return 0;
+	case WM_TIMER:
+		if (wp == ID_AUTOSAVE) {
+			autosave();
+		}
+		return 0;
+	case WM_PAINT:
+		ValidateRect(wnd, NULL);
+		invalidate_view();
+		return 0;
 	}
 	return DefWindowProcW(wnd, msg, wp, lp);
 }
@@ -820,7 +1121,7 @@ static void end_game(void)
 	int i;
 
 	g_running = false;
-	for (i = 0; i < 5; i++) {
+	for (i = 0; i < 6; i++) {
 		MENUITEMINFOW info;
 
 		memset(&info, 0, sizeof(info));	
@@ -831,6 +1132,11 @@ static void end_game(void)
 	}
 	end_entities();
 	stop_music();
+	if (g_record) {
+		record_input(NULL, 0);
+		fclose(g_record);
+		g_record = NULL;
+	}
 	g_cam = g_old_cam;
 	CheckMenuItem(g_menu, IDM_RUN, MF_UNCHECKED);
 	DrawMenuBar(g_wnd);
@@ -849,26 +1155,20 @@ static void process_game_cmds(int id)
 }
 
 /**
- * game_update_keys() - Update g_key_down 
+ * game_update_keys() - Queue key event stamped with time received
  * @wp: WPARAM from wnd_proc
  * @lp: LPARAM from wnd_proc
  */
 static void game_update_keys(WPARAM wp, LPARAM lp)
 {
-	int vk;
-	bool is_down;
+	int64_t stamp;
 
 	if (wp >= 256) {
 		return;
 	}
-	vk = wp;
 
-	is_down = !(lp & KEY_IS_UP);
-	if (is_down) {
-		g_key_down[vk]++;
-	} else {
-		g_key_down[vk] = 0;
-	}
+	QueryPerformanceCounter((LARGE_INTEGER *) &stamp);
+	push_key(wp, !(lp & KEY_IS_UP), stamp);
 }
 
 /**
@@ -886,7 +1186,9 @@ static LRESULT game_proc(HWND wnd, UINT msg, WPARAM wp, LPARAM lp)
 {
 	switch(msg) {
 	case WM_KILLFOCUS:
-		clear_input();
+		if (!g_script.poll) {
+			clear_input();
+		}
 		return 0;
 	case WM_KEYDOWN:
 	case WM_KEYUP:
@@ -915,6 +1217,7 @@ static LRESULT __stdcall wnd_proc(HWND wnd, UINT msg, WPARAM wp, LPARAM lp)
 	switch (msg) {
 	case WM_CLOSE:
 		if (unsaved_warning()) {
+			end_save();
 			end_xaudio2();
 			ExitProcess(0);
 		}
@@ -922,6 +1225,17 @@ static LRESULT __stdcall wnd_proc(HWND wnd, UINT msg, WPARAM wp, LPARAM lp)
 	case WM_SIZE:
 		update_size(LOWORD(lp), HIWORD(lp));
 		return 0;
+	case WM_SAVED:
+		/*only report saves the user asked for*/
+		if (wp && !lp) {
+			g_change = true;
+			err_wnd(g_wnd, L"Could not save map");
+		}
+		/*failed autosaves are tried again on the next tick*/
+		if (wp && lp) {
+			g_autosaved = g_edits - 1;
+		}
+		return 0;
 	}
 	return (g_running ? game_proc : editor_proc)(wnd, msg, wp, lp);
 }
@@ -988,24 +1302,21 @@ static void editor_loop(void)
 	if (g_cam.h < g_gm->h) {
 		EnableScrollBar(g_wnd, SB_VERT, ESB_ENABLE_BOTH); 
 	}
+	/*camera is restored when game ends*/
+	invalidate_view();
 	while (!g_running && GetMessageW(&msg, NULL, 0, 0)) {
 		if (!TranslateAccelerator(g_wnd, g_acc, &msg)) {
 		    TranslateMessage(&msg);
 		    DispatchMessage(&msg);
 		}
-		
-		render();
-	}
-}
 
-/**
- * query_perf_counter() - Wrapper around QueryPerformanceConter
- */
-static int64_t query_perf_counter(void)
-{
-	LARGE_INTEGER counter;
-	QueryPerformanceCounter(&counter);
-	return counter.QuadPart;
+		/*apply and draw a burst of messages once it is drained*/
+		if (!g_running && !PeekMessageW(&msg, NULL, 0, 0,
+				PM_NOREMOVE)) {
+			flush_brush();
+			render_dirty();
+		}
+	}
 }
 
 /**
@@ -1022,8 +1333,36 @@ static void process_game_msgs(void)
 	}
 }
 
+/**
+ * wait_frame() - Handle messages and poll input until deadline
+ * @deadline: Performance counter to return at
+ *
+ * Messages are handled as they arrive instead of once a frame,
+ * so input is stamped when it happens.
+ */
+static void wait_frame(int64_t deadline)
+{
+	while (g_running) {
+		int64_t now;
+
+		process_game_msgs();
+		now = query_perf_counter();
+		poll_input(now);
+		if (now >= deadline) {
+			break;
+		}
+		MsgWaitForMultipleObjects(0, NULL, FALSE,
+				(deadline - now) * 1000 / g_perf_freq,
+				QS_ALLINPUT);
+	}
+}
+
 /**
  * game_loop() - Game loop of program
+ *
+ * Each frame steps the simulation up to every queued event in
+ * turn, so input lands on the tick it happened at instead of
+ * the start of the next frame.
  */
 static void game_loop(void)
 {
@@ -1031,23 +1370,102 @@ static void game_loop(void)
 
 	EnableScrollBar(g_wnd, SB_BOTH, ESB_DISABLE_BOTH);
 	begin = query_perf_counter(); 
-	g_dt = 0.0F;
 	
+	start_render_thread();
 	while (g_running) {
-		int64_t end; 
-		int64_t dpc;
+		int64_t now;
+		int64_t next;
+
+		now = query_perf_counter();
+		poll_input(now);
+		while ((next = next_input()) <= now) {
+			if (next > begin) {
+				step_sim(begin, next);
+				begin = next;
+			}
+			apply_input(next);
+		}
+		step_sim(begin, now);
+		submit_frame(now);
+		begin = now;
+		wait_frame(now + g_perf_freq / 100);
+	}
+	stop_render_thread();
+	print_input_latency();
+}
 
-		update_input();
-		process_game_msgs();
-		update_entities();
-		render();
-		Sleep(10);
-		
-		end = query_perf_counter(); 
-		dpc = end - begin;
-		g_dt = fminf(dpc / (float) g_perf_freq, 0.1F);
-		begin = end;
+/**
+ * bench_sim() - Measure simulated frames per second without rendering
+ * @path: Path of map to simulate
+ *
+ * Runs SIM_BENCH_FRAMES frames of 1/60 seconds with run_sim(),
+ * reading the source chosen on the command line or a bot if none
+ * was. Several seeds can be run at once as separate processes.
+ */
+static void bench_sim(const wchar_t *path)
+{
+	int64_t begin;
+	int64_t end;
+	const entity *e;
+	double ms;
+
+	if (read_map(path) < 0 || start_entities() < 0) {
+		fprintf(stderr, "sim: Failed to start %ls\n", path);
+		return;
+	}
+
+	if (!g_script.poll) {
+		g_script.poll = poll_bot;
+		g_script.ctx = &g_bot;
+	}
+	if (g_script.poll == poll_replay) {
+		open_replay(&g_replay, g_replay_path, 0);
+	} else {
+		init_bot(&g_bot, g_bot_seed, 0);
+	}
+	set_input_src(&g_script);
+
+	begin = query_perf_counter();
+	run_sim(SIM_BENCH_FRAMES, 60);
+	end = query_perf_counter();
+
+	ms = (end - begin) * 1000.0 / g_perf_freq;
+	e = get_captain();
+	fprintf(stderr, "sim: %d frames in %.1f ms, %.0f frames/s, "
+			"captain at %.1f, %.1f\n", SIM_BENCH_FRAMES, ms,
+			SIM_BENCH_FRAMES * 1000.0 / ms, e->pos.x, e->pos.y);
+
+	end_entities();
+	close_replay(&g_replay);
+	set_input_src(NULL);
+}
+
+/**
+ * get_arg_path() - Copy path given to command line option
+ * @cmd: Command line
+ * @name: Option including the equals sign
+ * @path: Buffer of MAX_PATH to copy to
+ *
+ * Return: True if option was given with a path
+ */
+static bool get_arg_path(const wchar_t *cmd, const wchar_t *name,
+		wchar_t *path)
+{
+	const wchar_t *arg;
+	size_t n;
+
+	arg = wcsstr(cmd, name);
+	if (!arg) {
+		return false;
 	}
+	arg += wcslen(name);
+	n = wcscspn(arg, L" \t");
+	if (n >= MAX_PATH) {
+		n = MAX_PATH - 1;
+	}
+	wmemcpy(path, arg, n);
+	path[n] = L'\0';
+	return n > 0;
 }
 
 /**
@@ -1075,21 +1493,58 @@ static void msg_loop(void)
  */
 int __stdcall wWinMain(HINSTANCE ins, HINSTANCE prev, wchar_t *cmd, int show) 
 {
+	const wchar_t *arg;
+	wchar_t sim_path[MAX_PATH];
+	int ring_ms;
+
 	UNREFERENCED_PARAMETER(prev);
-	UNREFERENCED_PARAMETER(cmd);
 	UNREFERENCED_PARAMETER(show);
 
 	g_ins = ins;
-	QueryPerformanceFrequency((LARGE_INTEGER *) &g_perf_freq);
+	g_perf_freq = query_perf_freq();
 	set_default_directory();
 	init_res_path();
 	init_tables();
-	init_xaudio2();
-	init_input();
+
+	ring_ms = AUDIO_RING_MS;
+	arg = wcsstr(cmd, L"--audio-ms=");
+	if (arg) {
+		ring_ms = max(_wtoi(arg + wcslen(L"--audio-ms=")), 1);
+	}
+	init_xaudio2(ring_ms);
+	init_devices();
+	init_input(&g_device_input);
+	set_entity_host(&g_entity_host);
+	init_journal(&g_journal);
+
+	get_arg_path(cmd, L"--record=", g_record_path);
+	arg = wcsstr(cmd, L"--bot=");
+	if (arg) {
+		g_bot_seed = _wtoi(arg + wcslen(L"--bot="));
+		g_script.poll = poll_bot;
+		g_script.ctx = &g_bot;
+	}
+	if (get_arg_path(cmd, L"--replay=", g_replay_path)) {
+		g_script.poll = poll_replay;
+		g_script.ctx = &g_replay;
+	}
+
 	create_main_window();
+	init_save(g_wnd);
+	SetTimer(g_wnd, ID_AUTOSAVE, AUTOSAVE_MS, NULL);
 	init_gl();
 	g_gm = create_game_map();
 	size_game_map(g_gm, VIEW_TW, VIEW_TH);
+	if (wcsstr(cmd, L"--bench-render")) {
+		ShowWindow(g_wnd, SW_SHOW);
+		bench_render();
+		ExitProcess(0);
+	}
+	if (get_arg_path(cmd, L"--bench-sim=", sim_path)) {
+		bench_sim(sim_path);
+		end_xaudio2();
+		ExitProcess(0);
+	}
 	msg_loop();
 	
 	return 0;
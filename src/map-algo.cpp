@@ -0,0 +1,358 @@
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "map-algo.hpp"
+#include "util.hpp"
+
+/**
+ * Tiles compared at once
+ */
+#define LANES 16
+
+/**
+ * Vectors summed in byte lanes before they could overflow
+ */
+#define MAX_SUMS 255
+
+/**
+ * tile_match - Set of tiles ready to compare against
+ * @keys: Each tile of set, repeated in every lane
+ * @count: Count of keys
+ * @set: TILE_BIT() of each tile
+ */
+struct tile_match {
+#ifdef __SSE2__
+	__m128i keys[COUNTOF_TILES];
+#endif
+	int count;
+	unsigned set;
+};
+
+/**
+ * init_match() - Prepare set of tiles for comparing
+ * @m: Match to initialize
+ * @set: TILE_BIT() of each tile, bits past the last tile are ignored
+ */
+static void init_match(tile_match *m, unsigned set)
+{
+	int t;
+
+	m->count = 0;
+	m->set = set & (TILE_BIT(COUNTOF_TILES) - 1);
+	for (t = 0; t < COUNTOF_TILES; t++) {
+		if (m->set & TILE_BIT(t)) {
+#ifdef __SSE2__
+			m->keys[m->count] = _mm_set1_epi8(t);
+#endif
+			m->count++;
+		}
+	}
+}
+
+/**
+ * in_match() - Check if tile is in set
+ * @m: Match
+ * @tile: Tile to check
+ *
+ * Return: True if tile is in set
+ */
+static bool in_match(const tile_match *m, int tile)
+{
+	return tile < COUNTOF_TILES && (m->set & TILE_BIT(tile));
+}
+
+#ifdef __SSE2__
+/**
+ * match_lanes() - Compare lanes of tiles against set
+ * @m: Match
+ * @v: Tiles to compare
+ *
+ * Return: 0xFF in each lane holding a tile of set, 0 elsewhere
+ */
+static __m128i match_lanes(const tile_match *m, __m128i v)
+{
+	__m128i eq;
+	int i;
+
+	eq = _mm_setzero_si128();
+	for (i = 0; i < m->count; i++) {
+		eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, m->keys[i]));
+	}
+	return eq;
+}
+
+/**
+ * sum_lanes() - Sum byte lanes
+ * @sums: Lanes to sum
+ *
+ * Return: Sum of every lane
+ */
+static int sum_lanes(__m128i sums)
+{
+	sums = _mm_sad_epu8(sums, _mm_setzero_si128());
+	return _mm_cvtsi128_si32(sums) +
+			_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+}
+#endif
+
+/**
+ * find_row() - Find first tile of set in row from column
+ * @row: Row of tiles
+ * @x: Column to search from
+ * @w: Width of row
+ * @m: Match
+ *
+ * Return: Column of tile found, w if none
+ */
+static int find_row(const uint8_t *row, int x, int w, const tile_match *m)
+{
+#ifdef __SSE2__
+	for (; x + LANES <= w; x += LANES) {
+		__m128i v;
+		int bits;
+
+		v = _mm_loadu_si128((const __m128i *) (row + x));
+		bits = _mm_movemask_epi8(match_lanes(m, v));
+		if (bits) {
+			return x + __builtin_ctz(bits);
+		}
+	}
+#endif
+	while (x < w && !in_match(m, row[x])) {
+		x++;
+	}
+	return x;
+}
+
+/**
+ * rfind_row() - Find last tile of set in row down to column
+ * @row: Row of tiles
+ * @lo: Column to search down to
+ * @w: Width of row
+ * @m: Match
+ *
+ * Return: Column of tile found, lo - 1 if none
+ */
+static int rfind_row(const uint8_t *row, int lo, int w, const tile_match *m)
+{
+	int x;
+
+	x = w;
+#ifdef __SSE2__
+	for (; x - LANES >= lo; x -= LANES) {
+		__m128i v;
+		int bits;
+
+		v = _mm_loadu_si128((const __m128i *) (row + x - LANES));
+		bits = _mm_movemask_epi8(match_lanes(m, v));
+		if (bits) {
+			return x - LANES + 31 - __builtin_clz(bits);
+		}
+	}
+#endif
+	while (x > lo && !in_match(m, row[x - 1])) {
+		x--;
+	}
+	return x - 1;
+}
+
+/**
+ * count_row() - Count tiles of set in row
+ * @row: Row of tiles
+ * @w: Width of row
+ * @m: Match
+ *
+ * Return: Count of tiles
+ */
+static int count_row(const uint8_t *row, int w, const tile_match *m)
+{
+#ifdef __SSE2__
+	__m128i zero;
+#endif
+	int count;
+	int x;
+
+	count = 0;
+	x = 0;
+#ifdef __SSE2__
+	/*matches are -1, so subtracting them counts up each lane*/
+	zero = _mm_setzero_si128();
+	while (x + LANES <= w) {
+		__m128i sums;
+		int n;
+
+		sums = zero;
+		for (n = 0; n < MAX_SUMS && x + LANES <= w; n++) {
+			__m128i v;
+
+			v = _mm_loadu_si128((const __m128i *) (row + x));
+			sums = _mm_sub_epi8(sums, match_lanes(m, v));
+			x += LANES;
+		}
+		count += sum_lanes(sums);
+	}
+#endif
+	for (; x < w; x++) {
+		count += in_match(m, row[x]);
+	}
+	return count;
+}
+
+/**
+ * count_each_row() - Add count of each tile in row
+ * @row: Row of tiles
+ * @w: Width of row
+ * @counts: Count of each tile to add to
+ */
+static void count_each_row(const uint8_t *row, int w,
+		int counts[COUNTOF_TILES])
+{
+#ifdef __SSE2__
+	__m128i zero;
+#endif
+	int x;
+
+	x = 0;
+#ifdef __SSE2__
+	/*one load feeds a byte counter of every tile*/
+	zero = _mm_setzero_si128();
+	while (x + LANES <= w) {
+		__m128i sums[COUNTOF_TILES];
+		int n;
+		int t;
+
+		for (t = 0; t < COUNTOF_TILES; t++) {
+			sums[t] = zero;
+		}
+		for (n = 0; n < MAX_SUMS && x + LANES <= w; n++) {
+			__m128i v;
+
+			v = _mm_loadu_si128((const __m128i *) (row + x));
+			for (t = 0; t < COUNTOF_TILES; t++) {
+				sums[t] = _mm_sub_epi8(sums[t], _mm_cmpeq_epi8(
+						v, _mm_set1_epi8(t)));
+			}
+			x += LANES;
+		}
+		for (t = 0; t < COUNTOF_TILES; t++) {
+			counts[t] += sum_lanes(sums[t]);
+		}
+	}
+#endif
+	for (; x < w; x++) {
+		if (row[x] < COUNTOF_TILES) {
+			counts[row[x]]++;
+		}
+	}
+}
+
+int find_tiles(const uint8_t *row, int x, int w, unsigned set)
+{
+	tile_match m;
+
+	init_match(&m, set);
+	return find_row(row, x, w, &m);
+}
+
+int count_tiles(const game_map *gm, unsigned set)
+{
+	tile_match m;
+	int count;
+	int y;
+
+	init_match(&m, set);
+	count = 0;
+	for (y = 0; y < gm->h; y++) {
+		count += count_row(gm->rows[y], gm->w, &m);
+	}
+	return count;
+}
+
+void count_each_tile(const game_map *gm, int counts[COUNTOF_TILES])
+{
+	int y;
+
+	memset(counts, 0, COUNTOF_TILES * sizeof(*counts));
+	for (y = 0; y < gm->h; y++) {
+		count_each_row(gm->rows[y], gm->w, counts);
+	}
+}
+
+tile_box bound_tiles(const game_map *gm, unsigned set)
+{
+	tile_match m;
+	tile_box box;
+	int y;
+
+	init_match(&m, set);
+	box.l = gm->w;
+	box.t = gm->h;
+	box.r = -1;
+	box.b = -1;
+	for (y = 0; y < gm->h; y++) {
+		const uint8_t *row;
+		int x;
+
+		row = gm->rows[y];
+		x = find_row(row, 0, gm->w, &m);
+		if (x == gm->w) {
+			continue;
+		}
+
+		/*right edge only grows from columns past it*/
+		box.l = min(box.l, x);
+		box.r = max(box.r, rfind_row(row, max(x, box.r + 1),
+				gm->w, &m));
+		box.t = min(box.t, y);
+		box.b = y;
+	}
+	return box;
+}
+
+int replace_tiles(game_map *gm, const tile_box *box, int from, int to)
+{
+#ifdef __SSE2__
+	__m128i vf, vt;
+#endif
+	int count;
+	int y;
+
+	count = 0;
+#ifdef __SSE2__
+	vf = _mm_set1_epi8(from);
+	vt = _mm_set1_epi8(to);
+#endif
+	for (y = box->t; y <= box->b; y++) {
+		uint8_t *row;
+		int x;
+
+		row = gm->rows[y];
+		x = box->l;
+#ifdef __SSE2__
+		for (; x + LANES <= box->r + 1; x += LANES) {
+			__m128i v, eq;
+			int bits;
+
+			v = _mm_loadu_si128((const __m128i *) (row + x));
+			eq = _mm_cmpeq_epi8(v, vf);
+			bits = _mm_movemask_epi8(eq);
+			if (bits) {
+				v = _mm_or_si128(_mm_andnot_si128(eq, v),
+						_mm_and_si128(eq, vt));
+				_mm_storeu_si128((__m128i *) (row + x), v);
+				count += __builtin_popcount(bits);
+			}
+		}
+#endif
+		for (; x <= box->r; x++) {
+			if (row[x] == from) {
+				row[x] = to;
+				count++;
+			}
+		}
+	}
+	return count;
+}
@@ -0,0 +1,63 @@
+#ifndef MAP_ALGO_HPP
+#define MAP_ALGO_HPP
+
+#include <stdint.h>
+
+#include "game-map.hpp"
+
+/**
+ * Bit of tile in a set of tiles
+ */
+#define TILE_BIT(tile) (1U << (tile))
+
+/**
+ * find_tiles() - Find next tile of set in row
+ * @row: Row of tiles
+ * @x: Column to search from
+ * @w: Width of row
+ * @set: TILE_BIT() of each tile to find
+ *
+ * Finding every tile of a set is calling this again from
+ * the column after the one found.
+ *
+ * Return: Column of tile found, w if none
+ */
+int find_tiles(const uint8_t *row, int x, int w, unsigned set);
+
+/**
+ * count_tiles() - Count tiles of set in map
+ * @gm: Game map
+ * @set: TILE_BIT() of each tile to count
+ *
+ * Return: Count of tiles
+ */
+int count_tiles(const game_map *gm, unsigned set);
+
+/**
+ * count_each_tile() - Count tiles of each kind in map
+ * @gm: Game map
+ * @counts: Count of each tile
+ */
+void count_each_tile(const game_map *gm, int counts[COUNTOF_TILES]);
+
+/**
+ * bound_tiles() - Get box bounding tiles of set
+ * @gm: Game map
+ * @set: TILE_BIT() of each tile to bound
+ *
+ * Return: Smallest box holding every tile of set, empty if none
+ */
+tile_box bound_tiles(const game_map *gm, unsigned set);
+
+/**
+ * replace_tiles() - Replace tile with another in box
+ * @gm: Game map
+ * @box: Box of tiles to replace, must be in map
+ * @from: Tile to replace
+ * @to: Tile to replace with
+ *
+ * Return: Count of tiles replaced
+ */
+int replace_tiles(game_map *gm, const tile_box *box, int from, int to);
+
+#endif
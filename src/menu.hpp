@@ -17,10 +17,15 @@
 #define IDM_REDO 0x2001 
 #define IDM_GRID 0x2002
 #define IDM_RESIZE 0x2003
+#define IDM_CUT 0x2004
+#define IDM_COPY 0x2005
+#define IDM_PASTE 0x2006
+#define IDM_REPLACE 0x2007
 
 #define IDM_ZOOM_IN 0x3000
 #define IDM_ZOOM_OUT 0x3001
 #define IDM_ZOOM_DEF 0x3002
+#define IDM_MINIMAP 0x3003
 
 #define IDM_BLANK 0x4000
 #define IDM_GRASS 0x4001
@@ -31,6 +36,11 @@
 
 #define IDM_RUN 0x6000
 
+#define IDM_PENCIL 0x7000
+#define IDM_FILL 0x7001
+#define IDM_RECT 0x7002
+#define IDM_SELECT 0x7003
+
 #define IDD_STATIC 0x1000
 #define IDD_WIDTH 0x1001
 #define IDD_HEIGHT 0x1002
@@ -0,0 +1,149 @@
+#include <string.h>
+
+#include "minimap.hpp"
+#include "util.hpp"
+
+void init_minimap(minimap *mm)
+{
+	size_t size;
+	int i;
+
+	memset(mm, 0, sizeof(*mm));
+	size = 0;
+	for (i = 0; i < MINIMAP_LEVELS; i++) {
+		size += (MINIMAP_LEN >> i) * (MINIMAP_LEN >> i);
+	}
+
+	mm->texels[0] = (uint32_t *) xcalloc(size, sizeof(uint32_t));
+	for (i = 1; i < MINIMAP_LEVELS; i++) {
+		int len;
+
+		len = MINIMAP_LEN >> (i - 1);
+		mm->texels[i] = mm->texels[i - 1] + len * len;
+	}
+	mm->dirty = empty_box();
+}
+
+void mark_minimap(minimap *mm, int l, int t, int r, int b)
+{
+	grow_box(&mm->dirty, l, t, r, b);
+}
+
+/**
+ * avg_texels() - Average four RGBA texels
+ *
+ * Return: Average of each channel
+ */
+static uint32_t avg_texels(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	uint32_t rb;
+	uint32_t ga;
+
+	/*each channel sums to at most ten bits in a sixteen bit lane*/
+	rb = (a & 0x00FF00FF) + (b & 0x00FF00FF) +
+			(c & 0x00FF00FF) + (d & 0x00FF00FF);
+	ga = ((a >> 8) & 0x00FF00FF) + ((b >> 8) & 0x00FF00FF) +
+			((c >> 8) & 0x00FF00FF) + ((d >> 8) & 0x00FF00FF);
+	return ((rb >> 2) & 0x00FF00FF) | ((ga >> 2) & 0x00FF00FF) << 8;
+}
+
+/**
+ * add_upload() - Queue box of level zero for upload
+ * @mm: Minimap
+ * @box: Box to queue
+ *
+ * Once the queue is full, boxes are merged into the last.
+ */
+static void add_upload(minimap *mm, const tile_box *box)
+{
+	if (mm->upload_count < MINIMAP_BOXES) {
+		mm->upload[mm->upload_count++] = *box;
+	} else {
+		grow_box(mm->upload + MINIMAP_BOXES - 1,
+				box->l, box->t, box->r, box->b);
+	}
+}
+
+/**
+ * update_box() - Recompute box of tiles in every level
+ * @mm: Minimap
+ * @gm: Game map
+ * @box: Tiles to recompute, must be in level zero
+ */
+static void update_box(minimap *mm, const game_map *gm, tile_box box)
+{
+	int x, y;
+	int i;
+
+	if (box.l > box.r || box.t > box.b) {
+		return;
+	}
+	add_upload(mm, &box);
+
+	for (y = box.t; y <= box.b; y++) {
+		uint32_t *dst;
+
+		dst = mm->texels[0] + y * MINIMAP_LEN;
+		for (x = box.l; x <= box.r; x++) {
+			if (x < gm->w && y < gm->h) {
+				dst[x] = mm->colors[gm->rows[y][x]];
+			} else {
+				dst[x] = 0;
+			}
+		}
+	}
+
+	for (i = 1; i < MINIMAP_LEVELS; i++) {
+		const uint32_t *src;
+		int len;
+
+		src = mm->texels[i - 1];
+		len = MINIMAP_LEN >> i;
+		box.l /= 2;
+		box.t /= 2;
+		box.r /= 2;
+		box.b /= 2;
+		for (y = box.t; y <= box.b; y++) {
+			const uint32_t *s0, *s1;
+			uint32_t *dst;
+
+			s0 = src + 2 * y * 2 * len;
+			s1 = s0 + 2 * len;
+			dst = mm->texels[i] + y * len;
+			for (x = box.l; x <= box.r; x++) {
+				dst[x] = avg_texels(s0[2 * x], s0[2 * x + 1],
+						s1[2 * x], s1[2 * x + 1]);
+			}
+		}
+	}
+}
+
+void update_minimap(minimap *mm, const game_map *gm)
+{
+	tile_box box;
+
+	/*columns gained or lost, then rows below the columns kept*/
+	if (mm->w != gm->w || mm->h != gm->h) {
+		box.l = min(mm->w, gm->w);
+		box.t = 0;
+		box.r = max(mm->w, gm->w) - 1;
+		box.b = max(mm->h, gm->h) - 1;
+		update_box(mm, gm, box);
+
+		box.r = box.l - 1;
+		box.l = 0;
+		box.t = min(mm->h, gm->h);
+		update_box(mm, gm, box);
+
+		mm->w = gm->w;
+		mm->h = gm->h;
+	}
+
+	box = mm->dirty;
+	box.l = max(box.l, 0);
+	box.t = max(box.t, 0);
+	box.r = min(box.r, gm->w - 1);
+	box.b = min(box.b, gm->h - 1);
+	update_box(mm, gm, box);
+	mm->dirty = empty_box();
+}
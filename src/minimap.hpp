@@ -0,0 +1,80 @@
+#ifndef MINIMAP_HPP
+#define MINIMAP_HPP
+
+#include <stdint.h>
+
+#include "game-map.hpp"
+
+/**
+ * Side of level zero in texels, a power of two that fits
+ * the largest map
+ */
+#define MINIMAP_LEN 1024
+
+/**
+ * Count of levels, halving MINIMAP_LEN down to one texel
+ */
+#define MINIMAP_LEVELS 11
+
+/**
+ * Most boxes waiting to be uploaded, more are merged
+ */
+#define MINIMAP_BOXES 4
+
+/**
+ * minimap - Colour image of map, one texel per tile, with mipmaps
+ * @texels: RGBA of each level, level n is MINIMAP_LEN >> n square
+ * @colors: RGBA of each tile
+ * @w: Width of map image was last updated from
+ * @h: Height of map image was last updated from
+ * @dirty: Tiles changed since last update_minimap()
+ * @upload: Boxes of level zero updated but not yet uploaded
+ * @upload_count: Count of upload
+ *
+ * The map sits in the top left corner of each level, texels
+ * past the map are transparent. Texel (x, y) of level n is the
+ * average of tiles (x << n, y << n) up to the next texel, so
+ * changing a tile changes exactly one texel of each level.
+ */
+struct minimap {
+	uint32_t *texels[MINIMAP_LEVELS];
+	uint32_t colors[COUNTOF_TILES];
+	int w;
+	int h;
+	tile_box dirty;
+	tile_box upload[MINIMAP_BOXES];
+	int upload_count;
+};
+
+/**
+ * init_minimap() - Allocate minimap of empty map
+ * @mm: Minimap to initialize
+ *
+ * Colors of tiles must be set before the first update.
+ */
+void init_minimap(minimap *mm);
+
+/**
+ * mark_minimap() - Mark tiles as changed
+ * @mm: Minimap
+ * @l: Left of changed tiles
+ * @t: Top of changed tiles
+ * @r: Right of changed tiles, inclusive
+ * @b: Bottom of changed tiles, inclusive
+ *
+ * Tiles past the map are ignored by the next update.
+ */
+void mark_minimap(minimap *mm, int l, int t, int r, int b);
+
+/**
+ * update_minimap() - Recompute texels of changed tiles
+ * @mm: Minimap
+ * @gm: Game map
+ *
+ * Tiles gained or lost since the map was last sized are
+ * found from its width and height, so only marked tiles
+ * and the strips a resize touched are recomputed.
+ */
+void update_minimap(minimap *mm, const game_map *gm);
+
+#endif
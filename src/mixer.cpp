@@ -0,0 +1,360 @@
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "mixer.hpp"
+#include "util.hpp"
+
+#define PCM_SCALE (1.0F / 32768.0F)
+
+/**
+ * Position in a clip is a sample index with 32 fractional bits
+ */
+#define POS_SHIFT 32
+#define POS_ONE ((uint64_t) 1 << POS_SHIFT)
+
+void init_mixer(mixer *m)
+{
+	memset(m, 0, sizeof(*m));
+	m->gain = 1.0F;
+}
+
+/**
+ * start_voice() - Claim free voice slot
+ * @m: Mixer
+ *
+ * Return: Index of voice, negative if every voice is busy
+ */
+static int start_voice(mixer *m)
+{
+	int i;
+
+	for (i = 0; i < MAX_VOICES; i++) {
+		voice *v;
+
+		v = m->voices + i;
+		if (!v->active) {
+			memset(v, 0, sizeof(*v));
+			v->step = POS_ONE;
+			v->gain = 1.0F;
+			v->active = true;
+			return i;
+		}
+	}
+	return -1;
+}
+
+int play_voice(mixer *m, const int16_t *samples, int len, bool loop)
+{
+	int i;
+
+	i = start_voice(m);
+	if (i >= 0) {
+		m->voices[i].samples = samples;
+		m->voices[i].len = len;
+		m->voices[i].loop = loop;
+	}
+	return i;
+}
+
+int stream_voice(mixer *m, voice_read_fn *read, void *ctx)
+{
+	int i;
+
+	i = start_voice(m);
+	if (i >= 0) {
+		m->voices[i].read = read;
+		m->voices[i].ctx = ctx;
+	}
+	return i;
+}
+
+void set_voice(mixer *m, int i, float gain, float pan, float pitch)
+{
+	voice *v;
+
+	v = m->voices + i;
+	v->gain = gain;
+	v->pan = fclampf(pan, -1.0F, 1.0F);
+	v->step = fmaxf(pitch, 0.0F) * POS_ONE;
+}
+
+void stop_voice(mixer *m, int i)
+{
+	m->voices[i].active = false;
+}
+
+int count_voices(const mixer *m)
+{
+	int count;
+	int i;
+
+	count = 0;
+	for (i = 0; i < MAX_VOICES; i++) {
+		count += m->voices[i].active;
+	}
+	return count;
+}
+
+/**
+ * mix_mono() - Add mono samples to stereo bus
+ * @bus: Interleaved stereo bus
+ * @src: Mono samples
+ * @count: Count of samples
+ * @gl: Gain of left channel
+ * @gr: Gain of right channel
+ */
+static void mix_mono(float *bus, const int16_t *src, int count,
+		float gl, float gr)
+{
+#ifdef __SSE2__
+	__m128 vl, vr;
+#endif
+	int i;
+
+	gl *= PCM_SCALE;
+	gr *= PCM_SCALE;
+	i = 0;
+#ifdef __SSE2__
+	vl = _mm_set1_ps(gl);
+	vr = _mm_set1_ps(gr);
+	for (; i + 4 <= count; i += 4) {
+		__m128i s16, s32;
+		__m128 s, l, r;
+
+		/*sign extend 4 samples to 32 bits*/
+		s16 = _mm_loadl_epi64((const __m128i *) (src + i));
+		s32 = _mm_srai_epi32(_mm_unpacklo_epi16(s16, s16), 16);
+		s = _mm_cvtepi32_ps(s32);
+
+		l = _mm_mul_ps(s, vl);
+		r = _mm_mul_ps(s, vr);
+		_mm_storeu_ps(bus, _mm_add_ps(_mm_loadu_ps(bus),
+				_mm_unpacklo_ps(l, r)));
+		_mm_storeu_ps(bus + 4, _mm_add_ps(_mm_loadu_ps(bus + 4),
+				_mm_unpackhi_ps(l, r)));
+		bus += 8;
+	}
+#endif
+	for (; i < count; i++) {
+		bus[0] += src[i] * gl;
+		bus[1] += src[i] * gr;
+		bus += 2;
+	}
+}
+
+/**
+ * mix_pitched() - Add clip to stereo bus at non-unit pitch
+ * @bus: Interleaved stereo bus
+ * @v: Voice of clip, at least two samples long
+ * @count: Count of frames
+ * @gl: Gain of left channel
+ * @gr: Gain of right channel
+ *
+ * Return: Count of frames mixed, short if clip ended
+ */
+static int mix_pitched(float *bus, voice *v, int count,
+		float gl, float gr)
+{
+	uint64_t end;
+	int i;
+
+	gl *= PCM_SCALE;
+	gr *= PCM_SCALE;
+	end = (uint64_t) (v->len - 1) << POS_SHIFT;
+	for (i = 0; i < count; i++) {
+		const int16_t *s;
+		float t;
+		float x;
+
+		if (v->pos >= end) {
+			if (!v->loop) {
+				break;
+			}
+			v->pos %= end;
+		}
+
+		s = v->samples + (v->pos >> POS_SHIFT);
+		t = (v->pos & (POS_ONE - 1)) * (1.0F / POS_ONE);
+		x = s[0] + (s[1] - s[0]) * t;
+		bus[0] += x * gl;
+		bus[1] += x * gr;
+		bus += 2;
+		v->pos += v->step;
+	}
+	return i;
+}
+
+/**
+ * mix_single() - Add clip of one sample to stereo bus
+ * @bus: Interleaved stereo bus
+ * @v: Voice of clip
+ * @count: Count of frames
+ * @gl: Gain of left channel
+ * @gr: Gain of right channel
+ *
+ * The sample is held for as long as it lasts at the pitch
+ * of the voice, there is nothing to interpolate towards.
+ *
+ * Return: Count of frames mixed, short if clip ended
+ */
+static int mix_single(float *bus, voice *v, int count, float gl, float gr)
+{
+	float x;
+	int i;
+
+	x = v->samples[0] * PCM_SCALE;
+	for (i = 0; i < count; i++) {
+		if (v->pos >= POS_ONE) {
+			if (!v->loop) {
+				break;
+			}
+			v->pos &= POS_ONE - 1;
+		}
+		bus[0] += x * gl;
+		bus[1] += x * gr;
+		bus += 2;
+		v->pos += v->step;
+	}
+	return i;
+}
+
+/**
+ * mix_clip() - Add clip to stereo bus
+ * @bus: Interleaved stereo bus
+ * @v: Voice of clip
+ * @count: Count of frames
+ * @gl: Gain of left channel
+ * @gr: Gain of right channel
+ *
+ * Return: Count of frames mixed, short if clip ended
+ */
+static int mix_clip(float *bus, voice *v, int count, float gl, float gr)
+{
+	int done;
+
+	/*empty clips end at once, the caller then drops the voice*/
+	if (v->len < 1) {
+		return 0;
+	}
+	if (v->len == 1) {
+		return mix_single(bus, v, count, gl, gr);
+	}
+	if (v->step != POS_ONE) {
+		return mix_pitched(bus, v, count, gl, gr);
+	}
+
+	done = 0;
+	while (done < count) {
+		int start;
+		int n;
+
+		start = v->pos >> POS_SHIFT;
+		if (start >= v->len) {
+			if (!v->loop) {
+				break;
+			}
+			v->pos = 0;
+			start = 0;
+		}
+
+		n = min(count - done, v->len - start);
+		mix_mono(bus + 2 * done, v->samples + start, n, gl, gr);
+		v->pos += (uint64_t) n << POS_SHIFT;
+		done += n;
+	}
+	return done;
+}
+
+/**
+ * mix_voices() - Mix every active voice into bus
+ * @m: Mixer
+ * @frames: Count of frames, no more than MIX_FRAMES
+ */
+static void mix_voices(mixer *m, int frames)
+{
+	int i;
+
+	memset(m->bus, 0, frames * 2 * sizeof(*m->bus));
+	for (i = 0; i < MAX_VOICES; i++) {
+		voice *v;
+		float a;
+		float gl, gr;
+		int n;
+
+		v = m->voices + i;
+		if (!v->active) {
+			continue;
+		}
+
+		/*constant power pan*/
+		a = (v->pan + 1.0F) * (float) M_PI_4;
+		gl = v->gain * cosf(a);
+		gr = v->gain * sinf(a);
+
+		if (v->read) {
+			n = v->read(v->ctx, m->scratch, frames);
+			mix_mono(m->bus, m->scratch, n, gl, gr);
+		} else {
+			n = mix_clip(m->bus, v, frames, gl, gr);
+		}
+
+		if (n < frames) {
+			v->active = false;
+		}
+	}
+}
+
+/**
+ * bus_to_pcm() - Convert bus to 16 bit, saturating
+ * @out: Output PCM
+ * @bus: Interleaved stereo bus
+ * @count: Count of samples, twice the count of frames
+ * @gain: Master gain
+ */
+static void bus_to_pcm(int16_t *out, const float *bus, int count,
+		float gain)
+{
+#ifdef __SSE2__
+	__m128 vg, vlo, vhi;
+#endif
+	int i;
+
+	gain *= 32767.0F;
+	i = 0;
+#ifdef __SSE2__
+	/*clamp before converting, out of range floats convert to INT_MIN*/
+	vg = _mm_set1_ps(gain);
+	vlo = _mm_set1_ps(-32768.0F);
+	vhi = _mm_set1_ps(32767.0F);
+	for (; i + 8 <= count; i += 8) {
+		__m128 a, b;
+
+		a = _mm_mul_ps(_mm_loadu_ps(bus + i), vg);
+		b = _mm_mul_ps(_mm_loadu_ps(bus + i + 4), vg);
+		a = _mm_min_ps(_mm_max_ps(a, vlo), vhi);
+		b = _mm_min_ps(_mm_max_ps(b, vlo), vhi);
+		_mm_storeu_si128((__m128i *) (out + i), _mm_packs_epi32(
+				_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = lrintf(fclampf(bus[i] * gain, -32768.0F, 32767.0F));
+	}
+}
+
+void mix_audio(mixer *m, int16_t *out, int frames)
+{
+	while (frames > 0) {
+		int n;
+
+		n = min(frames, MIX_FRAMES);
+		mix_voices(m, n);
+		bus_to_pcm(out, m->bus, n * 2, m->gain);
+		out += n * 2;
+		frames -= n;
+	}
+}
@@ -0,0 +1,135 @@
+#ifndef MIXER_HPP
+#define MIXER_HPP
+
+#include <stdint.h>
+
+/**
+ * Sample rate of bus and of every voice at a pitch of one
+ */
+#define MIX_RATE 48000
+
+#define MAX_VOICES 32
+
+/**
+ * Frames of bus mixed per pass, larger requests are split
+ */
+#define MIX_FRAMES 512
+
+/**
+ * voice_read_fn - Pull samples of streamed voice
+ * @ctx: Context given to stream_voice()
+ * @dst: Mono samples to fill
+ * @count: Count of samples requested
+ *
+ * Return: Count of samples read, stream ends when short
+ */
+typedef int voice_read_fn(void *ctx, int16_t *dst, int count);
+
+/**
+ * voice - Mono source mixed into the stereo bus
+ * @samples: PCM of clip, NULL if streamed
+ * @len: Count of samples in clip
+ * @read: Pulls samples of stream, NULL if clip
+ * @ctx: Passed to read
+ * @pos: Read position in clip, 32.32 fixed point
+ * @step: Added to pos every frame, 32.32 fixed point
+ * @gain: Linear gain
+ * @pan: From -1 full left to 1 full right
+ * @loop: Clip restarts when it ends
+ * @active: Voice is being mixed
+ *
+ * Streams are always mixed at a pitch of one.
+ */
+struct voice {
+	const int16_t *samples;
+	int len;
+	voice_read_fn *read;
+	void *ctx;
+	uint64_t pos;
+	uint64_t step;
+	float gain;
+	float pan;
+	bool loop;
+	bool active;
+};
+
+/**
+ * mixer - Software mixer of voices into a stereo float bus
+ * @voices: Voice slots
+ * @gain: Master gain, applied when converting bus to output
+ * @bus: Interleaved stereo bus of current pass
+ * @scratch: Samples pulled from a stream
+ *
+ * Mixing is done in float and only saturated to 16 bit
+ * once, when converting the bus to output.
+ */
+struct mixer {
+	voice voices[MAX_VOICES];
+	float gain;
+	alignas(16) float bus[MIX_FRAMES * 2];
+	alignas(16) int16_t scratch[MIX_FRAMES];
+};
+
+/**
+ * init_mixer() - Initialize mixer with no active voices
+ * @m: Mixer to initialize
+ */
+void init_mixer(mixer *m);
+
+/**
+ * play_voice() - Start mixing clip
+ * @m: Mixer
+ * @samples: Mono PCM at MIX_RATE, must outlive voice
+ * @len: Count of samples
+ * @loop: Clip restarts when it ends
+ *
+ * Voice starts at full gain, center pan, and a pitch of one.
+ *
+ * Return: Index of voice, negative if every voice is busy
+ */
+int play_voice(mixer *m, const int16_t *samples, int len, bool loop);
+
+/**
+ * stream_voice() - Start mixing stream
+ * @m: Mixer
+ * @read: Pulls samples of stream, called while mixing
+ * @ctx: Passed to read
+ *
+ * Return: Index of voice, negative if every voice is busy
+ */
+int stream_voice(mixer *m, voice_read_fn *read, void *ctx);
+
+/**
+ * set_voice() - Change parameters of voice
+ * @m: Mixer
+ * @i: Index of voice
+ * @gain: Linear gain
+ * @pan: From -1 full left to 1 full right
+ * @pitch: Playback rate, ignored for streams
+ */
+void set_voice(mixer *m, int i, float gain, float pan, float pitch);
+
+/**
+ * stop_voice() - Stop mixing voice
+ * @m: Mixer
+ * @i: Index of voice
+ */
+void stop_voice(mixer *m, int i);
+
+/**
+ * count_voices() - Count of active voices
+ * @m: Mixer
+ *
+ * Return: Count of voices being mixed
+ */
+int count_voices(const mixer *m);
+
+/**
+ * mix_audio() - Mix active voices into output
+ * @m: Mixer
+ * @out: Interleaved stereo 16 bit PCM
+ * @frames: Count of frames to mix
+ */
+void mix_audio(mixer *m, int16_t *out, int frames);
+
+#endif
@@ -0,0 +1,289 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <stb_vorbis.c>
+
+#include "music.hpp"
+
+/**
+ * read_tag() - Read integer value of vorbis comment
+ * @vorb: Decoder
+ * @name: Name of comment, including the '='
+ * @val: Value of comment, unchanged if missing
+ *
+ * Return: True if comment was found
+ */
+static bool read_tag(stb_vorbis *vorb, const char *name, uint32_t *val)
+{
+	stb_vorbis_comment vc;
+	size_t len;
+	int i;
+
+	vc = stb_vorbis_get_comment(vorb);
+	len = strlen(name);
+	for (i = 0; i < vc.comment_list_length; i++) {
+		if (!strncmp(vc.comment_list[i], name, len)) {
+			*val = strtoul(vc.comment_list[i] + len, NULL, 10);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * decode_block() - Decode samples ahead of time
+ * @vorb: Decoder of file
+ * @from: Sample block starts at
+ * @len: Count of samples in block
+ *
+ * Return: Samples of block, NULL on failure
+ */
+static int16_t *decode_block(stb_vorbis *vorb, uint32_t from, uint32_t len)
+{
+	int16_t *block;
+	int16_t *dst;
+	uint32_t done;
+	int n;
+
+	block = (int16_t *) malloc(len * sizeof(*block));
+	if (!block || !stb_vorbis_seek(vorb, from)) {
+		free(block);
+		return NULL;
+	}
+
+	dst = block;
+	for (done = 0; done < len; done += n) {
+		n = stb_vorbis_get_samples_short(vorb, 1, &dst, len - done);
+		if (n <= 0) {
+			free(block);
+			return NULL;
+		}
+		dst += n;
+	}
+	return block;
+}
+
+int init_track(track *t, stb_vorbis *vorb)
+{
+	uint32_t loop_len;
+	uint32_t len;
+
+	memset(t, 0, sizeof(*t));
+	t->len = stb_vorbis_stream_length_in_samples(vorb);
+	if (!t->len) {
+		return -1;
+	}
+	t->rate = stb_vorbis_get_info(vorb).sample_rate;
+
+	t->loop_end = t->len;
+	read_tag(vorb, "LOOPSTART=", &t->loop_start);
+	if (read_tag(vorb, "LOOPLENGTH=", &loop_len)) {
+		t->loop_end = t->loop_start + loop_len;
+	} else {
+		read_tag(vorb, "LOOPEND=", &t->loop_end);
+	}
+
+	if (t->loop_end > t->len || t->loop_start >= t->loop_end) {
+		t->loop_start = 0;
+		t->loop_end = t->len;
+	}
+
+	len = (uint64_t) t->rate * LOOP_BLOCK_MS / 1000;
+	t->block_len = len < t->loop_end - t->loop_start ?
+			len : t->loop_end - t->loop_start;
+	t->block = decode_block(vorb, t->loop_start, t->block_len);
+	if (!t->block) {
+		destroy_track(t);
+		return -1;
+	}
+
+	/*a loop from the start plays the same samples either way*/
+	if (!t->loop_start) {
+		t->start = t->block;
+		t->start_len = t->block_len;
+	} else {
+		t->start_len = len < t->loop_end ? len : t->loop_end;
+		t->start = decode_block(vorb, 0, t->start_len);
+		if (!t->start) {
+			destroy_track(t);
+			return -1;
+		}
+	}
+	stb_vorbis_seek_start(vorb);
+	return 0;
+}
+
+void destroy_track(track *t)
+{
+	if (t->start != t->block) {
+		free(t->start);
+	}
+	free(t->block);
+	t->block = NULL;
+	t->block_len = 0;
+	t->start = NULL;
+	t->start_len = 0;
+}
+
+/**
+ * get_block() - Block music is playing from
+ * @m: Music
+ * @len: Count of samples in block
+ *
+ * Return: Samples of block, starting at block_at
+ */
+static const int16_t *get_block(const music *m, uint32_t *len)
+{
+	if (m->block_at) {
+		*len = m->t->block_len;
+		return m->t->block;
+	}
+	*len = m->t->start_len;
+	return m->t->start;
+}
+
+int seek_music(music *m, uint32_t sample)
+{
+	if (!stb_vorbis_seek(m->vorb, sample)) {
+		return -1;
+	}
+
+	m->pos = sample;
+	m->in_block = false;
+	m->seek_due = false;
+	return 0;
+}
+
+void rewind_music(music *m)
+{
+	m->pos = 0;
+	m->block_at = 0;
+	m->in_block = true;
+	m->seek_due = m->t->start_len < m->t->loop_end;
+}
+
+int prepare_music(music *m)
+{
+	uint32_t len;
+
+	if (m->seek_due) {
+		get_block(m, &len);
+		if (!stb_vorbis_seek(m->vorb, m->block_at + len)) {
+			return -1;
+		}
+		m->seek_due = false;
+	}
+	return 0;
+}
+
+void fade_music(music *m, bool in, int len, int curve)
+{
+	int pos;
+
+	pos = 0;
+	if (m->fade_len > 0 && m->fade_out == in) {
+		pos = (int64_t) (m->fade_len - m->fade_pos) * len / m->fade_len;
+	}
+	m->fade_len = len;
+	m->fade_pos = pos;
+	m->curve = curve;
+	m->fade_out = !in;
+}
+
+bool music_silent(const music *m)
+{
+	return m->fade_out && m->fade_pos >= m->fade_len;
+}
+
+/**
+ * fade_gain() - Gain of music part way through fade
+ * @m: Music
+ *
+ * Return: Gain of next sample
+ */
+static float fade_gain(const music *m)
+{
+	float x;
+
+	x = (float) m->fade_pos / m->fade_len;
+	if (m->fade_out) {
+		x = 1.0F - x;
+	}
+	if (m->curve == FADE_EQUAL_POWER) {
+		x = sinf(x * (float) M_PI_2);
+	}
+	return x;
+}
+
+/**
+ * apply_fade() - Scale decoded samples by fade
+ * @m: Music
+ * @dst: Samples to scale
+ * @count: Count of samples
+ */
+static void apply_fade(music *m, int16_t *dst, int count)
+{
+	int i;
+
+	for (i = 0; i < count && m->fade_pos < m->fade_len; i++) {
+		dst[i] = dst[i] * fade_gain(m);
+		m->fade_pos++;
+	}
+	if (music_silent(m)) {
+		memset(dst + i, 0, (count - i) * sizeof(*dst));
+	}
+}
+
+int read_music(void *ctx, int16_t *dst, int count)
+{
+	const track *t;
+	music *m;
+	int remain;
+
+	m = (music *) ctx;
+	t = m->t;
+	remain = count;
+	while (remain > 0) {
+		const int16_t *block;
+		uint32_t len;
+		int n;
+
+		/*the block covers the loop start until the decoder seeks*/
+		if (m->pos >= t->loop_end) {
+			m->pos = t->loop_start;
+			m->block_at = t->loop_start;
+			m->in_block = true;
+			m->seek_due = t->loop_start + t->block_len <
+					t->loop_end;
+		}
+
+		block = get_block(m, &len);
+		if (m->in_block && m->pos < m->block_at + len) {
+			n = m->block_at + len - m->pos;
+			n = n < remain ? n : remain;
+			memcpy(dst, block + (m->pos - m->block_at),
+					n * sizeof(*dst));
+		} else {
+			m->in_block = false;
+			if (prepare_music(m) < 0) {
+				break;
+			}
+			n = t->loop_end - m->pos;
+			n = stb_vorbis_get_samples_short(m->vorb, 1, &dst,
+					n < remain ? n : remain);
+			if (n <= 0) {
+				break;
+			}
+		}
+
+		if (m->fade_pos < m->fade_len || m->fade_out) {
+			apply_fade(m, dst, n);
+		}
+		m->pos += n;
+		dst += n;
+		remain -= n;
+	}
+
+	return count - remain;
+}
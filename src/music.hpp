@@ -0,0 +1,156 @@
+#ifndef MUSIC_HPP
+#define MUSIC_HPP
+
+#include <stdint.h>
+
+/**
+ * Shapes of fades, equal power keeps loudness constant across
+ * a cross fade of unrelated tracks
+ */
+#define FADE_LINEAR 0
+#define FADE_EQUAL_POWER 1
+
+/**
+ * Length of start and loop start decoded ahead of time, covers
+ * the wait for the stream to have time to seek past them
+ */
+#define LOOP_BLOCK_MS 250
+
+struct stb_vorbis;
+
+/**
+ * track - Loop points of music, built once per file
+ * @len: Count of samples in track
+ * @rate: Sample rate of track
+ * @loop_start: Sample played after loop_end
+ * @loop_end: Sample after the last one played before looping
+ * @block: Samples from loop_start, played while the decoder seeks
+ * @block_len: Count of samples in block
+ * @start: Samples from the start, the block if the loop starts there
+ * @start_len: Count of samples in start
+ *
+ * Loop points come from LOOPSTART with LOOPLENGTH or LOOPEND
+ * comments, the whole track loops if they are missing.
+ */
+struct track {
+	uint32_t len;
+	int rate;
+	uint32_t loop_start;
+	uint32_t loop_end;
+	int16_t *block;
+	uint32_t block_len;
+	int16_t *start;
+	uint32_t start_len;
+};
+
+/**
+ * music - Playback of a track
+ * @vorb: Decoder opened on the track's file
+ * @t: Track being played
+ * @pos: Next sample played
+ * @fade_len: Count of samples fade lasts, zero if never faded
+ * @fade_pos: Samples of fade played
+ * @curve: FADE_* shape of fade
+ * @fade_out: Fading out to silence, otherwise in from silence
+ * @in_block: Playing from the start or loop start block of the track
+ * @seek_due: Decoder has yet to seek to the end of the block
+ * @block_at: Sample the block played from starts at
+ *
+ * Zeroed music plays at full gain.
+ */
+struct music {
+	stb_vorbis *vorb;
+	const track *t;
+	uint32_t pos;
+	int fade_len;
+	int fade_pos;
+	int curve;
+	bool fade_out;
+	bool in_block;
+	bool seek_due;
+	uint32_t block_at;
+};
+
+/**
+ * init_track() - Read loop points and decode start and loop start blocks
+ * @t: Track to initialize
+ * @vorb: Decoder of file, left at the start of the track
+ *
+ * Return: Zero on success, negative on failure
+ */
+int init_track(track *t, stb_vorbis *vorb);
+
+/**
+ * destroy_track() - Free blocks, safe to call if never built
+ * @t: Track to destroy
+ */
+void destroy_track(track *t);
+
+/**
+ * seek_music() - Seek to exact sample
+ * @m: Music to seek
+ * @sample: Sample decoded next
+ *
+ * Bisects the file for the page, so this is too slow to call
+ * while the stream is waiting on samples.
+ *
+ * Return: Zero on success, negative on failure
+ */
+int seek_music(music *m, uint32_t sample);
+
+/**
+ * rewind_music() - Play music from the start block of its track
+ * @m: Music
+ *
+ * Like looping, nothing is decoded or sought, so a track can
+ * be switched to without waiting on its decoder.
+ */
+void rewind_music(music *m);
+
+/**
+ * prepare_music() - Do seek left by looping or rewinding
+ * @m: Music
+ *
+ * Looping and rewinding play a block and leave the decoder to
+ * be moved past it, which is done here if the stream has time
+ * to spare, or else when the block runs out.
+ *
+ * Return: Zero on success, negative on failure
+ */
+int prepare_music(music *m);
+
+/**
+ * fade_music() - Start fading music in or out
+ * @m: Music to fade
+ * @in: Fade in from silence, otherwise out to silence
+ * @len: Count of samples fade lasts
+ * @curve: FADE_* shape of fade
+ *
+ * A fade reversed part way starts from the current gain.
+ */
+void fade_music(music *m, bool in, int len, int curve);
+
+/**
+ * music_silent() - Check if music has faded out
+ * @m: Music
+ *
+ * Return: True if music has finished fading out
+ */
+bool music_silent(const music *m);
+
+/**
+ * read_music() - Decode music for a streamed voice, looping at the end 
+ * @ctx: Music to decode
+ * @dst: Mono samples to fill
+ * @count: Count of samples requested
+ *
+ * Matches voice_read_fn, device independent so it can be
+ * driven by any output backend. Loops are sample accurate and
+ * fades are applied every sample. Looping never seeks unless
+ * prepare_music() was not called in time.
+ *
+ * Return: Count of samples read, short if decoding failed 
+ */
+int read_music(void *ctx, int16_t *dst, int count);
+
+#endif
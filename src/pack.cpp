@@ -0,0 +1,146 @@
+#include <limits.h>
+#include <string.h>
+
+#include "pack.hpp"
+
+void init_skyline(skyline *sl, int w, int h)
+{
+	sl->w = w;
+	sl->h = h;
+	sl->used = 0;
+	sl->count = 1;
+	sl->nodes[0].x = 0;
+	sl->nodes[0].y = 0;
+	sl->nodes[0].w = w;
+}
+
+/**
+ * fit_skyline() - Find where rectangle rests if placed at segment
+ * @sl: Skyline to check
+ * @i: Index of left-most segment under the rectangle
+ * @w: Width of rectangle
+ * @h: Height of rectangle
+ *
+ * Return: Top of rectangle, negative if rectangle does not fit
+ */
+static int fit_skyline(const skyline *sl, int i, int w, int h)
+{
+	const skyline_node *n;
+	int remain;
+	int y;
+
+	n = sl->nodes + i;
+	if (n->x + w > sl->w) {
+		return -1;
+	}
+
+	y = 0;
+	remain = w;
+	while (remain > 0) {
+		y = max(y, n->y);
+		if (y + h > sl->h) {
+			return -1;
+		}
+		remain -= n->w;
+		n++;
+	}
+	return y;
+}
+
+/**
+ * add_skyline() - Raise skyline to cover newly packed rectangle
+ * @sl: Skyline to modify
+ * @i: Index of left-most segment under the rectangle
+ * @x: Left-most pos of rectangle
+ * @y: Bottom of rectangle
+ * @w: Width of rectangle
+ */
+static void add_skyline(skyline *sl, int i, int x, int y, int w)
+{
+	skyline_node *n;
+	int j;
+
+	/*insert new segment*/
+	n = sl->nodes + i;
+	memmove(n + 1, n, (sl->count - i) * sizeof(*n));
+	n->x = x;
+	n->y = y;
+	n->w = w;
+	sl->count++;
+
+	/*shrink or remove segments now under the new segment*/
+	j = i + 1;
+	while (j < sl->count) {
+		skyline_node *c;
+		int shrink;
+
+		c = sl->nodes + j;
+		shrink = x + w - c->x;
+		if (shrink <= 0) {
+			break;
+		}
+		if (shrink < c->w) {
+			c->x += shrink;
+			c->w -= shrink;
+			break;
+		}
+		memmove(c, c + 1, (sl->count - j - 1) * sizeof(*c));
+		sl->count--;
+	}
+
+	/*merge segments of equal height*/
+	j = 0;
+	while (j < sl->count - 1) {
+		skyline_node *c;
+
+		c = sl->nodes + j;
+		if (c[0].y == c[1].y) {
+			c->w += c[1].w;
+			memmove(c + 1, c + 2,
+					(sl->count - j - 2) * sizeof(*c));
+			sl->count--;
+		} else {
+			j++;
+		}
+	}
+}
+
+int pack_skyline(skyline *sl, int w, int h, v2i *pos)
+{
+	int best;
+	int best_bottom;
+	int best_w;
+	int i;
+
+	if (w <= 0 || h <= 0 || sl->count == MAX_SKYLINE) {
+		return -1;
+	}
+
+	best = -1;
+	best_bottom = INT_MAX;
+	best_w = INT_MAX;
+	for (i = 0; i < sl->count; i++) {
+		int y;
+
+		y = fit_skyline(sl, i, w, h);
+		if (y < 0) {
+			continue;
+		}
+		if (y + h < best_bottom || (y + h == best_bottom &&
+				sl->nodes[i].w < best_w)) {
+			best = i;
+			best_bottom = y + h;
+			best_w = sl->nodes[i].w;
+		}
+	}
+
+	if (best < 0) {
+		return -1;
+	}
+
+	pos->x = sl->nodes[best].x;
+	pos->y = best_bottom - h;
+	add_skyline(sl, best, pos->x, best_bottom, w);
+	sl->used += w * h;
+	return 0;
+}
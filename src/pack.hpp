@@ -0,0 +1,66 @@
+#ifndef PACK_HPP
+#define PACK_HPP
+
+#include <stdint.h>
+#include "util.hpp"
+
+/**
+ * Maximum segments in a skyline, a bin can never need
+ * more segments than it has columns of packed rectangles
+ */
+#define MAX_SKYLINE 256
+
+/**
+ * struct skyline_node - Horizontal segment of skyline
+ * @x: Left-most pos of segment
+ * @y: Top of free space above segment
+ * @w: Width of segment
+ */
+struct skyline_node {
+	int16_t x;
+	int16_t y;
+	int16_t w;
+};
+
+/**
+ * struct skyline - Skyline bottom-left rectangle packer
+ * @w: Width of bin
+ * @h: Height of bin
+ * @used: Area taken up by packed rectangles
+ * @count: Count of segments
+ * @nodes: Segments ordered from left to right
+ *
+ * The bin is filled from the top down, the skyline
+ * being the lowest filled position of every column.
+ */
+struct skyline {
+	int w;
+	int h;
+	int used;
+	int count;
+	skyline_node nodes[MAX_SKYLINE];
+};
+
+/**
+ * init_skyline() - Initialize empty bin
+ * @sl: Skyline to initialize
+ * @w: Width of bin
+ * @h: Height of bin
+ */
+void init_skyline(skyline *sl, int w, int h);
+
+/**
+ * pack_skyline() - Find space for a rectangle and claim it
+ * @sl: Skyline to pack into
+ * @w: Width of rectangle
+ * @h: Height of rectangle
+ * @pos: Top-left of the packed rectangle
+ *
+ * Chooses the position that leaves the lowest top edge,
+ * breaking ties by the least width of the resting segment.
+ *
+ * Return: Zero on success, negative if rectangle does not fit
+ */
+int pack_skyline(skyline *sl, int w, int h, v2i *pos);
+
+#endif
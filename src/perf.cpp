@@ -0,0 +1,36 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "perf.hpp"
+
+int64_t query_perf_counter(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * (int64_t) 1000000000 + ts.tv_nsec;
+#endif
+}
+
+int64_t query_perf_freq(void)
+{
+#ifdef _WIN32
+	static int64_t freq;
+
+	if (!freq) {
+		QueryPerformanceFrequency((LARGE_INTEGER *) &freq);
+	}
+	return freq;
+#else
+	return 1000000000;
+#endif
+}
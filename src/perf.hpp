@@ -0,0 +1,20 @@
+#ifndef PERF_HPP
+#define PERF_HPP
+
+#include <stdint.h>
+
+/**
+ * query_perf_counter() - Read performance counter
+ *
+ * Return: Ticks of a monotonic clock
+ */
+int64_t query_perf_counter(void);
+
+/**
+ * query_perf_freq() - Frequency of performance counter
+ *
+ * Return: Ticks per second
+ */
+int64_t query_perf_freq(void);
+
+#endif
@@ -9,20 +9,28 @@
 #include <stb_image_write.h>
 #include <wglext.h>
 
+#include "arena.hpp"
 #include "entity.hpp"
 #include "game-map.hpp"
+#include "minimap.hpp"
+#include "pack.hpp"
 #include "render.hpp"
 
-#define TILE_STRIDE (TILE_LEN * 4) 
-#define TILE_SIZE (TILE_LEN * TILE_LEN)
-#define SIZEOF_TILE (TILE_STRIDE * TILE_LEN)
+#define ATLAS_LEN 512
+#define ATLAS_STRIDE (ATLAS_LEN * 4)
+#define SIZEOF_ATLAS (ATLAS_STRIDE * ATLAS_LEN) 
 
-#define ATLAS_TILE_LEN 16 
-#define ATLAS_TILE_SIZE (ATLAS_TILE_LEN * ATLAS_TILE_LEN)
+/**
+ * Maximum count of atlas pages, each page is a layer
+ * of the atlas texture array 
+ */
+#define MAX_ATLAS_PAGES 8
 
-#define ATLAS_LEN (ATLAS_TILE_LEN * TILE_LEN) 
-#define ATLAS_STRIDE (ATLAS_TILE_LEN * TILE_STRIDE) 
-#define SIZEOF_ATLAS (ATLAS_STRIDE * ATLAS_LEN) 
+/**
+ * Transparent gutter around packed sprites, keeps
+ * neighbouring sprites from bleeding into each other
+ */
+#define ATLAS_PAD 1
 
 #define LAYER_GRID 0
 #define LAYER_ENTITY 1
@@ -32,41 +40,230 @@
 
 #define WGL_LOAD(func) func = (typeof(func)) wgl_load(#func)
 
-#define MAX_SQUARES 1024 
+/**
+ * Initial capacity of render queue and square buffer  
+ */
+#define MIN_SQUARES 1024 
+
+/**
+ * Render paths
+ * @RENDER_GEOM: Geometry shader expands each square from a point
+ * @RENDER_INST: Static unit quad is instanced once per square
+ */
+#define RENDER_GEOM 0
+#define RENDER_INST 1
+#define COUNTOF_RENDER 2
+
+#define BENCH_FRAMES 200
+#define BENCH_SQUARES 1024
+
+/**
+ * Tiles narrower than this many pixels are drawn from the
+ * minimap instead of as sprites
+ */
+#define OVERVIEW_PX 8
+
+/**
+ * Longer side of minimap in pixels, and its gap from the
+ * corner of the view
+ */
+#define MINIMAP_PX 160
+#define MINIMAP_GAP 8
+
+/**
+ * Width in pixels of outline of selection
+ */
+#define SEL_PX 2
+
+/**
+ * Tiles a sprite can reach past its own tile, so redrawing
+ * a tile of the cached layer redraws its neighbours too
+ */
+#define LAYER_REACH 3
+
+/**
+ * Sort key of square, squares are drawn in ascending order 
+ * @KEY_PAGE_MASK: Bits holding atlas page 
+ * @KEY_BLEND: Set if square needs blending  
+ * @KEY_LAYER_SHIFT: Shift of inverted layer, higher layers drawn first
+ */
+#define KEY_PAGE_MASK 0x7F
+#define KEY_BLEND 0x80
+#define KEY_LAYER_SHIFT 8
+
+/**
+ * Shift of sort key above index of square in sort entries
+ */
+#define KEY_SHIFT 32
 
 /**
  * square - Render square 
  * @x: x-pos in camera pixels relative to left
  * @y: y-pos in camera pixels relative to top
- * @layer: layer of square 
- * @id: the id of the square from 0 to 255 
+ * @id: the id of the sprite, indexes the rect buffer 
+ * @layer: layer of square, orders drawing
  * @flip: flip state
  */
 struct square {
 	int16_t x; 
 	int16_t y; 
+	uint16_t id;
 	uint8_t layer;
-	uint8_t id;
 	uint8_t flip;
 };
 
 /**
- * sprite - Set of squares corresponding to a single image
- * @base: Base square id
- * @count: Count of unique positions
- * @pts: Position of each square
+ * sprite - Trimmed image placed in the atlas 
+ * @w: Width of untrimmed image
+ * @h: Height of untrimmed image
+ * @ox: x-pos of trimmed rect within untrimmed image
+ * @oy: y-pos of trimmed rect within untrimmed image
+ * @tw: Width of trimmed rect, zero if nothing is visible
+ * @th: Height of trimmed rect
+ * @opaque: Every pixel of trimmed rect is fully opaque
  */
 struct sprite {
 	int16_t w;
 	int16_t h;
-	uint8_t base;
-	uint8_t count;
-	v2i pts[];
+	int16_t ox;
+	int16_t oy;
+	int16_t tw;
+	int16_t th;
+	bool opaque;
+};
+
+/**
+ * atlas_rect - Location of sprite in atlas, two texels of rect buffer 
+ * @x: left-most pos in page pixels 
+ * @y: top-most pos in page pixels
+ * @w: width in pixels
+ * @h: height in pixels
+ * @page: Page of atlas
+ * @pad: Fills out second texel
+ */
+struct atlas_rect {
+	uint16_t x;
+	uint16_t y;
+	uint16_t w;
+	uint16_t h;
+	uint16_t page;
+	uint16_t pad[3];
 };
 
+/**
+ * square_buf - Render queue of squares 
+ * @mem: Arena queue and its sort scratch are allocated from
+ * @count: Count of squares
+ * @cap: Capacity of squares 
+ * @squares: Squares in order pushed
+ * @sorted: Squares in draw order
+ * @keys: Sort key and index of each square
+ */
 struct square_buf {
+	arena *mem;
+	int count;
+	int cap;
+	square *squares;
+	square *sorted;
+	uint64_t *keys;
+};
+
+/**
+ * Frame snapshot slots, one being built by the simulation thread,
+ * one being drawn by the render thread, and one waiting between
+ * the two 
+ */
+#define COUNTOF_FRAMES 3
+
+/**
+ * Mailbox bits
+ * @FRAME_INDEX: Index of frame in the mailbox
+ * @FRAME_FRESH: Frame in mailbox has not been drawn yet
+ */
+#define FRAME_INDEX 0x3
+#define FRAME_FRESH 0x4
+
+/**
+ * frame - Snapshot of everything needed to draw a frame 
+ * @mem: Arena snapshot is allocated from, reset when rebuilt
+ * @buf: Render queue
+ * @cam: Camera when snapshot was taken
+ * @overview: Tiles are drawn from the minimap
+ * @minimap: Minimap is drawn in the corner
+ * @cached: Backdrop, tiles and grid are copied from the tile layer
+ * @layer: Render queue redrawn into tile layer, NULL if none
+ * @layer_box: Tiles of view redrawn into tile layer, from camera
+ * @map_w: Width of map
+ * @map_h: Height of map
+ * @sel: Selected tiles to outline
+ * @width: Width of viewport
+ * @height: Height of viewport
+ * @stamp: Performance counter when input of frame was sampled
+ *
+ * Once published, the simulation thread does not touch a frame 
+ * until the render thread hands it back through the mailbox.
+ */
+struct frame {
+	arena mem;
+	square_buf *buf;
+	rect cam;
+	bool overview;
+	bool minimap;
+	bool cached;
+	square_buf *layer;
+	tile_box layer_box;
+	int map_w;
+	int map_h;
+	tile_box sel;
+	int width;
+	int height;
+	int64_t stamp;
+};
+
+/**
+ * frame_stats - Input to display latency of drawn frames
+ * @count: Count of frames drawn
+ * @dropped: Count of frames replaced before being drawn
+ * @min: Least latency in performance counts 
+ * @max: Greatest latency in performance counts 
+ * @sum: Sum of latencies in performance counts 
+ */
+struct frame_stats {
 	int count;
-	square squares[MAX_SQUARES];
+	int dropped;
+	int64_t min;
+	int64_t max;
+	int64_t sum;
+};
+
+/**
+ * tile_layer - Backdrop, tiles and grid of editor view as last drawn
+ * @fbo: Framebuffer drawing into tex
+ * @tex: Texture layer is kept in
+ * @tex_w: Width of tex
+ * @tex_h: Height of tex
+ * @cam: Camera layer was drawn with
+ * @width: Width of viewport layer was drawn with
+ * @height: Height of viewport layer was drawn with
+ * @grid: Grid was drawn into layer
+ * @valid: Layer was drawn with the fields above
+ * @dirty: Tiles of map changed since layer was drawn
+ *
+ * The fields from cam are only touched by the simulation
+ * thread, the rest only by the thread drawing. The game does
+ * not use the layer, as clouds go between backdrop and tiles.
+ */
+struct tile_layer {
+	GLuint fbo;
+	GLuint tex;
+	int tex_w;
+	int tex_h;
+	rect cam;
+	int width;
+	int height;
+	bool grid;
+	bool valid;
+	tile_box dirty;
 };
 
 HWND g_wnd;
@@ -74,13 +271,14 @@ HMENU g_menu;
 
 v2 g_scroll;
 bool g_grid_on = true;
+bool g_minimap_on = true;
+tile_box g_sel = {0, 0, -1, -1};
 bool g_running;
 float g_cloud_x;
 
-rect g_cam = {0, 0, VIEW_TW, VIEW_TH}; 
-
-static int g_square_next;
-static sprite *g_sprites[COUNTOF_SPR_ALL];
+static int g_sprite_count;
+static sprite g_sprites[COUNTOF_SPR_ALL];
+static atlas_rect g_rects[COUNTOF_SPR_ALL];
 
 static HDC g_hdc;
 static HGLRC g_glrc;
@@ -89,51 +287,62 @@ static PFNWGLCREATECONTEXTATTRIBSARBPROC wglCreateContextAttribsARB;
 static PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT;
 
 static GLuint g_tex;
+static GLuint g_rect_buf;
+static GLuint g_rect_tex;
 
 static GLuint g_sprite_prog;
+static GLuint g_inst_prog;
 
 static GLuint g_sprite_vao;
+static GLuint g_inst_vao;
 static GLuint g_sprite_vbo;
+static int g_sprite_vbo_cap;
+static GLuint g_quad_vbo;
 
 static GLint g_sprite_view_ul;
-static GLint g_sprite_tex_ul;
+static GLint g_inst_view_ul;
+
+static GLuint g_mm_tex;
+static GLuint g_mm_prog;
+static GLuint g_mm_vao;
+static GLint g_mm_view_ul;
+static GLint g_mm_origin_ul;
+static GLint g_mm_size_ul;
+static GLint g_mm_outline_ul;
 
 /**
- * bound_coord() - Bound coordinate inside camera
- * @v: Camera value to bound
- * @gm: Dimension of game map
- * @cam: Dimension of camera
- *
- * Return: 
- * Return -1 if bounded left
- * Return 1 if bounded right
- * Return 0 if no bound needed
+ * @g_mm: Colour image of map, updated by the simulation thread
+ * @g_mm_lock: Held while texels of minimap are written or uploaded
  */
-static int bound_coord(float *v, float gm, float cam)
-{
-	float dif;
+static minimap g_mm;
+static SRWLOCK g_mm_lock;
 
-	dif = gm - cam;
+static tile_layer g_layer = {.dirty = {0, 0, -1, -1}};
 
-	if (*v < 0.0F || dif < 0.0F) {
-		*v = 0.0F;
-		return -1;
-	} 
+static int g_render_path = RENDER_INST;
 
-	if (*v > dif) {
-		*v = dif; 
-		return 1;
-	} 
-	return 0;
-}
+static int g_view_width;
+static int g_view_height;
 
-bool bound_cam(void) 
-{
-	bool bound;
-	bound = !!bound_coord(&g_cam.x, g_gm->w, g_cam.w); 
-	bound_coord(&g_cam.y, g_gm->h, g_cam.h);
-	return bound;
-}
+/**
+ * @g_dirty: Something in view changed since last render()
+ */
+static bool g_dirty = true;
+
+static frame g_frames[COUNTOF_FRAMES] = {
+	{.mem = {NULL, 64 * 1024, 0, 0, NULL}},
+	{.mem = {NULL, 64 * 1024, 0, 0, NULL}},
+	{.mem = {NULL, 64 * 1024, 0, 0, NULL}}
+};
+
+static int g_frame_back;
+static volatile LONG g_frame_mid = 1;
+static int g_frame_front = 2;
+
+static HANDLE g_render_thread;
+static HANDLE g_frame_event;
+static volatile bool g_render_on;
+static frame_stats g_frame_stats;
 
 /**
  * wgl_load() - load WGL extension function 
@@ -330,7 +539,7 @@ static GLuint compile_shader(GLuint type, const wchar_t *path)
 /**
  * create_prog() - Create OpenGL program
  * @vs_path: Vertex shader
- * @gs_path: Geometry shader
+ * @gs_path: Geometry shader, zero if none
  * @fs_path: Fragment shader
  *
  * Return: The program
@@ -343,7 +552,9 @@ static GLuint create_prog(GLuint vs, GLuint gs, GLuint fs)
 	prog = glCreateProgram();
 
 	glAttachShader(prog, vs);
-	glAttachShader(prog, gs);
+	if (gs) {
+		glAttachShader(prog, gs);
+	}
 	glAttachShader(prog, fs);
 
 	glLinkProgram(prog);
@@ -353,7 +564,9 @@ static GLuint create_prog(GLuint vs, GLuint gs, GLuint fs)
 	}
 
 	glDetachShader(prog, fs);
-	glDetachShader(prog, gs);
+	if (gs) {
+		glDetachShader(prog, gs);
+	}
 	glDetachShader(prog, vs);
 
 	return prog;
@@ -361,140 +574,84 @@ static GLuint create_prog(GLuint vs, GLuint gs, GLuint fs)
 
 
 /**
- * load_square() - Load rectangle
- * @dst: pointer to topleft of destination pixels 
- * @src: pointer to topleft of entire source (not offest by x and y)
- * @x: x-pos of src
- * @y: y-pos of src
- * @w: width of src
- * @h: height of src
- */
-static void load_square(uint8_t *dst, const uint8_t *src, 
-		int x, int y, int w, int h)
-{
-	int nx0, ny0;
-	int xzero, yzero;
-	int dskip, sskip;
-
-	uint8_t *dp;
-	const uint8_t *sp;
-	int ny;
-
-	/*don't grab more than present*/
-	nx0 = min(w - x, TILE_LEN);
-	ny0 = min(h - y, TILE_LEN);
-
-	/*zero out of bounds*/
-	xzero = TILE_STRIDE - nx0 * 4;
-	yzero = TILE_STRIDE - ny0 * 4; 
-
-	/*skip needed to get to next row*/
-	dskip = ATLAS_STRIDE - nx0 * 4; 
-	sskip = (w - nx0) * 4;
-
-	/*copying begins, along with clear out of bounds columns*/
-	dp = dst;
-	sp = src;
-	ny = ny0;
-	while (ny-- > 0) {
-		int nx;
-
-		nx = nx0;
-		while (nx-- > 0) {
-			memcpy(dp, sp, 4);
-			dp += 4;
-			sp += 4;
-		}
-		memset(dp, 0, xzero);
-		dp += dskip;
-		sp += sskip; 
-	}
-
-	/*zero out out of bound rows*/
-	ny = yzero; 
-	while (ny-- > 0) {
-		memset(dp, 0, TILE_STRIDE);
-		dp += ATLAS_STRIDE;
-	}
-}
-
-/**
- * load_sprite() - Load sprite
- * @dst: Destination to write sqaure
- * @src: Source of squares
+ * load_sprite() - Trim sprite to its visible pixels
+ * @spr: Sprite to fill out 
+ * @dst: Pointer to modify with trimmed pixels, NULL if none are visible
+ * @src: Source pixels
  * @w: Width of source
- * @h: Height of soruce
- * @pspr: Pointer to sprite slot
+ * @h: Height of source
  *
  * Return: Zero on succcess, negative on failure
  */
-static int load_sprite(uint8_t **dst, const uint8_t *src, int w, int h, 
-		sprite **pspr)
+static int load_sprite(sprite *spr, uint8_t **dst, const uint8_t *src, 
+		int w, int h)
 {
-	int max;
-	sprite *spr;
+	int x0, y0;
+	int x1, y1;
+	int tw, th;
 
 	const uint8_t *sp;
+	uint8_t *dp;
 	int y;
 
-	/*sprite preparation*/
-	max = div_up(w, TILE_LEN) * div_up(h, TILE_LEN);
-	spr = (sprite *) malloc(sizeof(*spr) + max * sizeof(*spr->pts));
-	if (!spr) {
-		return -1;
+	/*find bounds of pixels that are not fully transparent*/
+	x0 = w;
+	y0 = h;
+	x1 = 0;
+	y1 = 0;
+	sp = src + 3;
+	for (y = 0; y < h; y++) {
+		int x;
+
+		for (x = 0; x < w; x++) {
+			if (*sp) {
+				x0 = min(x0, x);
+				y0 = min(y0, y);
+				x1 = max(x1, x + 1);
+				y1 = max(y1, y + 1);
+			}
+			sp += 4;
+		}
 	}
+
 	spr->w = w;
 	spr->h = h;
-	spr->base = g_square_next;
-	spr->count = 0;
-	*pspr = spr;
+	*dst = NULL;
+	if (x0 >= x1) {
+		spr->ox = 0;
+		spr->oy = 0;
+		spr->tw = 0;
+		spr->th = 0;
+		return 0;
+	}
+
+	tw = x1 - x0;
+	th = y1 - y0;
+	spr->ox = x0;
+	spr->oy = y0;
+	spr->tw = tw;
+	spr->th = th;
+	spr->opaque = true;
+
+	/*copy out trimmed rect*/
+	dp = (uint8_t *) malloc(tw * th * 4);
+	if (!dp) {
+		return -1;
+	}
+	*dst = dp;
 
-	/*find the active squares*/
-	sp = src;
-	for (y = 0; y < h; y += TILE_LEN) {
+	sp = src + (y0 * w + x0) * 4;
+	for (y = 0; y < th; y++) {
 		int x;
-		const uint8_t *c;
 
-		/*search for opaque column*/
-		c = sp;
-		for (x = 0; x < w; x++) {
-			const uint8_t *r;
-			int ny;
-
-			r = c;
-			ny = min(h - y, TILE_LEN);
-			while (ny-- > 0) {
-				/*check to see if pixel is opaque*/
-				if (r[3] == 0xFF) {
-					v2i *pos;
-
-					load_square(*dst, c, x, y, w, h);
-
-					pos = spr->pts + spr->count++; 
-					pos->x = x;
-					pos->y = y;
-
-					x += TILE_LEN - 1;
-					c += TILE_STRIDE - 4; 
-					g_square_next++;
-					if (g_square_next % 16 == 0) {
-						*dst += ATLAS_STRIDE * 
-								(TILE_LEN - 1);
-					}
-					*dst += TILE_STRIDE;
-					break;
-				}
-				r += w * 4;
+		memcpy(dp, sp, tw * 4);
+		for (x = 0; x < tw; x++) {
+			if (dp[x * 4 + 3] != 0xFF) {
+				spr->opaque = false;
 			}
-			c += 4;
 		}
-		sp += 4 * TILE_LEN * w;
-	}
-	/*shrink to fit*/
-	spr = (sprite *) realloc(spr, sizeof(*spr) + 
-			spr->count * sizeof(*spr->pts));
-	if (spr) {
-		*pspr = spr;
+		dp += tw * 4;
+		sp += w * 4;
 	}
 
 	return 0;
@@ -577,14 +734,14 @@ err:
 }
 
 /**
- * read_sprite(): Reads sprite into atlas 
+ * read_sprite(): Reads and trims sprite 
  * @path: Path to sprite relative to res/sprites
- * @dp: Pointer to modify for next image in atlas 
- * @spr: Pointer to modify
+ * @id: ID of sprite to read into 
+ * @pixels: Trimmed pixels of each sprite 
  *
  * Return: Return 0 on success, -1 on failure
  */
-static int read_sprite(const char *path, uint8_t **dp, sprite **spr)
+static int read_sprite(const char *path, int id, uint8_t **pixels)
 {
 	char full_path[MAX_PATH];
 	uint8_t *src;
@@ -599,7 +756,8 @@ static int read_sprite(const char *path, uint8_t **dp, sprite **spr)
 		return -1;
 	}
 
-	if (load_sprite(dp, src, width, height, spr) < 0) {
+	if (load_sprite(g_sprites + id, pixels + id, 
+			src, width, height) < 0) {
 		fprintf(stderr, "could not load sprite %s\n", path);
 		err = -1;
 	} else {
@@ -611,49 +769,193 @@ static int read_sprite(const char *path, uint8_t **dp, sprite **spr)
 }
 
 /**
- * load_atlas() - Load sprites into atlas.
+ * height_cmp() - Quick sort comparator, orders sprite IDs tallest first
+ * @lhs: Pointer to sprite ID, should be of type const int * 
+ * @rhs: Pointer to sprite ID, should be of type const int * 
  *
- * Combines a bunch of individual sprites listed
- * in g_sprite_paths into a single atlas,
- * start from the top left and going right
- * than down. 
+ * Returns: Negative if lhs is taller, positive if rhs is taller
  */
-static void load_atlas(void)
+static int height_cmp(const void *lhs, const void *rhs)
 {
-	const char *const *path;
-	size_t n;
+	const sprite *lspr;
+	const sprite *rspr;
 
-	uint8_t *dst;
-	uint8_t *dp;
+	lspr = g_sprites + *(const int *) lhs;
+	rspr = g_sprites + *(const int *) rhs;
+	if (lspr->th != rspr->th) {
+		return rspr->th - lspr->th;
+	}
+	return rspr->tw - lspr->tw;
+}
 
-	sprite **spr;
-	anim *anim;
+/**
+ * pack_atlas() - Pack trimmed sprites into pages
+ * @pages: Skyline of each page 
+ *
+ * Sprites are packed tallest first, which keeps the skyline flat.
+ * A new page is opened only when no open page has room. 
+ * Sprites that cannot be packed are trimmed to nothing. 
+ *
+ * Return: Count of pages used
+ */
+static int pack_atlas(skyline *pages)
+{
+	int order[COUNTOF_SPR_ALL];
+	int count;
+	int i;
+
+	for (i = 0; i < g_sprite_count; i++) {
+		order[i] = i;
+	}
+	qsort(order, g_sprite_count, sizeof(*order), height_cmp);
+
+	count = 0;
+	for (i = 0; i < g_sprite_count; i++) {
+		int id;
+		sprite *spr;
+		atlas_rect *r;
+		v2i pos;
+		int w, h;
+		int page;
+
+		id = order[i];
+		spr = g_sprites + id;
+		if (!spr->tw) {
+			continue;
+		}
+
+		w = spr->tw + ATLAS_PAD;
+		h = spr->th + ATLAS_PAD;
+		for (page = 0; page < count; page++) {
+			if (pack_skyline(pages + page, w, h, &pos) == 0) {
+				break;
+			}
+		}
+
+		if (page == count) {
+			if (count == MAX_ATLAS_PAGES) {
+				fprintf(stderr, "atlas: Out of pages\n");
+				spr->tw = 0;
+				continue;
+			}
+			init_skyline(pages + page, ATLAS_LEN, ATLAS_LEN);
+			if (pack_skyline(pages + page, w, h, &pos) < 0) {
+				fprintf(stderr, "atlas: Sprite %d too big\n", id);
+				spr->tw = 0;
+				continue;
+			}
+			count++;
+		}
+
+		r = g_rects + id;
+		r->x = pos.x;
+		r->y = pos.y;
+		r->w = spr->tw;
+		r->h = spr->th;
+		r->page = page;
+	}
+
+	return count;
+}
 
+/**
+ * draw_atlas() - Copy trimmed sprites into their packed rects 
+ * @dst: Pixels of all pages, each page being SIZEOF_ATLAS 
+ * @pixels: Trimmed pixels of each sprite
+ */
+static void draw_atlas(uint8_t *dst, uint8_t *const *pixels)
+{
 	int i;
 
-	dst = (uint8_t *) malloc(SIZEOF_ATLAS);
-	if (!dst) {
-		return;
+	for (i = 0; i < g_sprite_count; i++) {
+		const sprite *spr;
+		const atlas_rect *r;
+		const uint8_t *sp;
+		uint8_t *dp;
+		int n;
+
+		spr = g_sprites + i;
+		if (!spr->tw) {
+			continue;
+		}
+
+		r = g_rects + i;
+		sp = pixels[i];
+		dp = dst + r->page * SIZEOF_ATLAS + 
+				r->y * ATLAS_STRIDE + r->x * 4;
+		n = r->h;
+		while (n-- > 0) {
+			memcpy(dp, sp, r->w * 4);
+			dp += ATLAS_STRIDE;
+			sp += r->w * 4;
+		}
 	}
-	
-	dp = dst;
-	spr = g_sprites;
+}
+
+/**
+ * report_atlas() - Print packing efficiency
+ * @pages: Skyline of each page
+ * @count: Count of pages
+ */
+static void report_atlas(const skyline *pages, int count)
+{
+	long src_px;
+	long trim_px;
+	long packed_px;
+	long page_px;
+	int i;
+
+	src_px = 0;
+	trim_px = 0;
+	for (i = 0; i < g_sprite_count; i++) {
+		const sprite *spr;
+
+		spr = g_sprites + i;
+		src_px += spr->w * spr->h;
+		trim_px += spr->tw * spr->th;
+	}
+
+	packed_px = 0;
+	for (i = 0; i < count; i++) {
+		packed_px += pages[i].used;
+	}
+	page_px = (long) count * ATLAS_LEN * ATLAS_LEN;
+
+	fprintf(stderr, "atlas: %d sprites in %d page(s), "
+			"%ld of %ld source pixels kept, "
+			"%.1f%% of pages used (%.1f%% with padding)\n", 
+			g_sprite_count, count, trim_px, src_px, 
+			page_px ? 100.0 * trim_px / page_px : 0.0,
+			page_px ? 100.0 * packed_px / page_px : 0.0);
+}
+
+/**
+ * read_atlas_sprites() - Read and trim all sprites
+ * @pixels: Trimmed pixels of each sprite
+ *
+ * Predefined sprites come first, followed by the frames
+ * of each animation in order.
+ */
+static void read_atlas_sprites(uint8_t **pixels)
+{
+	const char *const *path;
+	anim *anim;
+	int i;
 
 	path = g_sprite_paths; 
-	n = COUNTOF_SPR; 
-	while (n-- > 0) { 
-		if (read_sprite(*path, &dp, spr)) {
+	for (i = 0; i < COUNTOF_SPR; i++) {
+		if (read_sprite(*path, i, pixels)) {
 			abort();
 		}
 		path++;
-		spr++;
 	}
+	g_sprite_count = COUNTOF_SPR;
 
 	path = g_anim_paths;
 	anim = g_anims;
 	for (i = 0; i < COUNTOF_ANIM; i++) {
 		char full_path[MAX_PATH];
-		char *names[16];
+		char *names[MAX_ANIM_FRAMES];
 		int count;
 		int base;
 		int remain;
@@ -661,25 +963,28 @@ static void load_atlas(void)
 		int tile;
 
 		sprintf(full_path, "res/sprites/%s", *path);
-		count = get_names(full_path, names, 16);
+		count = get_names(full_path, names, MAX_ANIM_FRAMES);
 		if (count < 0) {
 			continue;
 		}
 
-		base = spr - g_sprites;
+		base = g_sprite_count;
 		remain = COUNTOF_SPR_ALL - base;
 		if (count > remain) {
 			fprintf(stderr, "Too many sprites\n");
+			free_names(names + remain, count - remain);
+			count = remain;
 		}
 
 		name = names;
 		while (count-- > 0) {
 			sprintf(full_path, "%s/%s", *path, *name);
-			if (read_sprite(full_path, &dp, spr)) {
+			if (read_sprite(full_path, g_sprite_count, pixels)) {
 				abort();
 			}
+			free(*name);
 			name++;
-			spr++;
+			g_sprite_count++;
 		}
 
 		tile = g_anim_to_tile[i];
@@ -688,18 +993,149 @@ static void load_atlas(void)
 		}
 
 		anim->start = base;
-		base = spr - g_sprites;
-		anim->end = base - 1;
+		anim->end = g_sprite_count - 1;
 
 		path++;
 		anim++;
 	}
+}
+
+/**
+ * sum_sprite() - Sum color of sprite weighted by alpha
+ * @id: ID of sprite
+ * @pixels: Trimmed pixels of each sprite
+ * @sum: Sums of red, green, blue, and alpha
+ *
+ * Return: Count of pixels in untrimmed sprite
+ */
+static int sum_sprite(int id, uint8_t *const *pixels, int64_t *sum)
+{
+	const sprite *spr;
+	const uint8_t *p;
+	int n;
+
+	spr = g_sprites + id;
+	memset(sum, 0, 4 * sizeof(*sum));
+	p = pixels[id];
+	n = spr->tw * spr->th;
+	while (n-- > 0) {
+		sum[0] += p[0] * p[3];
+		sum[1] += p[1] * p[3];
+		sum[2] += p[2] * p[3];
+		sum[3] += p[3];
+		p += 4;
+	}
+	return max(spr->w * spr->h, 1);
+}
+
+/**
+ * get_tile_colors() - Average tile sprites into minimap colors
+ * @colors: RGBA of each tile
+ * @pixels: Trimmed pixels of each sprite
+ *
+ * Blank and partly transparent tiles are blended over the
+ * average color of the sky.
+ */
+static void get_tile_colors(uint32_t *colors, uint8_t *const *pixels)
+{
+	int64_t sum[4];
+	float sky[3];
+	int n;
+	int t;
+	int c;
+
+	n = sum_sprite(SPR_SKY, pixels, sum);
+	for (c = 0; c < 3; c++) {
+		sky[c] = (float) sum[c] / (255.0F * n);
+	}
+
+	for (t = 0; t < COUNTOF_TILES; t++) {
+		uint32_t color;
+		float a;
+		int id;
+
+		id = g_tile_to_spr[t];
+		if (id == SPR_INVALID || id >= g_sprite_count) {
+			memset(sum, 0, sizeof(sum));
+			n = 1;
+		} else {
+			n = sum_sprite(id, pixels, sum);
+		}
+
+		a = (float) sum[3] / (255.0F * n);
+		color = 0xFF000000;
+		for (c = 0; c < 3; c++) {
+			float v;
+
+			v = (float) sum[c] / (255.0F * n) + sky[c] * (1.0F - a);
+			color |= (uint32_t) fminf(v, 255.0F) << (c * 8);
+		}
+		colors[t] = color;
+	}
+}
+
+/**
+ * upload_rects() - Upload atlas rects to rect buffer 
+ */
+static void upload_rects(void)
+{
+	glGenBuffers(1, &g_rect_buf);
+	glBindBuffer(GL_TEXTURE_BUFFER, g_rect_buf);
+	glBufferData(GL_TEXTURE_BUFFER, g_sprite_count * sizeof(*g_rects), 
+			g_rects, GL_STATIC_DRAW);
+
+	glGenTextures(1, &g_rect_tex);
+	glBindTexture(GL_TEXTURE_BUFFER, g_rect_tex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA16UI, g_rect_buf);
+}
+
+/**
+ * load_atlas() - Load sprites into atlas.
+ *
+ * Trims each sprite listed in g_sprite_paths and each 
+ * frame of g_anim_paths down to its visible pixels,
+ * then packs them into as few pages as possible. 
+ */
+static void load_atlas(void)
+{
+	uint8_t **pixels;
+	skyline *pages;
+	int count;
+	uint8_t *dst;
+	int i;
+
+	pixels = (uint8_t **) xcalloc(COUNTOF_SPR_ALL, sizeof(*pixels));
+	pages = (skyline *) xmalloc(MAX_ATLAS_PAGES * sizeof(*pages));
+
+	read_atlas_sprites(pixels);
+	get_tile_colors(g_mm.colors, pixels);
+	count = pack_atlas(pages);
+	report_atlas(pages, count);
+
+	dst = (uint8_t *) xcalloc(max(count, 1), SIZEOF_ATLAS);
+	draw_atlas(dst, pixels);
+
+	for (i = 0; i < count; i++) {
+		char path[MAX_PATH];
+
+		if (i == 0) {
+			strcpy(path, "res/tex/tex.png");
+		} else {
+			sprintf(path, "res/tex/tex-%d.png", i);
+		}
+		stbi_write_png(path, ATLAS_LEN, ATLAS_LEN, 4, 
+				dst + i * SIZEOF_ATLAS, ATLAS_STRIDE);
+	}
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, ATLAS_LEN, ATLAS_LEN, 
+			max(count, 1), 0, GL_RGBA, GL_UNSIGNED_BYTE, dst); 
+	upload_rects();
 
-	stbi_write_png("res/tex/tex.png", ATLAS_LEN, 
-			ATLAS_LEN, 4, dst, ATLAS_STRIDE);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_LEN, 
-			ATLAS_LEN, 0, GL_RGBA, GL_UNSIGNED_BYTE, dst); 
 	free(dst);
+	free(pages);
+	for (i = 0; i < g_sprite_count; i++) {
+		free(pixels[i]);
+	}
+	free(pixels);
 }
 
 /**
@@ -708,14 +1144,17 @@ static void load_atlas(void)
 static void create_atlas(void)
 {
 	glGenTextures(1, &g_tex);
-	glBindTexture(GL_TEXTURE_2D, g_tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, g_tex);
 
-  	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, 
+			GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, 
+			GL_CLAMP_TO_EDGE);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+			GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, 
 			GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
 	load_atlas();
 }
@@ -727,12 +1166,52 @@ static void sprite_vaa_set_up(void)
 {
 	glVertexAttribIPointer(0, 2, GL_SHORT, 
 			sizeof(square), (void *) 0);
-	glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, 
+	glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, 
 			sizeof(square), (void *) 4);
 	glVertexAttribIPointer(2, 1, GL_UNSIGNED_BYTE, 
-			sizeof(square), (void *) 5);
+			sizeof(square), (void *) 7);
+
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+}
+
+/**
+ * inst_vaa_point() - Point per square attributes of instanced program
+ * @first: First square to draw
+ *
+ * Core OpenGL 3.3 has no base instance, so the attributes
+ * are offset instead.
+ */
+static void inst_vaa_point(int first)
+{
+	uintptr_t base;
+
+	base = first * sizeof(square);
+	glBindBuffer(GL_ARRAY_BUFFER, g_sprite_vbo);
+	glVertexAttribIPointer(1, 2, GL_SHORT, 
+			sizeof(square), (void *) base);
+	glVertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, 
+			sizeof(square), (void *) (base + 4));
 	glVertexAttribIPointer(3, 1, GL_UNSIGNED_BYTE, 
-			sizeof(square), (void *) 6);
+			sizeof(square), (void *) (base + 7));
+}
+
+/**
+ * inst_vaa_set_up() - Set up vertex attributes for instanced program
+ *
+ * Corners come from the unit quad, the rest are per square. 
+ */
+static void inst_vaa_set_up(void)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, g_quad_vbo);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 
+			2 * sizeof(float), (void *) 0);
+	inst_vaa_point(0);
+
+	glVertexAttribDivisor(1, 1);
+	glVertexAttribDivisor(2, 1);
+	glVertexAttribDivisor(3, 1);
 
 	glEnableVertexAttribArray(0);
 	glEnableVertexAttribArray(1);
@@ -740,6 +1219,20 @@ static void sprite_vaa_set_up(void)
 	glEnableVertexAttribArray(3);
 }
 
+/**
+ * get_sprite_uniforms() - Bind samplers of a sprite program
+ * @prog: Sprite program
+ *
+ * Return: Location of view uniform
+ */
+static GLint get_sprite_uniforms(GLuint prog)
+{
+	glUseProgram(prog);
+	glUniform1i(glGetUniformLocation(prog, "tex"), 0);
+	glUniform1i(glGetUniformLocation(prog, "rects"), 1);
+	return glGetUniformLocation(prog, "view");
+}
+
 /**
  * create_sprite_prog() - Create sprite program
  *
@@ -767,32 +1260,134 @@ static void create_sprite_prog(void)
 	glBindBuffer(GL_ARRAY_BUFFER, g_sprite_vbo);
 	sprite_vaa_set_up();
 
-	glBufferData(GL_ARRAY_BUFFER, MAX_SQUARES * sizeof(square), 
+	glBufferData(GL_ARRAY_BUFFER, MIN_SQUARES * sizeof(square), 
 			NULL, GL_DYNAMIC_DRAW);
+	g_sprite_vbo_cap = MIN_SQUARES;
 
-	glUseProgram(g_sprite_prog);
-	g_sprite_view_ul = glGetUniformLocation(g_sprite_prog, "view");
-	g_sprite_tex_ul = glGetUniformLocation(g_sprite_prog, "tex");
-	glUniform1i(g_sprite_tex_ul, 0);
+	g_sprite_view_ul = get_sprite_uniforms(g_sprite_prog);
 }
 
 /**
- * init_gl_progs() - Create OpenGL programs
+ * create_inst_prog() - Create instanced sprite program
+ *
+ * Must be created after the sprite program, as 
+ * the square buffer is shared.
  */
-static void init_gl_progs(void)
+static void create_inst_prog(void)
 {
-	create_atlas();
-	create_sprite_prog();
-}
+	static const float quad[] = {
+		0.0F, 0.0F,
+		1.0F, 0.0F,
+		0.0F, 1.0F,
+		1.0F, 1.0F
+	};
 
-void init_gl(void)
-{
-	static const int attrib_list[] = {
-		WGL_CONTEXT_MAJOR_VERSION_ARB, 
-		3,
-		WGL_CONTEXT_MINOR_VERSION_ARB, 
-		3,
-		WGL_CONTEXT_FLAGS_ARB, 
+	GLuint vs;
+	GLuint fs;
+
+	vs = compile_shader(GL_VERTEX_SHADER, L"sprite-inst.vert");
+	fs = compile_shader(GL_FRAGMENT_SHADER, L"sprite.frag");
+
+	g_inst_prog = create_prog(vs, 0, fs); 
+	glDeleteShader(fs);
+	glDeleteShader(vs);
+
+	glGenBuffers(1, &g_quad_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, g_quad_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+	glGenVertexArrays(1, &g_inst_vao);
+	glBindVertexArray(g_inst_vao);
+	inst_vaa_set_up();
+
+	g_inst_view_ul = get_sprite_uniforms(g_inst_prog);
+}
+
+/**
+ * create_minimap_prog() - Create minimap program and texture
+ *
+ * Must be created after the instanced program, as
+ * the unit quad is shared.
+ */
+static void create_minimap_prog(void)
+{
+	GLuint vs;
+	GLuint fs;
+	int i;
+
+	vs = compile_shader(GL_VERTEX_SHADER, L"minimap.vert");
+	fs = compile_shader(GL_FRAGMENT_SHADER, L"minimap.frag");
+
+	g_mm_prog = create_prog(vs, 0, fs);
+	glDeleteShader(fs);
+	glDeleteShader(vs);
+
+	glGenVertexArrays(1, &g_mm_vao);
+	glBindVertexArray(g_mm_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, g_quad_vbo);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE,
+			2 * sizeof(float), (void *) 0);
+	glEnableVertexAttribArray(0);
+
+	glUseProgram(g_mm_prog);
+	glUniform1i(glGetUniformLocation(g_mm_prog, "map"), 2);
+	g_mm_view_ul = glGetUniformLocation(g_mm_prog, "view");
+	g_mm_origin_ul = glGetUniformLocation(g_mm_prog, "origin");
+	g_mm_size_ul = glGetUniformLocation(g_mm_prog, "size");
+	g_mm_outline_ul = glGetUniformLocation(g_mm_prog, "outline");
+
+	/*tiles stay sharp when magnified*/
+	glGenTextures(1, &g_mm_tex);
+	glBindTexture(GL_TEXTURE_2D, g_mm_tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+			GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	for (i = 0; i < MINIMAP_LEVELS; i++) {
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8,
+				MINIMAP_LEN >> i, MINIMAP_LEN >> i, 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, g_mm.texels[i]);
+	}
+	InitializeSRWLock(&g_mm_lock);
+}
+
+/**
+ * create_layer() - Create framebuffer and texture of tile layer
+ *
+ * Texture is sized by the first frame drawn from it.
+ */
+static void create_layer(void)
+{
+	glGenTextures(1, &g_layer.tex);
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D, g_layer.tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenFramebuffers(1, &g_layer.fbo);
+}
+
+/**
+ * init_gl_progs() - Create OpenGL programs
+ */
+static void init_gl_progs(void)
+{
+	init_minimap(&g_mm);
+	create_atlas();
+	create_sprite_prog();
+	create_inst_prog();
+	create_minimap_prog();
+	create_layer();
+}
+
+void init_gl(void)
+{
+	static const int attrib_list[] = {
+		WGL_CONTEXT_MAJOR_VERSION_ARB, 
+		3,
+		WGL_CONTEXT_MINOR_VERSION_ARB, 
+		3,
+		WGL_CONTEXT_FLAGS_ARB, 
 		0,
 		WGL_CONTEXT_PROFILE_MASK_ARB, 
 		WGL_CONTEXT_CORE_PROFILE_BIT_ARB, 
@@ -812,7 +1407,7 @@ void init_gl(void)
 		PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL;
 	pfd.iPixelType = PFD_TYPE_RGBA;
 	pfd.cColorBits = 32;
-	pfd.cDepthBits = 24;
+	pfd.cDepthBits = 0;
 	pfd.cStencilBits = 8;
 
 	fmt = ChoosePixelFormat(g_hdc, &pfd);
@@ -832,23 +1427,162 @@ void init_gl(void)
 
 	gladLoadGL();
 
-	glEnable(GL_DEPTH_TEST);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	init_gl_progs();
 }
 
+/**
+ * radix_pass() - Stable counting sort of keys by one byte 
+ * @dst: Sorted keys
+ * @src: Keys to sort
+ * @n: Count of keys
+ * @shift: Shift of byte to sort by 
+ */
+static void radix_pass(uint64_t *dst, const uint64_t *src, 
+		int n, int shift)
+{
+	int offs[256];
+	int sum;
+	int i;
+
+	memset(offs, 0, sizeof(offs));
+	for (i = 0; i < n; i++) {
+		offs[(src[i] >> shift) & 0xFF]++;
+	}
+
+	sum = 0;
+	for (i = 0; i < 256; i++) {
+		int count;
+
+		count = offs[i];
+		offs[i] = sum;
+		sum += count;
+	}
+
+	for (i = 0; i < n; i++) {
+		dst[offs[(src[i] >> shift) & 0xFF]++] = src[i];
+	}
+}
+
+/**
+ * get_key() - Get sort key of square 
+ * @s: Square
+ *
+ * Return: Key with layer in high byte, blend and page in low byte 
+ */
+static uint32_t get_key(const square *s)
+{
+	uint32_t key;
+
+	key = (uint32_t) (255 - s->layer) << KEY_LAYER_SHIFT;
+	key |= g_rects[s->id].page & KEY_PAGE_MASK;
+	if (!g_sprites[s->id].opaque) {
+		key |= KEY_BLEND;
+	}
+	return key;
+}
+
+/**
+ * sort_squares() - Radix sort squares into draw order
+ * @buf: Render queue 
+ *
+ * Layers are drawn back to front, and within a layer opaque
+ * squares are drawn first, grouped by atlas page. Squares with
+ * equal keys keep the order they were pushed in.
+ *
+ * Afterwards each entry of keys holds the sort key in the upper 
+ * 32 bits and the index into squares in the lower 32 bits.
+ */
+static void sort_squares(square_buf *buf)
+{
+	uint64_t *tmp;
+	int i;
+
+	buf->sorted = (square *) arena_alloc(buf->mem, 
+			buf->count * sizeof(*buf->sorted));
+	buf->keys = (uint64_t *) arena_alloc(buf->mem, 
+			buf->count * sizeof(*buf->keys));
+	tmp = (uint64_t *) arena_alloc(buf->mem, 
+			buf->count * sizeof(*tmp));
+
+	for (i = 0; i < buf->count; i++) {
+		buf->keys[i] = (uint64_t) get_key(buf->squares + i) <<
+				KEY_SHIFT | i;
+	}
+
+	radix_pass(tmp, buf->keys, buf->count, KEY_SHIFT);
+	radix_pass(buf->keys, tmp, buf->count, KEY_SHIFT + 8);
+
+	for (i = 0; i < buf->count; i++) {
+		buf->sorted[i] = buf->squares[(uint32_t) buf->keys[i]];
+	}
+}
+
+/**
+ * draw_squares() - Draw run of squares already on GPU 
+ * @first: First square to draw
+ * @count: Count of squares to draw
+ * @blend: Enable blending for run 
+ */
+static void draw_squares(int first, int count, bool blend)
+{
+	if (blend) {
+		glEnable(GL_BLEND);
+	} else {
+		glDisable(GL_BLEND);
+	}
+
+	switch (g_render_path) {
+	case RENDER_GEOM:
+		glBindVertexArray(g_sprite_vao);
+		glDrawArrays(GL_POINTS, first, count);
+		break;
+	case RENDER_INST:
+		glBindVertexArray(g_inst_vao);
+		inst_vaa_point(first);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+		break;
+	}
+}
+
 /**
  * render_sprites() - Submit all sprites to GPU
  * @square_buf: Buffer of sprites
+ *
+ * Squares are sorted and then drawn in runs that share 
+ * the same blend state.
  */
 static void render_sprites(square_buf *buf)
 {
-	glBindVertexArray(g_sprite_vao);
+	int first;
+	int i;
+
+	if (!buf->count) {
+		return;
+	}
+	sort_squares(buf);
+
 	glBindBuffer(GL_ARRAY_BUFFER, g_sprite_vbo);
-	sprite_vaa_set_up();
+	if (buf->count > g_sprite_vbo_cap) {
+		g_sprite_vbo_cap = buf->count * 2;
+		glBufferData(GL_ARRAY_BUFFER, g_sprite_vbo_cap * sizeof(square), 
+				NULL, GL_DYNAMIC_DRAW);
+	}
 	glBufferSubData(GL_ARRAY_BUFFER, 0, buf->count * sizeof(square), 
-			buf->squares);
-	glDrawArrays(GL_POINTS, 0, buf->count);
+			buf->sorted);
+
+	first = 0;
+	for (i = 1; i <= buf->count; i++) {
+		uint64_t blend;
+
+		blend = buf->keys[first] & ((uint64_t) KEY_BLEND << KEY_SHIFT);
+		if (i == buf->count || (buf->keys[i] &
+				((uint64_t) KEY_BLEND << KEY_SHIFT)) != blend) {
+			draw_squares(first, i - first, blend);
+			first = i;
+		}
+	}
 }
 
 /**
@@ -863,60 +1597,57 @@ static void render_sprites(square_buf *buf)
 static void push_sprite(square_buf *buf, float x, float y, 
 		int layer, int id, int flip)
 {
-	int px0, py0;
-	sprite *spr;
-	v2i *pt;
-	int i;
+	const sprite *spr;
+	int px, py;
+	bool xbound;
+	bool ybound;
 
-	px0 = x * TILE_LEN;
-	py0 = y * TILE_LEN;
-
-	spr = g_sprites[id];
-	if (!spr) {
+	if (id >= g_sprite_count) {
 		return;
 	}
 
-	pt = spr->pts;
+	spr = g_sprites + id;
+	if (!spr->tw) {
+		return;
+	}
 
-	for (i = 0; i < spr->count; i++) {
-		int px;
-		int py;
-		bool xbound;
-		bool ybound;
+	px = x * TILE_LEN;
+	py = y * TILE_LEN + spr->oy;
+	if (flip) {
+		px += spr->w - spr->ox - spr->tw;
+	} else {
+		px += spr->ox;
+	}
 
-		px = px0 + pt->x;
-		py = py0 + pt->y; 
-	
-		if (flip) {
-			px = spr->w - pt->x - TILE_LEN + px0;
+	xbound = px > -spr->tw && px < g_cam.w * TILE_LEN;
+	ybound = py > -spr->th && py < g_cam.h * TILE_LEN;
+	if (xbound && ybound) {
+		square *s;
+
+		if (buf->count == buf->cap) {
+			buf->squares = (square *) arena_grow(buf->mem, 
+					buf->squares, 
+					buf->cap * sizeof(*buf->squares),
+					2 * buf->cap * sizeof(*buf->squares));
+			buf->cap *= 2;
 		}
 
-		xbound = px > -TILE_LEN && px < g_cam.w * TILE_LEN + TILE_LEN;
-		ybound = py > -TILE_LEN && py < g_cam.h * TILE_LEN + TILE_LEN;
-		if (xbound && ybound) {
-			square *s;
-
-			s = buf->squares + buf->count;
-			s->x = px;
-			s->y = py;
-			s->layer = layer;
-			s->id = spr->base + i;
-			s->flip = flip;
-			buf->count++;
-			if (buf->count == MAX_SQUARES) {
-				render_sprites(buf);
-				buf->count = 0;
-			}
-		}
-		pt++;
+		s = buf->squares + buf->count;
+		s->x = px;
+		s->y = py;
+		s->id = id;
+		s->layer = layer;
+		s->flip = flip;
+		buf->count++;
 	}
 }
 
 /**
  * render_tiles() - Render tiles and possibly grid
  * @buf: Sprite buffer to add to
+ * @box: Tiles of view to render, from camera
  */
-static void render_tiles(square_buf *buf)
+static void render_tiles(square_buf *buf, const tile_box *box)
 {
 	int max_x;
 	int max_y;
@@ -924,11 +1655,13 @@ static void render_tiles(square_buf *buf)
 
 	max_x = fminf(g_cam.w + 1, g_gm->w);
 	max_y = fminf(g_cam.h + 1, g_gm->h);
+	max_x = min(max_x, box->r + 1);
+	max_y = min(max_y, box->b + 1);
 
-	for (ty = 0; ty < max_y; ty++) {
+	for (ty = max(box->t, 0); ty < max_y; ty++) {
 		int tx;
-		for (tx = 0; tx < max_x; tx++) {
-			static const uint8_t cols[] = {
+		for (tx = max(box->l, 0); tx < max_x; tx++) {
+			static const uint16_t cols[] = {
 				SPR_SKY,
 				SPR_SKY,
 				SPR_SKY,
@@ -984,41 +1717,226 @@ static void render_entities(square_buf *buf)
 }
 
 /**
- * start_sprites() - Creates empty sprite buffer
+ * upload_minimap() - Upload texels of minimap changed since last upload
  */
-static square_buf *start_sprites(void)
+static void upload_minimap(void)
 {
-	square_buf *buf;
-	buf = (square_buf *) malloc(sizeof(*buf));
-	if (buf) {
-		buf->count = 0;
+	int i;
+	int n;
+
+	AcquireSRWLockExclusive(&g_mm_lock);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, g_mm_tex);
+	for (n = 0; n < g_mm.upload_count; n++) {
+		tile_box box;
+
+		box = g_mm.upload[n];
+		for (i = 0; i < MINIMAP_LEVELS; i++) {
+			int len;
+
+			len = MINIMAP_LEN >> i;
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, len);
+			glTexSubImage2D(GL_TEXTURE_2D, i, box.l, box.t,
+					box.r - box.l + 1, box.b - box.t + 1,
+					GL_RGBA, GL_UNSIGNED_BYTE,
+					g_mm.texels[i] + box.t * len + box.l);
+			box.l /= 2;
+			box.t /= 2;
+			box.r /= 2;
+			box.b /= 2;
+		}
 	}
-	return buf;
+	g_mm.upload_count = 0;
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	ReleaseSRWLockExclusive(&g_mm_lock);
 }
 
 /**
- * end_sprites() - Renders all sprites and destroys buffer
+ * draw_map() - Draw whole map from minimap texture
+ * @f: Frame being drawn
+ * @scale: Size of tile in pixels
+ * @pos: Top left of map in pixels
+ * @outline: Outline camera of frame
  */
-static void end_sprites(square_buf *buf) 
+static void draw_map(const frame *f, v2 scale, v2 pos, bool outline)
 {
-	render_sprites(buf);
-	free(buf);
+	glDisable(GL_BLEND);
+	glUseProgram(g_mm_prog);
+	glUniform2f(g_mm_view_ul, f->width / scale.x, f->height / scale.y);
+	glUniform2f(g_mm_origin_ul, pos.x / scale.x, pos.y / scale.y);
+	glUniform2f(g_mm_size_ul, f->map_w, f->map_h);
+	if (outline) {
+		glUniform4f(g_mm_outline_ul, f->cam.x, f->cam.y,
+				f->cam.w, f->cam.h);
+	} else {
+		glUniform4f(g_mm_outline_ul, 0.0F, 0.0F, 0.0F, 0.0F);
+	}
+	glBindVertexArray(g_mm_vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+/**
+ * draw_overview() - Draw map in place of tiles when zoomed far out
+ * @f: Frame being drawn
+ */
+static void draw_overview(const frame *f)
+{
+	v2 scale;
+	v2 pos;
+
+	scale.x = f->width / f->cam.w;
+	scale.y = f->height / f->cam.h;
+	pos.x = -f->cam.x * scale.x;
+	pos.y = -f->cam.y * scale.y;
+	draw_map(f, scale, pos, false);
 }
 
 /**
- * update_sprites() - Update sprites
+ * draw_minimap() - Draw map in top right corner of view
+ * @f: Frame being drawn
+ *
+ * Map is scaled so its longer side fits MINIMAP_PX.
  */
-static void update_sprites(void)
+static void draw_minimap(const frame *f)
+{
+	v2 scale;
+	v2 pos;
+
+	scale.x = (float) MINIMAP_PX / max(f->map_w, f->map_h);
+	scale.y = scale.x;
+	pos.x = f->width - f->map_w * scale.x - MINIMAP_GAP;
+	pos.y = MINIMAP_GAP;
+	draw_map(f, scale, pos, true);
+}
+
+/**
+ * use_overview() - Check if tiles are too small to draw as sprites
+ *
+ * Return: True if map should be drawn from minimap
+ */
+static bool use_overview(void)
+{
+	return g_view_width < OVERVIEW_PX * g_cam.w;
+}
+
+/**
+ * start_sprites() - Creates empty sprite buffer 
+ * @mem: Arena to allocate buffer from
+ */
+static square_buf *start_sprites(arena *mem)
 {
 	square_buf *buf;
 
-	buf = start_sprites(); 
-	if (!buf) {
+	buf = (square_buf *) arena_alloc(mem, sizeof(*buf));
+	buf->mem = mem;
+	buf->count = 0;
+	buf->cap = MIN_SQUARES;
+	buf->squares = (square *) arena_alloc(mem, 
+			buf->cap * sizeof(*buf->squares));
+	return buf;
+}
+
+/**
+ * view_tiles() - Get box of tiles in view
+ *
+ * One extra tile is drawn past camera when it is not aligned.
+ *
+ * Return: Tiles of view, from camera
+ */
+static tile_box view_tiles(void)
+{
+	tile_box box;
+
+	box.l = 0;
+	box.t = 0;
+	box.r = g_cam.w;
+	box.b = g_cam.h;
+	return box;
+}
+
+/**
+ * build_layer() - Queue tiles of tile layer to redraw
+ * @f: Frame being built
+ *
+ * Layer is redrawn whole if the camera, viewport or grid
+ * changed since it was drawn, otherwise only where tiles were
+ * invalidated since, if at all.
+ */
+static void build_layer(frame *f)
+{
+	tile_box box;
+	tile_box all;
+	int cx, cy;
+
+	all = view_tiles();
+	cx = g_cam.x;
+	cy = g_cam.y;
+	box = g_layer.dirty;
+	if (!g_layer.valid || memcmp(&g_layer.cam, &g_cam, sizeof(g_cam)) ||
+			g_layer.width != g_view_width ||
+			g_layer.height != g_view_height ||
+			g_layer.grid != g_grid_on) {
+		box = all;
+	} else if (box.l <= box.r) {
+		box.l = max(box.l - cx - LAYER_REACH, all.l);
+		box.t = max(box.t - cy - LAYER_REACH, all.t);
+		box.r = min(box.r - cx + LAYER_REACH, all.r);
+		box.b = min(box.b - cy + LAYER_REACH, all.b);
+	}
+
+	g_layer.cam = g_cam;
+	g_layer.width = g_view_width;
+	g_layer.height = g_view_height;
+	g_layer.grid = g_grid_on;
+	g_layer.valid = true;
+	g_layer.dirty = empty_box();
+
+	f->layer = NULL;
+	f->layer_box = box;
+	if (box.l > box.r || box.t > box.b) {
 		return;
 	}
 
-	render_tiles(buf);
+	/*sprites of tiles around the box reach into it*/
+	f->layer = start_sprites(&f->mem);
+	box.l -= LAYER_REACH;
+	box.t -= LAYER_REACH;
+	box.r += LAYER_REACH;
+	box.b += LAYER_REACH;
+	render_tiles(f->layer, &box);
+}
+
+/**
+ * build_frame() - Take snapshot of game state to draw 
+ * @f: Frame to build, must not be shared with render thread
+ * @stamp: Performance counter when input was sampled
+ */
+static void build_frame(frame *f, int64_t stamp)
+{
+	square_buf *buf;
+	tile_box all;
+
+	reset_arena(&f->mem);
+	buf = start_sprites(&f->mem); 
+
+	f->overview = use_overview();
+	f->minimap = g_minimap_on && !f->overview && g_gm->w && g_gm->h;
+	if (f->overview || f->minimap) {
+		AcquireSRWLockExclusive(&g_mm_lock);
+		update_minimap(&g_mm, g_gm);
+		ReleaseSRWLockExclusive(&g_mm_lock);
+	}
+	f->cached = !g_running && !f->overview;
+	f->layer = NULL;
+	if (f->cached) {
+		build_layer(f);
+	} else if (!f->overview) {
+		all = view_tiles();
+		render_tiles(buf, &all);
+	}
 	if (g_running) {
+		/*game draws over the view without the layer*/
+		g_layer.valid = false;
 		push_sprite(buf, g_cloud_x, 0.375F, 
 				LAYER_CLOUD, SPR_BIG_CLOUDS, 0);
 		push_sprite(buf, g_cloud_x + 14.0F, 0.375F, 
@@ -1030,19 +1948,450 @@ static void update_sprites(void)
 	}
 	render_entities(buf);
 
-	end_sprites(buf);
+	f->buf = buf;
+	f->cam = g_cam;
+	f->map_w = g_gm->w;
+	f->map_h = g_gm->h;
+	f->sel = g_running ? empty_box() : g_sel;
+	f->width = g_view_width;
+	f->height = g_view_height;
+	f->stamp = stamp;
 }
 
-void render(void)
+/**
+ * use_sprite_prog() - Bind program of current render path
+ * @cam: Camera to draw with
+ */
+static void use_sprite_prog(const rect *cam)
+{
+	switch (g_render_path) {
+	case RENDER_GEOM:
+		glUseProgram(g_sprite_prog);
+		glUniform2f(g_sprite_view_ul, cam->w, cam->h);
+		break;
+	case RENDER_INST:
+		glUseProgram(g_inst_prog);
+		glUniform2f(g_inst_view_ul, cam->w, cam->h);
+		break;
+	}
+}
+
+/**
+ * start_render() - Clear frame and bind state for current render path
+ * @cam: Camera to draw with
+ */
+static void start_render(const rect *cam)
 {
 	glClearColor(0.2F, 0.3F, 0.3F, 1.0F);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glClear(GL_COLOR_BUFFER_BIT);
 
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, g_tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, g_tex);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, g_rect_tex);
+
+	use_sprite_prog(cam);
+}
+
+/**
+ * draw_selection() - Outline selected tiles
+ * @f: Frame being drawn
+ *
+ * Each edge is a scissored clear, so no program is needed.
+ */
+static void draw_selection(const frame *f)
+{
+	const tile_box *s;
+	float sx, sy;
+	int l, t, r, b;
+
+	s = &f->sel;
+	if (s->l > s->r || s->t > s->b) {
+		return;
+	}
+
+	/*window y goes up from the bottom*/
+	sx = f->width / f->cam.w;
+	sy = f->height / f->cam.h;
+	l = (s->l - f->cam.x) * sx;
+	r = (s->r + 1 - f->cam.x) * sx;
+	t = f->height - (s->t - f->cam.y) * sy;
+	b = f->height - (s->b + 1 - f->cam.y) * sy;
+
+	glEnable(GL_SCISSOR_TEST);
+	glClearColor(1.0F, 1.0F, 1.0F, 1.0F);
+	glScissor(l, b, r - l, SEL_PX);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glScissor(l, t - SEL_PX, r - l, SEL_PX);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glScissor(l, b, SEL_PX, t - b);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glScissor(r - SEL_PX, b, SEL_PX, t - b);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+}
 
-	glUseProgram(g_sprite_prog);
-	glUniform2f(g_sprite_view_ul, g_cam.w, g_cam.h);
-	update_sprites();
+/**
+ * draw_layer() - Redraw queued tiles into tile layer and copy it to view
+ * @f: Frame being drawn
+ *
+ * A viewport of a new size is always redrawn whole, so the
+ * texture is only resized then.
+ */
+static void draw_layer(const frame *f)
+{
+	float sx, sy;
+	float fx, fy;
+	int l, t, r, b;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, g_layer.fbo);
+	if (g_layer.tex_w != f->width || g_layer.tex_h != f->height) {
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, g_layer.tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, f->width, f->height,
+				0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+				GL_TEXTURE_2D, g_layer.tex, 0);
+		g_layer.tex_w = f->width;
+		g_layer.tex_h = f->height;
+	}
+
+	/*window y goes up from the bottom*/
+	if (f->layer) {
+		sx = f->width / f->cam.w;
+		sy = f->height / f->cam.h;
+		fx = fmodf(f->cam.x, 1.0F);
+		fy = fmodf(f->cam.y, 1.0F);
+		l = floorf((f->layer_box.l - fx) * sx);
+		r = ceilf((f->layer_box.r + 1 - fx) * sx);
+		t = f->height - floorf((f->layer_box.t - fy) * sy);
+		b = f->height - ceilf((f->layer_box.b + 1 - fy) * sy);
+
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(l, b, r - l, t - b);
+		glClear(GL_COLOR_BUFFER_BIT);
+		render_sprites(f->layer);
+		glDisable(GL_SCISSOR_TEST);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, g_layer.fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, f->width, f->height, 0, 0, f->width,
+			f->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/**
+ * draw_frame() - Draw snapshot with context current to thread 
+ * @f: Frame to draw
+ */
+static void draw_frame(frame *f)
+{
+	glViewport(0, 0, f->width, f->height);
+	start_render(&f->cam);
+	if (f->overview || f->minimap) {
+		upload_minimap();
+	}
+	if (f->overview) {
+		draw_overview(f);
+		use_sprite_prog(&f->cam);
+	}
+	if (f->cached) {
+		draw_layer(f);
+	}
+	render_sprites(f->buf);
+	draw_selection(f);
+	if (f->minimap) {
+		draw_minimap(f);
+	}
 	SwapBuffers(g_hdc);
 }
+
+void resize_viewport(int width, int height)
+{
+	g_view_width = width;
+	g_view_height = height;
+}
+
+void render(void)
+{
+	frame *f;
+
+	f = g_frames + g_frame_back;
+	build_frame(f, 0);
+	draw_frame(f);
+	g_dirty = false;
+}
+
+void invalidate_view(void)
+{
+	g_dirty = true;
+}
+
+void invalidate_map(void)
+{
+	mark_minimap(&g_mm, 0, 0, MAX_MAP_LEN, MAX_MAP_LEN);
+	grow_box(&g_layer.dirty, 0, 0, MAX_MAP_LEN, MAX_MAP_LEN);
+	g_dirty = true;
+}
+
+void invalidate_tiles(int l, int t, int r, int b)
+{
+	mark_minimap(&g_mm, l, t, r, b);
+	grow_box(&g_layer.dirty, l, t, r, b);
+
+	/*one extra tile is drawn past camera when it is not aligned*/
+	if (r >= (int) g_cam.x && l <= g_cam.x + g_cam.w &&
+			b >= (int) g_cam.y && t <= g_cam.y + g_cam.h) {
+		g_dirty = true;
+	}
+}
+
+bool render_dirty(void)
+{
+	if (!g_dirty) {
+		return false;
+	}
+	render();
+	return true;
+}
+
+/**
+ * record_latency() - Add latency of frame just drawn to stats 
+ * @f: Frame drawn
+ */
+static void record_latency(const frame *f)
+{
+	frame_stats *fs;
+	int64_t now;
+	int64_t lat;
+
+	fs = &g_frame_stats;
+	QueryPerformanceCounter((LARGE_INTEGER *) &now);
+	lat = now - f->stamp;
+	if (!fs->count || lat < fs->min) {
+		fs->min = lat;
+	}
+	if (!fs->count || lat > fs->max) {
+		fs->max = lat;
+	}
+	fs->sum += lat;
+	fs->count++;
+}
+
+/**
+ * render_proc() - Render thread, draws the newest published frame 
+ * @param: Unused
+ *
+ * Return: Zero
+ */
+static DWORD WINAPI render_proc(void *param)
+{
+	wglMakeCurrent(g_hdc, g_glrc);
+	while (1) {
+		WaitForSingleObject(g_frame_event, INFINITE);
+		if (!g_render_on) {
+			break;
+		}
+
+		if (!(g_frame_mid & FRAME_FRESH)) {
+			continue;
+		}
+		g_frame_front = InterlockedExchange(&g_frame_mid, 
+				g_frame_front) & FRAME_INDEX;
+		draw_frame(g_frames + g_frame_front);
+		record_latency(g_frames + g_frame_front);
+	}
+	wglMakeCurrent(NULL, NULL);
+	return 0;
+}
+
+void start_render_thread(void)
+{
+	memset(&g_frame_stats, 0, sizeof(g_frame_stats));
+	g_render_on = true;
+	g_frame_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+	if (!g_frame_event) {
+		fprintf(stderr, "CreateEventW failed\n");
+		ExitProcess(1);
+	}
+
+	wglMakeCurrent(NULL, NULL);
+	g_render_thread = CreateThread(NULL, 0, render_proc, 
+			NULL, 0, NULL);
+	if (!g_render_thread) {
+		fprintf(stderr, "CreateThread failed\n");
+		ExitProcess(1);
+	}
+}
+
+void submit_frame(int64_t stamp)
+{
+	LONG old;
+
+	build_frame(g_frames + g_frame_back, stamp);
+	old = InterlockedExchange(&g_frame_mid, 
+			g_frame_back | FRAME_FRESH);
+	if (old & FRAME_FRESH) {
+		g_frame_stats.dropped++;
+	}
+	g_frame_back = old & FRAME_INDEX;
+	SetEvent(g_frame_event);
+}
+
+void stop_render_thread(void)
+{
+	frame_stats *fs;
+	int64_t freq;
+	size_t high;
+	int i;
+
+	g_render_on = false;
+	SetEvent(g_frame_event);
+	WaitForSingleObject(g_render_thread, INFINITE);
+	CloseHandle(g_render_thread);
+	CloseHandle(g_frame_event);
+	wglMakeCurrent(g_hdc, g_glrc);
+
+	/*frame left in mailbox was never drawn*/
+	fs = &g_frame_stats;
+	if (g_frame_mid & FRAME_FRESH) {
+		g_frame_mid &= FRAME_INDEX;
+		fs->dropped++;
+	}
+
+	if (fs->count) {
+		QueryPerformanceFrequency((LARGE_INTEGER *) &freq);
+		fprintf(stderr, "render thread: %d frames, %d dropped, "
+				"latency min %.2f avg %.2f max %.2f ms\n",
+				fs->count, fs->dropped, 
+				1000.0 * fs->min / freq,
+				1000.0 * fs->sum / fs->count / freq,
+				1000.0 * fs->max / freq);
+	}
+
+	high = 0;
+	for (i = 0; i < COUNTOF_FRAMES; i++) {
+		if (g_frames[i].mem.high > high) {
+			high = g_frames[i].mem.high;
+		}
+	}
+	fprintf(stderr, "frame arenas: %zu bytes high water\n", high);
+}
+
+/**
+ * bench_fill() - Fill buffer with squares for benchmarking
+ * @buf: Buffer to fill
+ * @spread: Distance in pixels between successive squares 
+ *
+ * Squares are laid out in rows that wrap around the camera,
+ * a spread of zero piles all squares on top of each other.
+ */
+static void bench_fill(square_buf *buf, int spread)
+{
+	int cw, ch;
+	int i;
+
+	cw = g_cam.w * TILE_LEN;
+	ch = g_cam.h * TILE_LEN;
+	for (i = 0; i < BENCH_SQUARES; i++) {
+		square *s;
+		int p;
+
+		p = i * spread;
+		s = buf->squares + i;
+		s->x = p % cw;
+		s->y = (p / cw * TILE_LEN) % ch;
+		s->id = SPR_GROUND;
+		s->layer = LAYER_FORE;
+		s->flip = i & 1;
+	}
+	buf->count = BENCH_SQUARES;
+	buf->cap = BENCH_SQUARES;
+}
+
+/**
+ * bench_path() - Time current render path
+ * @buf: Squares to draw every batch
+ * @batches: Count of times to draw buffer per frame
+ *
+ * Return: Milliseconds per frame
+ */
+static double bench_path(square_buf *buf, int batches)
+{
+	int64_t freq;
+	int64_t begin;
+	int64_t end;
+	int i;
+
+	QueryPerformanceFrequency((LARGE_INTEGER *) &freq);
+	QueryPerformanceCounter((LARGE_INTEGER *) &begin);
+	for (i = 0; i < BENCH_FRAMES; i++) {
+		int n;
+
+		reset_arena(buf->mem);
+		start_render(&g_cam);
+		for (n = 0; n < batches; n++) {
+			render_sprites(buf);
+		}
+		SwapBuffers(g_hdc);
+	}
+	glFinish();
+	QueryPerformanceCounter((LARGE_INTEGER *) &end);
+
+	return 1000.0 * (end - begin) / freq / BENCH_FRAMES;
+}
+
+void bench_render(void)
+{
+	static const char *const names[COUNTOF_RENDER] = {
+		[RENDER_GEOM] = "geometry",
+		[RENDER_INST] = "instanced"
+	};
+
+	square_buf *buf;
+	rect old_cam;
+	RECT rc;
+	double px_per_square;
+	int path;
+
+	buf = (square_buf *) xmalloc(sizeof(*buf));
+	/*render thread is not running, so any slot is free*/
+	buf->mem = &g_frames[0].mem;
+	buf->squares = (square *) xmalloc(BENCH_SQUARES * 
+			sizeof(*buf->squares));
+	old_cam = g_cam;
+	GetClientRect(g_wnd, &rc);
+	glViewport(0, 0, rc.right - rc.left, rc.bottom - rc.top);
+
+	wglSwapIntervalEXT(0);
+	for (path = 0; path < COUNTOF_RENDER; path++) {
+		double ms;
+
+		g_render_path = path;
+
+		/*throughput: small squares side by side*/
+		g_cam.w = VIEW_TW * 8;
+		g_cam.h = VIEW_TH * 8;
+		bench_fill(buf, TILE_LEN);
+		ms = bench_path(buf, 16);
+		fprintf(stderr, "%s: throughput %.3f ms/frame, "
+				"%.2f Msquares/s\n", names[path], ms, 
+				16 * BENCH_SQUARES / ms / 1000.0); 
+
+		/*fill rate: full size squares piled up*/
+		g_cam = old_cam;
+		px_per_square = (double) (rc.right - rc.left) * 
+				(rc.bottom - rc.top) / (g_cam.w * g_cam.h);
+		bench_fill(buf, 0);
+		ms = bench_path(buf, 1);
+		fprintf(stderr, "%s: fill %.3f ms/frame, "
+				"%.1f Mpixels/s\n", names[path], ms, 
+				BENCH_SQUARES * px_per_square / ms / 1000.0);
+	}
+	wglSwapIntervalEXT(1);
+	g_render_path = RENDER_INST;
+
+	free(buf->squares);
+	free(buf);
+}
@@ -3,31 +3,13 @@
 
 #include <stdint.h>
 #include <windows.h>
+#include "cam.hpp"
 #include "game-map.hpp"
 #include "sprites.hpp"
 
-#define TILE_LEN 32 
-
-#define VIEW_TW 8
-#define VIEW_TH 6
-
 #define VIEW_WIDTH (VIEW_TW * TILE_LEN) 
 #define VIEW_HEIGHT (VIEW_TH * TILE_LEN) 
 
-/**
- * rect - Rectangle 
- * @x: left-most pos 
- * @y: top-most pos 
- * @w: width
- * @h: height
- */
-struct rect {
-	float x;
-	float y;
-	float w;
-	float h;
-};
-
 /**
  * Window Globals
  * @g_wnd: Main window
@@ -39,28 +21,97 @@ extern HMENU g_menu;
 /**
  * Sprite Globals
  * @g_grid_on: Have a grid of tile map
- * @g_cam: Camera rect
+ * @g_minimap_on: Have a minimap in the corner
+ * @g_sel: Selected tiles of editor, outlined when not empty
  */
 extern bool g_grid_on;
-extern rect g_cam;
+extern bool g_minimap_on;
+extern tile_box g_sel;
 extern bool g_running;
 extern float g_cloud_x;
 
 /**
- * bound_cam() - Bounds camera to inside borders 
- *
- * Return: Returns true if camera position changed
+ * init_gl() - initialize OpenGL context and load necessary extensions 
  */
-bool bound_cam(void); 
+void init_gl(void);
 
 /**
- * init_gl() - initialize OpenGL context and load necessary extensions 
+ * resize_viewport() - Set viewport used by subsequent frames
+ * @width: Width of client area
+ * @height: Height of client area
  */
-void init_gl(void);
+void resize_viewport(int width, int height);
 
 /**
- * render() - Render tile map
+ * render() - Render tile map on calling thread
+ *
+ * Must not be called while the render thread is running.
  */
 void render(void);
 
+/**
+ * invalidate_view() - Redraw whole view on next render_dirty()
+ *
+ * Used when the camera, viewport, map, or grid changes.
+ */
+void invalidate_view(void);
+
+/**
+ * invalidate_map() - Redraw whole view and map overview
+ *
+ * Used when tiles may have changed anywhere in the map.
+ */
+void invalidate_map(void);
+
+/**
+ * invalidate_tiles() - Redraw on next render_dirty() if tiles are in view
+ * @l: Left of changed tiles
+ * @t: Top of changed tiles
+ * @r: Right of changed tiles, inclusive
+ * @b: Bottom of changed tiles, inclusive
+ *
+ * The editor keeps its backdrop, tiles and grid in a cached
+ * layer, only these tiles are drawn again into it.
+ */
+void invalidate_tiles(int l, int t, int r, int b);
+
+/**
+ * render_dirty() - Render tile map only if it was invalidated
+ *
+ * Return: True if a frame was drawn
+ */
+bool render_dirty(void);
+
+/**
+ * start_render_thread() - Hand OpenGL context to render thread 
+ *
+ * Until stopped, frames are drawn by the render thread 
+ * from snapshots published with submit_frame().
+ */
+void start_render_thread(void);
+
+/**
+ * submit_frame() - Snapshot game state and publish it to render thread
+ * @stamp: Performance counter when input of frame was sampled 
+ *
+ * Never waits on the render thread. If the previous snapshot
+ * has not been drawn yet, it is replaced.
+ */
+void submit_frame(int64_t stamp);
+
+/**
+ * stop_render_thread() - Join render thread and take back context 
+ *
+ * Prints input to display latency of frames drawn, and high
+ * water mark of frame arenas, to standard error.
+ */
+void stop_render_thread(void);
+
+/**
+ * bench_render() - Compare throughput and fill rate of render paths 
+ *
+ * Results are printed to standard error.
+ */
+void bench_render(void);
+
 #endif
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "input.hpp"
+#include "perf.hpp"
+#include "replay.hpp"
+
+/**
+ * read_event() - Read next event of replay
+ * @r: Replay to read from
+ */
+static void read_event(replay *r)
+{
+	long long us;
+
+	r->more = fscanf(r->f, "%lld %d %d", &us, &r->bt, &r->down) == 3;
+	if (!r->more) {
+		if (!feof(r->f)) {
+			fprintf(stderr, "replay: Malformed event\n");
+		}
+		return;
+	}
+
+	if (us < 0 || r->bt < 0 || r->bt >= COUNTOF_BT) {
+		fprintf(stderr, "replay: Invalid event\n");
+		r->more = false;
+		return;
+	}
+	r->next = r->start + us * r->freq / 1000000;
+}
+
+int open_replay(replay *r, const wchar_t *path, int64_t start)
+{
+	memset(r, 0, sizeof(*r));
+	r->f = _wfopen(path, L"r");
+	if (!r->f) {
+		fprintf(stderr, "replay: Failed to open %ls\n", path);
+		return -1;
+	}
+
+	r->freq = query_perf_freq();
+	r->start = start;
+	read_event(r);
+	return 0;
+}
+
+void close_replay(replay *r)
+{
+	if (r->f) {
+		fclose(r->f);
+	}
+	memset(r, 0, sizeof(*r));
+}
+
+void poll_replay(void *ctx, int64_t stamp)
+{
+	replay *r;
+
+	r = (replay *) ctx;
+	while (r->more && r->next <= stamp) {
+		push_button(r->bt, r->down, r->next);
+		read_event(r);
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * replay - Input source that plays back a file of recorded input
+ * @f: File being played back
+ * @start: Performance counter file is timed from
+ * @freq: Frequency of performance counter
+ * @next: Performance counter of next event
+ * @bt: BT_* of next event
+ * @down: Button of next event is down
+ * @more: Next event is valid
+ *
+ * Files are written by record_input(), one event a line.
+ */
+struct replay {
+	FILE *f;
+	int64_t start;
+	int64_t freq;
+	int64_t next;
+	int bt;
+	int down;
+	bool more;
+};
+
+/**
+ * open_replay() - Open file of recorded input
+ * @r: Replay to open
+ * @path: Path to file
+ * @start: Performance counter playback starts at
+ *
+ * Return: Zero on success, negative on failure
+ */
+int open_replay(replay *r, const wchar_t *path, int64_t start);
+
+/**
+ * close_replay() - Close file of replay
+ * @r: Replay to close
+ */
+void close_replay(replay *r);
+
+/**
+ * poll_replay() - Queue events due by stamp, an input_poll_fn
+ * @ctx: Replay
+ * @stamp: Performance counter of poll
+ *
+ * Events are queued with the stamps they were recorded at.
+ */
+void poll_replay(void *ctx, int64_t stamp);
+
+#endif
@@ -0,0 +1,241 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "resample.hpp"
+#include "util.hpp"
+
+#define PCM_SCALE (1.0F / 32768.0F)
+
+#define POS_SHIFT 32
+#define POS_ONE ((uint64_t) 1 << POS_SHIFT)
+
+/**
+ * Shape of Kaiser window, higher trades a wider transition band
+ * for lower sidelobes
+ */
+#define KAISER_BETA 8.0
+
+/**
+ * bessel_i0() - Modified Bessel function of order zero
+ * @x: Argument
+ *
+ * Return: I0 of x
+ */
+static double bessel_i0(double x)
+{
+	double sum;
+	double term;
+	int k;
+
+	sum = 1.0;
+	term = 1.0;
+	for (k = 1; k < 32; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+/**
+ * make_table() - Compute filter taps of every phase
+ * @table: Table to fill, RS_PHASES by RS_TAPS
+ * @cutoff: Cutoff as a fraction of input Nyquist rate
+ *
+ * Taps of each phase are normalized so gain at DC is one.
+ */
+static void make_table(float *table, double cutoff)
+{
+	int p;
+
+	for (p = 0; p < RS_PHASES; p++) {
+		float *taps;
+		double frac;
+		double sum;
+		int k;
+
+		taps = table + p * RS_TAPS;
+		frac = (double) p / RS_PHASES;
+		sum = 0.0;
+		for (k = 0; k < RS_TAPS; k++) {
+			double t;
+			double w;
+			double h;
+
+			/*distance from output frame to input frame k*/
+			t = k - (RS_TAPS / 2 - 1) - frac;
+			w = 2.0 * t / RS_TAPS;
+			w = w * w < 1.0 ? bessel_i0(KAISER_BETA *
+					sqrt(1.0 - w * w)) : 0.0;
+			h = t != 0.0 ? sin(M_PI * cutoff * t) / (M_PI * t) :
+					cutoff;
+			taps[k] = h * w;
+			sum += taps[k];
+		}
+
+		for (k = 0; k < RS_TAPS; k++) {
+			taps[k] /= sum;
+		}
+	}
+}
+
+int init_resampler(resampler *rs, int in_rate, int out_rate,
+		int channels, voice_read_fn *read, void *ctx)
+{
+	double cutoff;
+
+	memset(rs, 0, sizeof(*rs));
+	rs->table = (float *) malloc(RS_PHASES * RS_TAPS * sizeof(float));
+	if (!rs->table) {
+		return -1;
+	}
+
+	/*leave room for the transition band below Nyquist*/
+	cutoff = 0.9 * fmin(1.0, (double) out_rate / in_rate);
+	make_table(rs->table, cutoff);
+
+	rs->read = read;
+	rs->ctx = ctx;
+	rs->channels = channels;
+	rs->step = ((uint64_t) in_rate << POS_SHIFT) / out_rate;
+	reset_resampler(rs);
+	return 0;
+}
+
+void reset_resampler(resampler *rs)
+{
+	/*center first output frame on first input frame*/
+	memset(rs->hist, 0, sizeof(rs->hist));
+	rs->len = RS_TAPS / 2 - 1;
+	rs->pos = 0;
+	rs->ended = false;
+}
+
+void destroy_resampler(resampler *rs)
+{
+	free(rs->table);
+	rs->table = NULL;
+}
+
+/**
+ * refill() - Pull more frames of source into history
+ * @rs: Resampler
+ *
+ * Frames before the filter are dropped first. A source that
+ * ends is padded with silence until its last frame has passed
+ * through the filter.
+ *
+ * Return: Zero on success, negative if nothing is left
+ */
+static int refill(resampler *rs)
+{
+	int start;
+	int n;
+	int c;
+	int i;
+
+	start = rs->pos >> POS_SHIFT;
+	for (c = 0; c < rs->channels; c++) {
+		memmove(rs->hist[c], rs->hist[c] + start,
+				(rs->len - start) * sizeof(float));
+	}
+	rs->len -= start;
+	rs->pos -= (uint64_t) start << POS_SHIFT;
+
+	if (rs->ended) {
+		return -1;
+	}
+
+	n = rs->read(rs->ctx, rs->in, RS_BLOCK - RS_TAPS / 2);
+	if (n < RS_BLOCK - RS_TAPS / 2) {
+		/*let the tail of the source clear the filter*/
+		memset(rs->in + n * rs->channels, 0,
+				RS_TAPS / 2 * rs->channels * sizeof(*rs->in));
+		n += RS_TAPS / 2;
+		rs->ended = true;
+	}
+
+	for (c = 0; c < rs->channels; c++) {
+		float *dst;
+
+		dst = rs->hist[c] + rs->len;
+		for (i = 0; i < n; i++) {
+			dst[i] = rs->in[i * rs->channels + c] * PCM_SCALE;
+		}
+	}
+	rs->len += n;
+	return 0;
+}
+
+/**
+ * dot() - Apply filter to frames of one channel
+ * @x: First frame under filter
+ * @h: Taps of phase
+ *
+ * Return: Filtered sample
+ */
+static float dot(const float *x, const float *h)
+{
+#ifdef __SSE2__
+	__m128 acc;
+#else
+	float acc;
+#endif
+	int i;
+
+#ifdef __SSE2__
+	acc = _mm_setzero_ps();
+	for (i = 0; i < RS_TAPS; i += 4) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + i),
+				_mm_loadu_ps(h + i)));
+	}
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+	return _mm_cvtss_f32(acc);
+#else
+	acc = 0.0F;
+	for (i = 0; i < RS_TAPS; i++) {
+		acc += x[i] * h[i];
+	}
+	return acc;
+#endif
+}
+
+int read_resampled(void *ctx, int16_t *dst, int count)
+{
+	resampler *rs;
+	int i;
+
+	rs = (resampler *) ctx;
+	for (i = 0; i < count; i++) {
+		const float *h;
+		int start;
+		int c;
+
+		start = rs->pos >> POS_SHIFT;
+		if (start + RS_TAPS > rs->len) {
+			if (refill(rs) < 0) {
+				break;
+			}
+			start = rs->pos >> POS_SHIFT;
+			if (start + RS_TAPS > rs->len) {
+				break;
+			}
+		}
+
+		h = rs->table + ((rs->pos & (POS_ONE - 1)) >>
+				(POS_SHIFT - RS_PHASE_BITS)) * RS_TAPS;
+		for (c = 0; c < rs->channels; c++) {
+			float y;
+
+			y = dot(rs->hist[c] + start, h) * 32768.0F;
+			*dst++ = lrintf(fclampf(y, -32768.0F, 32767.0F));
+		}
+		rs->pos += rs->step;
+	}
+	return i;
+}
@@ -0,0 +1,93 @@
+#ifndef RESAMPLE_HPP
+#define RESAMPLE_HPP
+
+#include <stdint.h>
+
+#include "mixer.hpp"
+
+/**
+ * Taps of filter per output sample, a multiple of four
+ */
+#define RS_TAPS 32
+
+/**
+ * Fractional positions the filter is tabled at
+ */
+#define RS_PHASE_BITS 8
+#define RS_PHASES (1 << RS_PHASE_BITS)
+
+/**
+ * Most input frames pulled from the source at once
+ */
+#define RS_BLOCK 512
+
+/**
+ * resampler - Band limited polyphase converter between rates
+ * @table: Filter taps of every phase, RS_PHASES by RS_TAPS
+ * @read: Pulls interleaved frames of source at input rate
+ * @ctx: Passed to read
+ * @channels: Count of channels, one or two
+ * @pos: First frame under filter, 32.32 fixed point into hist
+ * @step: Input frames per output frame, 32.32 fixed point
+ * @len: Count of frames in hist
+ * @ended: Source returned short, no more frames will be pulled
+ * @hist: Frames of each channel the filter reads from
+ * @in: Frames pulled from source
+ *
+ * The filter is a Kaiser windowed sinc with its cutoff below
+ * the lower of the two Nyquist rates, so downsampling does not
+ * alias. Every output frame costs RS_TAPS multiplies a channel.
+ */
+struct resampler {
+	float *table;
+	voice_read_fn *read;
+	void *ctx;
+	int channels;
+	uint64_t pos;
+	uint64_t step;
+	int len;
+	bool ended;
+	alignas(16) float hist[2][RS_TAPS + RS_BLOCK];
+	alignas(16) int16_t in[RS_BLOCK * 2];
+};
+
+/**
+ * init_resampler() - Build filter table and start resampler empty
+ * @rs: Resampler to initialize
+ * @in_rate: Rate of source
+ * @out_rate: Rate of output
+ * @channels: Count of interleaved channels, one or two
+ * @read: Pulls frames of source, counts are in frames
+ * @ctx: Passed to read
+ *
+ * Return: Zero on success, negative on failure
+ */
+int init_resampler(resampler *rs, int in_rate, int out_rate,
+		int channels, voice_read_fn *read, void *ctx);
+
+/**
+ * reset_resampler() - Drop buffered frames, keeping filter table
+ * @rs: Resampler to reset
+ */
+void reset_resampler(resampler *rs);
+
+/**
+ * destroy_resampler() - Free filter table
+ * @rs: Resampler to destroy
+ */
+void destroy_resampler(resampler *rs);
+
+/**
+ * read_resampled() - Pull frames at output rate
+ * @ctx: Resampler
+ * @dst: Interleaved frames to fill
+ * @count: Count of frames requested
+ *
+ * Matches voice_read_fn, so a resampler can feed a voice or
+ * another resampler.
+ *
+ * Return: Count of frames read, short once the source has ended
+ */
+int read_resampled(void *ctx, int16_t *dst, int count);
+
+#endif
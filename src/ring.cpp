@@ -0,0 +1,109 @@
+#include <stdlib.h>
+
+#include "ring.hpp"
+
+int init_ring(ring *r, int frames)
+{
+	uint32_t cap;
+
+	cap = 1;
+	while (cap < (uint32_t) frames) {
+		cap *= 2;
+	}
+
+	r->data = (int16_t *) malloc(cap * 2 * sizeof(*r->data));
+	if (!r->data) {
+		return -1;
+	}
+	r->cap = cap;
+	r->write = 0;
+	r->read = 0;
+	return 0;
+}
+
+void destroy_ring(ring *r)
+{
+	free(r->data);
+	r->data = NULL;
+}
+
+void reset_ring(ring *r)
+{
+	__atomic_store_n(&r->write, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&r->read, 0, __ATOMIC_RELEASE);
+}
+
+int16_t *ring_write_ptr(ring *r, int *frames)
+{
+	uint32_t read;
+	uint32_t at;
+	uint32_t space;
+
+	read = __atomic_load_n(&r->read, __ATOMIC_ACQUIRE);
+	at = r->write & (r->cap - 1);
+	space = r->cap - (r->write - read);
+	if (space > r->cap - at) {
+		space = r->cap - at;
+	}
+	*frames = space;
+	return r->data + at * 2;
+}
+
+void commit_ring(ring *r, int frames)
+{
+	__atomic_store_n(&r->write, r->write + frames, __ATOMIC_RELEASE);
+}
+
+const int16_t *ring_read_ptr(ring *r, uint32_t pos, int *frames)
+{
+	uint32_t write;
+	uint32_t at;
+	uint32_t avail;
+
+	write = __atomic_load_n(&r->write, __ATOMIC_ACQUIRE);
+	at = pos & (r->cap - 1);
+	avail = write - pos;
+	if (avail > r->cap - at) {
+		avail = r->cap - at;
+	}
+	*frames = avail;
+	return r->data + at * 2;
+}
+
+void release_ring(ring *r, int frames)
+{
+	__atomic_store_n(&r->read, r->read + frames, __ATOMIC_RELEASE);
+}
+
+int fill_ring(ring *r, int target, ring_fill_fn *fill, void *ctx)
+{
+	int room;
+	int done;
+
+	/*contiguous space alone stalls once the cursor nears the end*/
+	room = target - ring_count(r);
+	if (room < target / 4) {
+		return 0;
+	}
+
+	done = 0;
+	while (done < room) {
+		int16_t *dst;
+		int n;
+
+		dst = ring_write_ptr(r, &n);
+		if (n > room - done) {
+			n = room - done;
+		}
+		fill(ctx, dst, n);
+		commit_ring(r, n);
+		done += n;
+	}
+	return done;
+}
+
+int ring_count(ring *r)
+{
+	return __atomic_load_n(&r->write, __ATOMIC_ACQUIRE) - 
+			__atomic_load_n(&r->read, __ATOMIC_ACQUIRE);
+}
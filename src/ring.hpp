@@ -0,0 +1,114 @@
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <stdint.h>
+
+/**
+ * ring - Lock-free single producer, single consumer ring of stereo PCM
+ * @data: Interleaved stereo 16 bit frames
+ * @cap: Capacity in frames, a power of two
+ * @write: Frames ever committed, only stored by producer
+ * @read: Frames ever released, only stored by consumer
+ *
+ * Cursors run freely and are masked on access, so a full ring
+ * and an empty ring can be told apart. Each side reads the
+ * other's cursor with acquire and publishes its own with release,
+ * no locks or syscalls are needed on either side.
+ */
+struct ring {
+	int16_t *data;
+	uint32_t cap;
+	alignas(64) uint32_t write;
+	alignas(64) uint32_t read;
+};
+
+/**
+ * ring_fill_fn - Write frames for producer
+ * @ctx: Context passed to fill_ring()
+ * @dst: Interleaved stereo frames to write
+ * @frames: Count of frames to write
+ */
+typedef void ring_fill_fn(void *ctx, int16_t *dst, int frames);
+
+/**
+ * init_ring() - Allocate empty ring
+ * @r: Ring to initialize
+ * @frames: Minimum capacity in frames, rounded up to a power of two
+ *
+ * Return: Zero on success, negative on failure
+ */
+int init_ring(ring *r, int frames);
+
+/**
+ * destroy_ring() - Free memory of ring
+ * @r: Ring to destroy
+ */
+void destroy_ring(ring *r);
+
+/**
+ * reset_ring() - Empty ring, neither side may be using it
+ * @r: Ring to reset
+ */
+void reset_ring(ring *r);
+
+/**
+ * ring_write_ptr() - Producer side, get contiguous free space
+ * @r: Ring
+ * @frames: Count of free frames from returned pointer
+ *
+ * Return: Where the next frame is to be written
+ */
+int16_t *ring_write_ptr(ring *r, int *frames);
+
+/**
+ * commit_ring() - Producer side, publish written frames
+ * @r: Ring
+ * @frames: Count of frames written
+ */
+void commit_ring(ring *r, int frames);
+
+/**
+ * ring_read_ptr() - Consumer side, get contiguous committed frames
+ * @r: Ring
+ * @pos: Cursor to read from, at or after the read cursor
+ * @frames: Count of committed frames from returned pointer
+ *
+ * Frames stay valid until they are released, so the consumer
+ * may hand them to a device without copying.
+ *
+ * Return: Where frame at pos is
+ */
+const int16_t *ring_read_ptr(ring *r, uint32_t pos, int *frames);
+
+/**
+ * release_ring() - Consumer side, give frames back to producer
+ * @r: Ring
+ * @frames: Count of frames consumed
+ */
+void release_ring(ring *r, int frames);
+
+/**
+ * fill_ring() - Producer side, top ring up to target once it drains
+ * @r: Ring
+ * @target: Frames to keep queued, no more than capacity
+ * @fill: Writes frames
+ * @ctx: Context of fill
+ *
+ * Nothing is written until a quarter of target is free. Then
+ * all free space up to target is written, wrapping past the end
+ * of the ring as needed, and each piece is committed after
+ * fill returns.
+ *
+ * Return: Count of frames written
+ */
+int fill_ring(ring *r, int target, ring_fill_fn *fill, void *ctx);
+
+/**
+ * ring_count() - Count of committed frames not yet released
+ * @r: Ring
+ *
+ * Return: Count of frames
+ */
+int ring_count(ring *r);
+
+#endif
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "save.hpp"
+#include "util.hpp"
+
+/**
+ * save_job - Snapshot of map waiting to be written
+ * @path: Path to save to
+ * @stamp: Performance counter save was requested at
+ * @snap: Performance counter snapshot was taken by
+ * @autosave: Save is an autosave
+ * @size: Size of data
+ * @data: Width and height, then rows, as written to file
+ */
+struct save_job {
+	wchar_t path[MAX_PATH];
+	int64_t stamp;
+	int64_t snap;
+	bool autosave;
+	size_t size;
+	uint8_t data[];
+};
+
+/**
+ * @g_save_ev: Set when a job is handed to the thread
+ * @g_idle_ev: Set while no job is handed or being written
+ * @g_save_job: Job handed to thread, only written while idle
+ * @g_save_wnd: Window WM_SAVED is posted to
+ */
+static HANDLE g_save_thrd;
+static HANDLE g_save_ev;
+static HANDLE g_idle_ev;
+static save_job *g_save_job;
+static HWND g_save_wnd;
+static volatile bool g_save_on;
+static int64_t g_save_freq;
+
+/**
+ * write_job() - Write job to temporary file and rename over path
+ * @job: Job to write
+ * @write: Performance counter write finished at
+ *
+ * Return: Zero on success, negative on failure
+ */
+static int write_job(const save_job *job, int64_t *write)
+{
+	wchar_t tmp[MAX_PATH];
+	HANDLE f;
+	DWORD n;
+	int err;
+
+	if (_snwprintf(tmp, MAX_PATH, L"%s.tmp", job->path) < 0) {
+		return -1;
+	}
+
+	f = CreateFileW(tmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE) {
+		return -1;
+	}
+
+	err = -1;
+	if (!WriteFile(f, job->data, job->size, &n, NULL) ||
+			n != job->size) {
+		goto close;
+	}
+	QueryPerformanceCounter((LARGE_INTEGER *) write);
+
+	/*data must be on disk before rename can replace old map*/
+	if (FlushFileBuffers(f)) {
+		err = 0;
+	}
+close:
+	CloseHandle(f);
+	if (err >= 0 && !MoveFileExW(tmp, job->path,
+			MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		err = -1;
+	}
+	if (err < 0) {
+		DeleteFileW(tmp);
+	}
+	return err;
+}
+
+/**
+ * to_ms() - Convert performance counter ticks to milliseconds
+ * @ticks: Ticks to convert
+ */
+static double to_ms(int64_t ticks)
+{
+	return ticks * 1000.0 / g_save_freq;
+}
+
+/**
+ * save_proc() - Thread, writes jobs as they are handed to it
+ * @ctx: Unused
+ *
+ * Return: Zero
+ */
+static DWORD WINAPI save_proc(void *ctx)
+{
+	UNREFERENCED_PARAMETER(ctx);
+
+	while (WaitForSingleObject(g_save_ev, INFINITE) == WAIT_OBJECT_0) {
+		save_job *job;
+		int64_t write;
+		int64_t done;
+		int err;
+
+		job = g_save_job;
+		if (!job) {
+			break;
+		}
+
+		write = job->snap;
+		err = write_job(job, &write);
+		QueryPerformanceCounter((LARGE_INTEGER *) &done);
+		if (err < 0) {
+			fprintf(stderr, "save: Failed to write %ls\n",
+					job->path);
+		} else {
+			fprintf(stderr, "save: %ls, %zu bytes in %.1f ms "
+					"(snapshot %.2f, write %.1f, "
+					"flush %.1f)\n", job->path, job->size,
+					to_ms(done - job->stamp),
+					to_ms(job->snap - job->stamp),
+					to_ms(write - job->snap),
+					to_ms(done - write));
+		}
+		PostMessageW(g_save_wnd, WM_SAVED, err < 0, job->autosave);
+
+		g_save_job = NULL;
+		free(job);
+		SetEvent(g_idle_ev);
+	}
+	return 0;
+}
+
+int init_save(HWND wnd)
+{
+	QueryPerformanceFrequency((LARGE_INTEGER *) &g_save_freq);
+	g_save_wnd = wnd;
+
+	g_save_ev = CreateEventW(NULL, FALSE, FALSE, NULL);
+	if (!g_save_ev) {
+		goto err0;
+	}
+	g_idle_ev = CreateEventW(NULL, TRUE, TRUE, NULL);
+	if (!g_idle_ev) {
+		goto err1;
+	}
+
+	g_save_on = true;
+	g_save_thrd = CreateThread(NULL, 0, save_proc, NULL, 0, NULL);
+	if (!g_save_thrd) {
+		goto err2;
+	}
+	return 0;
+err2:
+	g_save_on = false;
+	CloseHandle(g_idle_ev);
+err1:
+	CloseHandle(g_save_ev);
+err0:
+	fprintf(stderr, "save: Failed to start thread\n");
+	return -1;
+}
+
+void end_save(void)
+{
+	if (!g_save_on) {
+		return;
+	}
+
+	/*NULL job stops thread once pending save is written*/
+	WaitForSingleObject(g_idle_ev, INFINITE);
+	g_save_on = false;
+	g_save_job = NULL;
+	SetEvent(g_save_ev);
+	WaitForSingleObject(g_save_thrd, INFINITE);
+
+	CloseHandle(g_save_thrd);
+	CloseHandle(g_idle_ev);
+	CloseHandle(g_save_ev);
+}
+
+int save_map(const game_map *gm, const wchar_t *path, bool autosave)
+{
+	save_job *job;
+	uint16_t v[2];
+	uint8_t *p;
+	int y;
+
+	if (!g_save_on || WaitForSingleObject(g_idle_ev,
+			autosave ? 0 : INFINITE) != WAIT_OBJECT_0) {
+		return -1;
+	}
+
+	job = (save_job *) xmalloc(sizeof(*job) + sizeof(v) +
+			(size_t) gm->w * gm->h);
+	QueryPerformanceCounter((LARGE_INTEGER *) &job->stamp);
+	wcsncpy(job->path, path, MAX_PATH - 1);
+	job->path[MAX_PATH - 1] = L'\0';
+	job->autosave = autosave;
+	job->size = sizeof(v) + (size_t) gm->w * gm->h;
+
+	/*one copy, the map is free to change while the job is written*/
+	v[0] = gm->w;
+	v[1] = gm->h;
+	memcpy(job->data, v, sizeof(v));
+	p = job->data + sizeof(v);
+	for (y = 0; y < gm->h; y++) {
+		memcpy(p, gm->rows[y], gm->w);
+		p += gm->w;
+	}
+	QueryPerformanceCounter((LARGE_INTEGER *) &job->snap);
+
+	ResetEvent(g_idle_ev);
+	g_save_job = job;
+	SetEvent(g_save_ev);
+	return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef SAVE_HPP
+#define SAVE_HPP
+
+#include <windows.h>
+
+#include "game-map.hpp"
+
+/**
+ * WM_SAVED - Posted to window when a save finishes
+ *
+ * WPARAM is zero on success and one on failure, LPARAM is
+ * nonzero if the save was an autosave.
+ */
+#define WM_SAVED (WM_APP + 0)
+
+/**
+ * init_save() - Start thread that writes maps
+ * @wnd: Window WM_SAVED is posted to
+ *
+ * Return: Zero on success, negative on failure
+ */
+int init_save(HWND wnd);
+
+/**
+ * end_save() - Finish pending save and stop thread
+ */
+void end_save(void);
+
+/**
+ * save_map() - Snapshot map and write it on save thread
+ * @gm: Map to save
+ * @path: Path to save to
+ * @autosave: Skip instead of waiting if a save is running
+ *
+ * The map is written to a temporary file that is flushed and
+ * then renamed over path, so path is never left half written.
+ *
+ * Return: Zero if queued, negative if skipped or failed
+ */
+int save_map(const game_map *gm, const wchar_t *path, bool autosave);
+
+#endif
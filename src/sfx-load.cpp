@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#include "audio.hpp"
+#include "sfx.hpp"
+#include "sfx-load.hpp"
+#include "win32.hpp"
+
+#define SFX_WORKERS 2
+
+static const wchar_t *const g_sfx_paths[COUNTOF_SFX] = {
+	[SFX_JUMP] = L"jump.wav",
+	[SFX_HIT] = L"hit.wav",
+	[SFX_ATTACK] = L"attack.wav"
+};
+
+/**
+ * @g_sfx_jobs: Clips waiting for a worker
+ * @g_sfx_sem: Count of jobs not yet claimed by a worker
+ */
+static volatile long g_sfx_jobs[COUNTOF_SFX];
+static HANDLE g_sfx_sem;
+static HANDLE g_workers[SFX_WORKERS];
+static volatile bool g_sfx_on;
+
+/**
+ * read_file() - Read entire file into memory
+ * @path: Path to file
+ * @size: Size of file
+ *
+ * Return: Contents of file, NULL on failure
+ */
+static uint8_t *read_file(const wchar_t *path, long *size)
+{
+	FILE *f;
+	uint8_t *data;
+
+	f = _wfopen(path, L"rb");
+	if (!f) {
+		return NULL;
+	}
+
+	data = NULL;
+	if (fseek(f, 0, SEEK_END) < 0) {
+		goto close;
+	}
+	*size = ftell(f);
+	if (*size <= 0 || fseek(f, 0, SEEK_SET) < 0) {
+		goto close;
+	}
+
+	data = (uint8_t *) malloc(*size);
+	if (data && fread(data, *size, 1, f) != 1) {
+		free(data);
+		data = NULL;
+	}
+close:
+	fclose(f);
+	return data;
+}
+
+/**
+ * load_clip() - Read and decode clip, run by a worker
+ * @id: SFX_* of clip
+ */
+static void load_clip(int id)
+{
+	wchar_t path[MAX_PATH];
+	uint8_t *data;
+	long size;
+
+	get_res_pathf(path, L"sfx\\%s", g_sfx_paths[id]);
+	data = read_file(path, &size);
+	if (!data) {
+		fprintf(stderr, "sfx: Failed to read %d\n", id);
+		return;
+	}
+	load_sfx(id, data, size);
+	free(data);
+}
+
+/**
+ * sfx_proc() - Worker, decodes clips as they are queued
+ * @ctx: Unused
+ *
+ * Return: Zero
+ */
+static DWORD WINAPI sfx_proc(void *ctx)
+{
+	UNREFERENCED_PARAMETER(ctx);
+
+	while (WaitForSingleObject(g_sfx_sem, INFINITE) == WAIT_OBJECT_0) {
+		int id;
+
+		if (!g_sfx_on) {
+			break;
+		}
+		for (id = 0; id < COUNTOF_SFX; id++) {
+			if (InterlockedExchange(g_sfx_jobs + id, 0)) {
+				load_clip(id);
+				break;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * queue_clip() - Hand clip to a worker to decode
+ * @id: SFX_* of clip
+ */
+static void queue_clip(int id)
+{
+	g_sfx_jobs[id] = 1;
+	ReleaseSemaphore(g_sfx_sem, 1, NULL);
+}
+
+int init_sfx_load(void)
+{
+	int i;
+
+	g_sfx_sem = CreateSemaphoreW(NULL, 0, COUNTOF_SFX + SFX_WORKERS,
+			NULL);
+	if (!g_sfx_sem) {
+		return -1;
+	}
+
+	g_sfx_on = true;
+	for (i = 0; i < SFX_WORKERS; i++) {
+		g_workers[i] = CreateThread(NULL, 0, sfx_proc, NULL, 0, NULL);
+		if (!g_workers[i]) {
+			goto end;
+		}
+	}
+
+	init_sfx(queue_clip);
+	return 0;
+end:
+	end_sfx_load();
+	fprintf(stderr, "sfx: Failed to start workers\n");
+	return -1;
+}
+
+void end_sfx_load(void)
+{
+	int i;
+
+	g_sfx_on = false;
+	ReleaseSemaphore(g_sfx_sem, SFX_WORKERS, NULL);
+	for (i = 0; i < SFX_WORKERS; i++) {
+		if (g_workers[i]) {
+			WaitForSingleObject(g_workers[i], INFINITE);
+			CloseHandle(g_workers[i]);
+			g_workers[i] = NULL;
+		}
+	}
+	CloseHandle(g_sfx_sem);
+	end_sfx();
+}
@@ -0,0 +1,18 @@
+#ifndef SFX_LOAD_HPP
+#define SFX_LOAD_HPP
+
+/**
+ * init_sfx_load() - Start workers and decode every clip in the background
+ *
+ * Return: Zero on success, negative on failure
+ */
+int init_sfx_load(void);
+
+/**
+ * end_sfx_load() - Stop workers and free every clip
+ *
+ * The audio thread must no longer be using clips.
+ */
+void end_sfx_load(void);
+
+#endif
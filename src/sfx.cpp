@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <string.h>
+
+#define STB_VORBIS_HEADER_ONLY
+#include <stb_vorbis.c>
+
+#include "audio.hpp"
+#include "sfx.hpp"
+#include "util.hpp"
+
+#define CLIP_EMPTY 0
+#define CLIP_LOADING 1
+#define CLIP_READY 2
+
+/**
+ * no_load() - Loader used before init_sfx(), clips stay loading
+ * @id: Unused
+ */
+static void no_load(int id)
+{
+}
+
+static clip g_clips[COUNTOF_SFX];
+
+/**
+ * @g_sfx_bytes: Bytes of resident PCM, added to by loaders
+ * @g_sfx_tick: Incremented every request, audio thread only
+ * @g_sfx_load: Hands clips to be decoded to the loader
+ */
+static volatile long g_sfx_bytes;
+static uint32_t g_sfx_tick;
+static sfx_load_fn *g_sfx_load = no_load;
+
+/**
+ * find_chunk() - Find RIFF chunk
+ * @data: Start of chunks
+ * @end: End of chunks
+ * @id: Four character code of chunk
+ * @size: Size of chunk
+ *
+ * Return: Data of chunk, NULL if not found
+ */
+static const uint8_t *find_chunk(const uint8_t *data, const uint8_t *end,
+		const char *id, uint32_t *size)
+{
+	while (end - data >= 8) {
+		memcpy(size, data + 4, 4);
+		if (!memcmp(data, id, 4)) {
+			return *size <= end - data - 8 ? data + 8 : NULL;
+		}
+		if (*size > end - data - 8) {
+			break;
+		}
+		data += 8 + ((*size + 1) & ~1);
+	}
+	return NULL;
+}
+
+/**
+ * to_mono() - Downmix interleaved PCM in place
+ * @pcm: Samples to downmix
+ * @len: Count of frames
+ * @channels: Count of channels
+ */
+static void to_mono(int16_t *pcm, int len, int channels)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		int sum;
+		int c;
+
+		sum = 0;
+		for (c = 0; c < channels; c++) {
+			sum += pcm[i * channels + c];
+		}
+		pcm[i] = sum / channels;
+	}
+}
+
+/**
+ * decode_wav() - Decode 16 bit PCM WAV
+ * @c: Clip to decode into
+ * @data: Contents of file
+ * @size: Size of file
+ *
+ * Return: Zero on success, negative on failure
+ */
+static int decode_wav(clip *c, const uint8_t *data, long size)
+{
+	const uint8_t *fmt;
+	const uint8_t *pcm;
+	uint32_t fmt_size;
+	uint32_t pcm_size;
+	uint16_t format;
+	uint16_t channels;
+	uint16_t bits;
+
+	if (size < 12 || memcmp(data, "RIFF", 4) ||
+			memcmp(data + 8, "WAVE", 4)) {
+		return -1;
+	}
+
+	fmt = find_chunk(data + 12, data + size, "fmt ", &fmt_size);
+	pcm = find_chunk(data + 12, data + size, "data", &pcm_size);
+	if (!fmt || fmt_size < 16 || !pcm) {
+		return -1;
+	}
+
+	memcpy(&format, fmt, 2);
+	memcpy(&channels, fmt + 2, 2);
+	memcpy(&c->rate, fmt + 4, 4);
+	memcpy(&bits, fmt + 14, 2);
+	if (format != 1 || bits != 16 || !channels) {
+		return -1;
+	}
+
+	c->len = pcm_size / (2 * channels);
+	c->samples = (int16_t *) malloc(c->len * 2 * channels);
+	if (!c->samples) {
+		return -1;
+	}
+	memcpy(c->samples, pcm, c->len * 2 * channels);
+	to_mono(c->samples, c->len, channels);
+	return 0;
+}
+
+/**
+ * decode_vorbis() - Decode entire Ogg Vorbis file
+ * @c: Clip to decode into
+ * @data: Contents of file
+ * @size: Size of file
+ *
+ * Return: Zero on success, negative on failure
+ */
+static int decode_vorbis(clip *c, const uint8_t *data, long size)
+{
+	int channels;
+
+	c->len = stb_vorbis_decode_memory(data, size, &channels,
+			&c->rate, &c->samples);
+	if (c->len <= 0) {
+		return -1;
+	}
+	to_mono(c->samples, c->len, channels);
+	return 0;
+}
+
+int load_sfx(int id, const uint8_t *data, long size)
+{
+	clip *c;
+	int err;
+
+	c = g_clips + id;
+	if (size >= 4 && !memcmp(data, "OggS", 4)) {
+		err = decode_vorbis(c, data, size);
+	} else {
+		err = decode_wav(c, data, size);
+	}
+	if (err < 0) {
+		fprintf(stderr, "sfx: Failed to decode %d\n", id);
+		return -1;
+	}
+
+	__atomic_add_fetch(&g_sfx_bytes, c->len * 2, __ATOMIC_RELAXED);
+	__atomic_store_n(&c->state, CLIP_READY, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/**
+ * queue_clip() - Hand clip to the loader to decode
+ * @id: SFX_* of clip
+ */
+static void queue_clip(int id)
+{
+	g_clips[id].state = CLIP_LOADING;
+	g_sfx_load(id);
+}
+
+void init_sfx(sfx_load_fn *load)
+{
+	int i;
+
+	g_sfx_load = load ? load : no_load;
+	for (i = 0; i < COUNTOF_SFX; i++) {
+		queue_clip(i);
+	}
+}
+
+void end_sfx(void)
+{
+	int i;
+
+	for (i = 0; i < COUNTOF_SFX; i++) {
+		free(g_clips[i].samples);
+		memset(g_clips + i, 0, sizeof(*g_clips));
+	}
+	g_sfx_bytes = 0;
+	g_sfx_load = no_load;
+}
+
+clip *acquire_sfx(int id)
+{
+	clip *c;
+
+	c = g_clips + id;
+	c->used = ++g_sfx_tick;
+	switch (__atomic_load_n(&c->state, __ATOMIC_ACQUIRE)) {
+	case CLIP_EMPTY:
+		queue_clip(id);
+		return NULL;
+	case CLIP_READY:
+		c->refs++;
+		return c;
+	}
+	return NULL;
+}
+
+/**
+ * evict_clip() - Free least recently requested idle clip
+ *
+ * Return: Zero if a clip was evicted, negative if none can be
+ */
+static int evict_clip(void)
+{
+	clip *lru;
+	int i;
+
+	lru = NULL;
+	for (i = 0; i < COUNTOF_SFX; i++) {
+		clip *c;
+
+		c = g_clips + i;
+		if (c->state != CLIP_READY || c->refs > 0) {
+			continue;
+		}
+		if (!lru || c->used - lru->used > UINT32_MAX / 2) {
+			lru = c;
+		}
+	}
+
+	if (!lru) {
+		return -1;
+	}
+	__atomic_sub_fetch(&g_sfx_bytes, lru->len * 2, __ATOMIC_RELAXED);
+	free(lru->samples);
+	lru->samples = NULL;
+	lru->state = CLIP_EMPTY;
+	return 0;
+}
+
+void release_sfx(clip *c)
+{
+	c->refs--;
+	while (g_sfx_bytes > SFX_BUDGET) {
+		if (evict_clip() < 0) {
+			break;
+		}
+	}
+}
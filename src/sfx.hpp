@@ -0,0 +1,87 @@
+#ifndef SFX_HPP
+#define SFX_HPP
+
+#include <stdint.h>
+
+/**
+ * Most bytes of decoded PCM the cache keeps resident
+ */
+#define SFX_BUDGET (1024 * 1024)
+
+/**
+ * clip - Decoded sound effect shared by every voice playing it
+ * @samples: Mono PCM, only valid while ready
+ * @len: Count of samples
+ * @rate: Sample rate of clip
+ * @refs: Count of voices playing clip
+ * @state: CLIP_EMPTY, CLIP_LOADING or CLIP_READY
+ * @used: Tick of last request, least recent is evicted first
+ *
+ * The audio thread moves a clip from empty to loading and
+ * from ready to empty, the loader moves it from loading to ready.
+ * Only the audio thread touches refs and used.
+ */
+struct clip {
+	int16_t *samples;
+	int len;
+	int rate;
+	int refs;
+	int state;
+	uint32_t used;
+};
+
+/**
+ * sfx_load_fn - Start decoding clip, called by audio thread
+ * @id: SFX_* of clip
+ *
+ * Must not block, the clip is decoded by passing its file to
+ * load_sfx() from any thread. Clips never passed stay loading.
+ */
+typedef void sfx_load_fn(int id);
+
+/**
+ * init_sfx() - Queue every clip to be decoded
+ * @load: Loader of clips, NULL to never load any
+ */
+void init_sfx(sfx_load_fn *load);
+
+/**
+ * end_sfx() - Free every clip
+ *
+ * The audio thread and the loader must no longer be using clips.
+ */
+void end_sfx(void);
+
+/**
+ * load_sfx() - Decode file of clip queued by the loader
+ * @id: SFX_* of clip
+ * @data: Contents of WAV or Ogg Vorbis file, copied
+ * @size: Size of file
+ *
+ * Clips that fail to decode are left loading so they are
+ * not queued again.
+ *
+ * Return: Zero on success, negative on failure
+ */
+int load_sfx(int id, const uint8_t *data, long size);
+
+/**
+ * acquire_sfx() - Take reference to clip, audio thread only
+ * @id: SFX_* of clip
+ *
+ * Clips that are not resident are queued to be decoded again.
+ *
+ * Return: Clip, NULL if not resident
+ */
+clip *acquire_sfx(int id);
+
+/**
+ * release_sfx() - Drop reference to clip, audio thread only
+ * @c: Clip to release
+ *
+ * Evicts least recently requested clips no voice is playing 
+ * while the cache is over budget.
+ */
+void release_sfx(clip *c);
+
+#endif
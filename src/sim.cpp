@@ -0,0 +1,33 @@
+#include <math.h>
+
+#include "entity.hpp"
+#include "input.hpp"
+#include "perf.hpp"
+#include "sim.hpp"
+
+void step_sim(int64_t from, int64_t to)
+{
+	g_dt = fminf((to - from) / (float) query_perf_freq(), 0.1F);
+	update_input();
+	update_entities();
+}
+
+void run_sim(int frames, int fps)
+{
+	int64_t step;
+	int64_t stamp;
+	int i;
+
+	step = query_perf_freq() / fps;
+	stamp = 0;
+	for (i = 0; i < frames; i++) {
+		int64_t next;
+
+		poll_input(stamp);
+		while ((next = next_input()) <= stamp) {
+			apply_input(next);
+		}
+		step_sim(stamp - step, stamp);
+		stamp += step;
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef SIM_HPP
+#define SIM_HPP
+
+#include <stdint.h>
+
+/**
+ * step_sim() - Advance simulation between two instants
+ * @from: Performance counter at start of step
+ * @to: Performance counter at end of step
+ */
+void step_sim(int64_t from, int64_t to);
+
+/**
+ * run_sim() - Run simulation as fast as it steps
+ * @frames: Count of frames to step
+ * @fps: Frames per simulated second
+ *
+ * Frames are stamped from zero and each applies the input
+ * queued up to it, so a bot or replay plays the same as it
+ * would in real time. Entities must be started.
+ */
+void run_sim(int frames, int fps);
+
+#endif
@@ -20,12 +20,17 @@
 /**
  * Indicates the maximum number of sprites
  */
-#define COUNTOF_SPR_ALL 64 
+#define COUNTOF_SPR_ALL 1024 
+
+/**
+ * Indicates the maximum number of frames in an animation 
+ */
+#define MAX_ANIM_FRAMES 64
 
 /**
  * Used like NULL is for pointers in g_tile_to_spr.
  */
-#define SPR_INVALID 0xFF
+#define SPR_INVALID 0xFFFF
 
 #define ANIM_CAPTAIN_IDLE 0
 #define ANIM_CAPTAIN_RUN 1
@@ -48,8 +53,8 @@
  * The sprites in animation will be consecutive.
  */
 struct anim {
-	uint8_t start;
-	uint8_t end;
+	uint16_t start;
+	uint16_t end;
 };
 
 extern const char *const g_sprite_paths[COUNTOF_SPR];
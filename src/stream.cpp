@@ -0,0 +1,542 @@
+#include <stdio.h>
+#include <string.h>
+
+#define STB_VORBIS_HEADER_ONLY
+#include <stb_vorbis.c>
+
+#include "audio.hpp"
+#include "mixer.hpp"
+#include "perf.hpp"
+#include "resample.hpp"
+#include "sfx.hpp"
+#include "stream.hpp"
+#include "util.hpp"
+
+ring g_stream_ring;
+
+/**
+ * @g_mixer: Mixer, only touched by stream thread
+ * @g_mus_voices: Voice of each slot, negative if none
+ * @g_mus_cur: Slot of music playing or fading in
+ */
+static mixer g_mixer;
+static int g_mus_voices[2] = {-1, -1};
+static int g_mus_cur;
+
+/**
+ * @g_out_rate: Rate of output, and of frames in ring
+ * @g_out_rs: Converts bus to output rate, table is NULL if rates match
+ * @g_ring_frames: Frames the ring is kept filled to
+ * @g_cut: Music was stopped, drop queued audio instead of playing it
+ */
+static int g_out_rate;
+static resampler g_out_rs;
+static int g_ring_frames;
+static bool g_cut;
+
+/**
+ * @g_voice_clips: Clip each voice is playing, stream thread only
+ * @g_sfx_cmds: Sound effects queued by game thread
+ * @g_sfx_head: Count of sound effects ever queued, game thread only
+ * @g_sfx_tail: Count of sound effects ever started, stream thread only
+ */
+static clip *g_voice_clips[MAX_VOICES];
+static uint8_t g_sfx_cmds[MAX_SFX_CMDS];
+static uint32_t g_sfx_head;
+static uint32_t g_sfx_tail;
+
+/**
+ * @g_mus_qi: The music queued
+ * @g_mus_stamp: Performance counter when music was last queued
+ * @g_fade_ms: Length of cross fade between tracks
+ * @g_fade_curve: FADE_* shape of cross fade
+ */
+static volatile long g_mus_qi = MUS_INVALID;
+static int64_t g_mus_stamp;
+static volatile long g_fade_ms = MUSIC_FADE_MS;
+static volatile long g_fade_curve = FADE_EQUAL_POWER;
+
+/**
+ * @g_tracks: Loop points and blocks of every track
+ * @g_music: Decoders of each track per slot, opened and primed on load
+ * @g_mus_rs: Converts each decoder to MIX_RATE, table is NULL if unused
+ * @g_mus_tracks: Track each slot plays
+ * @g_switch_stamp: Request of track not yet mixed, zero if none
+ */
+static track g_tracks[COUNTOF_MUS];
+static music g_music[COUNTOF_MUS][2];
+static resampler g_mus_rs[COUNTOF_MUS][2];
+static int g_mus_tracks[2];
+static int64_t g_switch_stamp;
+
+/**
+ * Latency of each commit is the count of frames queued ahead
+ * of the newest frame, switch latency is from queue_music()
+ * until the first frame of the track is committed.
+ */
+static int64_t g_lat_sum;
+static int g_lat_max;
+static int g_lat_count;
+static int64_t g_sw_sum;
+static int64_t g_sw_max;
+static int g_sw_count;
+
+int queue_sfx(int id)
+{
+	uint32_t tail;
+
+	tail = __atomic_load_n(&g_sfx_tail, __ATOMIC_ACQUIRE);
+	if (g_sfx_head - tail == MAX_SFX_CMDS) {
+		return -1;
+	}
+	g_sfx_cmds[g_sfx_head & (MAX_SFX_CMDS - 1)] = id;
+	__atomic_store_n(&g_sfx_head, g_sfx_head + 1, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+/**
+ * sfx_pending() - Check if sound effects are waiting to be started
+ */
+static bool sfx_pending(void)
+{
+	return __atomic_load_n(&g_sfx_head, __ATOMIC_SEQ_CST) != g_sfx_tail;
+}
+
+/**
+ * start_sfx_voices() - Start voices for queued sound effects
+ *
+ * Sound effects whose clip is not resident are dropped.
+ */
+static void start_sfx_voices(void)
+{
+	uint32_t head;
+
+	head = __atomic_load_n(&g_sfx_head, __ATOMIC_ACQUIRE);
+	while (g_sfx_tail != head) {
+		clip *c;
+		int v;
+
+		c = acquire_sfx(g_sfx_cmds[g_sfx_tail & (MAX_SFX_CMDS - 1)]);
+		if (c) {
+			v = play_voice(&g_mixer, c->samples, c->len, false);
+			if (v < 0) {
+				release_sfx(c);
+			} else {
+				set_voice(&g_mixer, v, 1.0F, 0.0F,
+						c->rate / (float) MIX_RATE);
+				g_voice_clips[v] = c;
+			}
+		}
+		g_sfx_tail++;
+	}
+	__atomic_store_n(&g_sfx_tail, g_sfx_tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * end_sfx_voices() - Release clips of voices that finished
+ */
+static void end_sfx_voices(void)
+{
+	int i;
+
+	for (i = 0; i < MAX_VOICES; i++) {
+		if (g_voice_clips[i] && !g_mixer.voices[i].active) {
+			release_sfx(g_voice_clips[i]);
+			g_voice_clips[i] = NULL;
+		}
+	}
+}
+
+/**
+ * stop_voices() - Stop every voice
+ */
+static void stop_voices(void)
+{
+	int i;
+
+	for (i = 0; i < MAX_VOICES; i++) {
+		stop_voice(&g_mixer, i);
+	}
+	end_sfx_voices();
+	g_mus_voices[0] = -1;
+	g_mus_voices[1] = -1;
+}
+
+void queue_music(long i)
+{
+	__atomic_store_n(&g_mus_stamp, query_perf_counter(),
+			__ATOMIC_RELAXED);
+	__atomic_store_n(&g_mus_qi, i, __ATOMIC_SEQ_CST);
+}
+
+void set_stream_fade(int ms, int curve)
+{
+	__atomic_store_n(&g_fade_ms, ms, __ATOMIC_RELAXED);
+	__atomic_store_n(&g_fade_curve, curve, __ATOMIC_RELAXED);
+}
+
+bool stream_has_work(void)
+{
+	return __atomic_load_n(&g_mus_qi, __ATOMIC_SEQ_CST) != MUS_INVALID ||
+			sfx_pending();
+}
+
+/**
+ * close_music() - Close decoder, safe if none
+ * @m: Decoder to close
+ */
+static void close_music(music *m)
+{
+	stb_vorbis_close(m->vorb);
+	m->vorb = NULL;
+}
+
+/**
+ * slot_music() - Decoder of slot
+ * @s: Index of slot
+ */
+static music *slot_music(int s)
+{
+	return &g_music[g_mus_tracks[s]][s];
+}
+
+/**
+ * open_music() - Ready slot to play track from the start
+ * @s: Index of slot
+ * @i: MUS_* of track
+ *
+ * Decoders are opened when tracks load, so this only rewinds
+ * to the start block and leaves the seek past it for later.
+ *
+ * Return: Zero on success, negative if the track failed to load
+ */
+static int open_music(int s, long i)
+{
+	music *m;
+
+	m = &g_music[i][s];
+	if (!m->vorb) {
+		fprintf(stderr, "vorbis: Failed to open %ld\n", i);
+		return -1;
+	}
+
+	m->fade_len = 0;
+	m->fade_pos = 0;
+	m->fade_out = false;
+	rewind_music(m);
+	if (g_mus_rs[i][s].table) {
+		reset_resampler(&g_mus_rs[i][s]);
+	}
+	g_mus_tracks[s] = i;
+	return 0;
+}
+
+/**
+ * stream_music() - Start voice of slot
+ * @s: Index of slot
+ *
+ * Return: Index of voice, negative if every voice is busy
+ */
+static int stream_music(int s)
+{
+	resampler *rs;
+
+	rs = &g_mus_rs[g_mus_tracks[s]][s];
+	if (rs->table) {
+		return stream_voice(&g_mixer, read_resampled, rs);
+	}
+	return stream_voice(&g_mixer, read_music, slot_music(s));
+}
+
+/**
+ * update_vorbis() - Start transition to queued music
+ *
+ * The queued track starts on the idle slot and the current
+ * one fades out as it fades in. If the idle slot is still
+ * fading out from an earlier switch it is cut short.
+ */
+static void update_vorbis(void)
+{
+	long i;
+	int next;
+	int ms;
+	int curve;
+
+	i = __atomic_exchange_n(&g_mus_qi, MUS_INVALID, __ATOMIC_SEQ_CST);
+	if (i == MUS_INVALID) {
+		return;
+	}
+
+	if (i == MUS_NONE) {
+		stop_voices();
+		g_cut = true;
+		return;
+	}
+
+	next = !g_mus_cur;
+	if (g_mus_voices[next] >= 0) {
+		stop_voice(&g_mixer, g_mus_voices[next]);
+		g_mus_voices[next] = -1;
+	}
+	if (open_music(next, i) < 0) {
+		return;
+	}
+
+	g_mus_voices[next] = stream_music(next);
+	if (g_mus_voices[g_mus_cur] >= 0) {
+		music *cur;
+
+		/*fades are in samples of each track's own rate*/
+		cur = slot_music(g_mus_cur);
+		ms = __atomic_load_n(&g_fade_ms, __ATOMIC_RELAXED);
+		curve = __atomic_load_n(&g_fade_curve, __ATOMIC_RELAXED);
+		fade_music(cur, false, ms * cur->t->rate / 1000, curve);
+		fade_music(slot_music(next), true,
+				ms * slot_music(next)->t->rate / 1000, curve);
+	}
+	g_mus_cur = next;
+	g_switch_stamp = __atomic_load_n(&g_mus_stamp, __ATOMIC_RELAXED);
+}
+
+/**
+ * end_music_voices() - Stop music that faded out or failed to decode
+ *
+ * Decoders stay open, playing the track again seeks them anew.
+ */
+static void end_music_voices(void)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		int v;
+
+		v = g_mus_voices[i];
+		if (v < 0) {
+			continue;
+		}
+
+		if (!g_mixer.voices[v].active) {
+			fprintf(stderr, "music: Decoding failed\n");
+			g_mus_voices[i] = -1;
+		} else if (music_silent(slot_music(i))) {
+			stop_voice(&g_mixer, v);
+			g_mus_voices[i] = -1;
+		}
+	}
+}
+
+/**
+ * read_mix() - Mix bus for output resampler
+ * @ctx: Unused
+ * @dst: Interleaved stereo frames to fill
+ * @count: Count of frames
+ *
+ * Return: Count of frames, the bus never ends
+ */
+static int read_mix(void *ctx, int16_t *dst, int count)
+{
+	mix_audio(&g_mixer, dst, count);
+	return count;
+}
+
+/**
+ * mix_out() - Mix frames at output rate
+ * @dst: Interleaved stereo frames to fill
+ * @frames: Count of frames
+ */
+static void mix_out(int16_t *dst, int frames)
+{
+	if (g_out_rs.table) {
+		read_resampled(&g_out_rs, dst, frames);
+	} else {
+		mix_audio(&g_mixer, dst, frames);
+	}
+}
+
+/**
+ * fill_out() - Mix frames into ring, then retire voices that ended
+ * @ctx: Unused
+ * @dst: Interleaved stereo frames to fill
+ * @frames: Count of frames
+ */
+static void fill_out(void *ctx, int16_t *dst, int frames)
+{
+	mix_out(dst, frames);
+	end_sfx_voices();
+	end_music_voices();
+}
+
+int init_stream(int out_rate, int ring_frames)
+{
+	g_out_rate = out_rate;
+	g_ring_frames = ring_frames;
+	if (init_ring(&g_stream_ring, ring_frames) < 0) {
+		return -1;
+	}
+	if (out_rate != MIX_RATE && init_resampler(&g_out_rs, MIX_RATE,
+			out_rate, 2, read_mix, NULL) < 0) {
+		destroy_ring(&g_stream_ring);
+		return -1;
+	}
+	init_mixer(&g_mixer);
+	return 0;
+}
+
+/**
+ * close_track() - Close decoders of track and free its blocks
+ * @i: MUS_* of track
+ */
+static void close_track(int i)
+{
+	int s;
+
+	for (s = 0; s < 2; s++) {
+		close_music(&g_music[i][s]);
+		destroy_resampler(&g_mus_rs[i][s]);
+	}
+	destroy_track(g_tracks + i);
+}
+
+void end_stream(void)
+{
+	int i;
+
+	destroy_resampler(&g_out_rs);
+	for (i = 0; i < COUNTOF_MUS; i++) {
+		close_track(i);
+	}
+	destroy_ring(&g_stream_ring);
+}
+
+int load_stream_track(int i, const uint8_t *data, size_t size)
+{
+	track *t;
+	int err;
+	int s;
+
+	t = g_tracks + i;
+	for (s = 0; s < 2; s++) {
+		g_music[i][s].vorb = stb_vorbis_open_memory(data, size,
+				&err, NULL);
+		if (!g_music[i][s].vorb) {
+			goto close;
+		}
+		g_music[i][s].t = t;
+	}
+	if (init_track(t, g_music[i][0].vorb) < 0) {
+		goto close;
+	}
+
+	/*seek past the start block now, switching then decodes nothing*/
+	for (s = 0; s < 2; s++) {
+		rewind_music(&g_music[i][s]);
+		if (prepare_music(&g_music[i][s]) < 0) {
+			goto close;
+		}
+		if (t->rate != MIX_RATE && init_resampler(&g_mus_rs[i][s],
+				t->rate, MIX_RATE, 1, read_music,
+				&g_music[i][s]) < 0) {
+			goto close;
+		}
+	}
+	return 0;
+close:
+	close_track(i);
+	return -1;
+}
+
+int update_stream(void)
+{
+	update_vorbis();
+	start_sfx_voices();
+	return count_voices(&g_mixer);
+}
+
+int fill_stream(void)
+{
+	int ahead;
+	int i;
+	int s;
+
+	if (!fill_ring(&g_stream_ring, g_ring_frames, fill_out, NULL)) {
+		/*seeks left by looping cost nothing while ahead*/
+		for (i = 0; i < COUNTOF_MUS; i++) {
+			for (s = 0; s < 2; s++) {
+				if (g_music[i][s].vorb) {
+					prepare_music(&g_music[i][s]);
+				}
+			}
+		}
+		return 0;
+	}
+
+	if (g_switch_stamp) {
+		int64_t sw;
+
+		sw = query_perf_counter() - g_switch_stamp;
+		g_sw_sum += sw;
+		if (sw > g_sw_max) {
+			g_sw_max = sw;
+		}
+		g_sw_count++;
+		g_switch_stamp = 0;
+	}
+
+	ahead = ring_count(&g_stream_ring);
+	g_lat_sum += ahead;
+	g_lat_max = max(g_lat_max, ahead);
+	g_lat_count++;
+	return ahead;
+}
+
+bool drain_stream(void)
+{
+	int16_t *dst;
+	int n;
+
+	/*once every voice has ended the bus is silent, so pulling
+	what the filter still holds only adds the tail of the mix*/
+	if (g_cut) {
+		return false;
+	}
+	if (g_out_rs.table) {
+		dst = ring_write_ptr(&g_stream_ring, &n);
+		n = min(n, (RS_BLOCK + RS_TAPS) * g_out_rate / MIX_RATE);
+		mix_out(dst, n);
+		commit_ring(&g_stream_ring, n);
+	}
+	return true;
+}
+
+void reset_stream(long underruns)
+{
+	stop_voices();
+	reset_ring(&g_stream_ring);
+	if (g_out_rs.table) {
+		reset_resampler(&g_out_rs);
+	}
+	g_cut = false;
+
+	if (g_lat_count) {
+		fprintf(stderr, "audio: %ld underruns, latency avg %.1f ms, "
+				"max %.1f ms, ring %d ms\n", underruns,
+				1000.0 * g_lat_sum / g_lat_count / g_out_rate,
+				1000.0 * g_lat_max / g_out_rate,
+				1000 * g_ring_frames / g_out_rate);
+	}
+	if (g_sw_count) {
+		int64_t freq;
+
+		freq = query_perf_freq();
+		fprintf(stderr, "music: %d switches, latency avg %.2f ms, "
+				"max %.2f ms\n", g_sw_count,
+				1000.0 * g_sw_sum / g_sw_count / freq,
+				1000.0 * g_sw_max / freq);
+	}
+	g_lat_sum = 0;
+	g_lat_max = 0;
+	g_lat_count = 0;
+	g_sw_sum = 0;
+	g_sw_max = 0;
+	g_sw_count = 0;
+}
@@ -0,0 +1,120 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ring.hpp"
+
+/**
+ * @MUS_INVALID: Their is no music in queue
+ * @MUS_NONE: No music playing
+ */
+#define MUS_INVALID -2
+#define MUS_NONE -1
+
+/**
+ * Most sound effects waiting to be started, a power of two
+ */
+#define MAX_SFX_CMDS 64
+
+/**
+ * g_stream_ring - Mixed audio waiting to be played
+ *
+ * The stream is its producer, the output backend its consumer.
+ */
+extern ring g_stream_ring;
+
+/**
+ * init_stream() - Ready mixer, ring and output resampler
+ * @out_rate: Rate of output, the bus is resampled to it
+ * @ring_frames: Frames the ring is kept filled to
+ *
+ * The stream is device independent, a backend starts it,
+ * drains g_stream_ring and waits while it is full.
+ *
+ * Return: Zero on success, negative on failure
+ */
+int init_stream(int out_rate, int ring_frames);
+
+/**
+ * end_stream() - Free decoders, tracks, ring and resamplers
+ */
+void end_stream(void);
+
+/**
+ * load_stream_track() - Decode blocks of track and prime its decoders
+ * @i: MUS_* of track
+ * @data: Contents of file, kept until end_stream()
+ * @size: Size of file in bytes
+ *
+ * Every slot gets its own decoder of the track, left past the
+ * start block, so switching to it neither opens nor seeks.
+ * Tracks that fail to load only fail when played.
+ *
+ * Return: Zero on success, negative on failure
+ */
+int load_stream_track(int i, const uint8_t *data, size_t size);
+
+/**
+ * queue_music() - Queue switch to track
+ * @i: MUS_* of track, MUS_NONE to cut music and sound effects
+ *
+ * Safe to call from any thread.
+ */
+void queue_music(long i);
+
+/**
+ * set_stream_fade() - Set cross fade used by later switches
+ * @ms: Length of cross fade in milliseconds
+ * @curve: FADE_* shape of cross fade
+ */
+void set_stream_fade(int ms, int curve);
+
+/**
+ * queue_sfx() - Queue sound effect, single producer
+ * @id: SFX_* to play
+ *
+ * Return: Zero if queued, negative if too many are queued
+ */
+int queue_sfx(int id);
+
+/**
+ * stream_has_work() - Check if music or sound effects are queued
+ */
+bool stream_has_work(void);
+
+/**
+ * update_stream() - Start queued music and sound effects
+ *
+ * Return: Count of voices playing, zero once everything ended
+ */
+int update_stream(void);
+
+/**
+ * fill_stream() - Top up ring and retire voices that ended
+ *
+ * If the ring is full, seeks left by looping are done while
+ * the stream is ahead.
+ *
+ * Return: Count of frames mixed, zero if the ring was full
+ */
+int fill_stream(void);
+
+/**
+ * drain_stream() - Push frames held by output resampler into ring
+ *
+ * Return: True unless music was cut, which skips playing out
+ */
+bool drain_stream(void);
+
+/**
+ * reset_stream() - Stop every voice and empty ring
+ * @underruns: Passes the output could not cover, for the summary
+ *
+ * Prints latency of commits and of switches to standard error.
+ * The consumer must no longer be reading the ring.
+ */
+void reset_stream(long underruns);
+
+#endif
@@ -1,13 +1,22 @@
+#include <stdio.h>
+
 #include "util.hpp"
+#ifdef _WIN32
 #include "render.hpp"
+#endif
 
 void fatal_crt_err(void)
 {
+#ifdef _WIN32
 	wchar_t buf[1024];
 
 	_wcserror_s(buf, _countof(buf), errno);
 	MessageBoxW(g_wnd, buf, L"CRT Fatal Error", MB_OK); 
 	ExitProcess(1);
+#else
+	perror("CRT Fatal Error");
+	exit(1);
+#endif
 }
 
 void *xmalloc(size_t size)
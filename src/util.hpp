@@ -78,14 +78,15 @@ inline int min(int a, int b)
  */
 inline int max(int a, int b)
 {
-	return a < b ? a : b;
+	return a > b ? a : b;
 }
 
 /**
  * fatal_crt_error() - Display message box with CRT error and exit 
  *
  * This function is used if a C-Runtime (CRT) function fails with
- * a unrecoverable error. 
+ * a unrecoverable error. Outside of Windows the error is printed
+ * to standard error instead.
  */
 void fatal_crt_err(void);
 
@@ -0,0 +1,133 @@
+#include <string.h>
+
+#include "util.hpp"
+#include "wav-out.hpp"
+
+#define SILENCE_LEN 256
+
+/**
+ * wav_header - Canonical 44 byte header of PCM WAV file
+ */
+struct wav_header {
+	char riff[4];
+	uint32_t riff_size;
+	char wave[4];
+	char fmt[4];
+	uint32_t fmt_size;
+	uint16_t format;
+	uint16_t channels;
+	uint32_t rate;
+	uint32_t byte_rate;
+	uint16_t block_align;
+	uint16_t bits;
+	char data[4];
+	uint32_t data_size;
+};
+
+static int16_t g_silence[SILENCE_LEN * 2];
+
+/**
+ * write_header() - Write header for frames written so far
+ * @w: Backend
+ *
+ * Return: Zero on success, negative on failure
+ */
+static int write_header(wav_out *w)
+{
+	wav_header h;
+
+	memcpy(h.riff, "RIFF", 4);
+	h.riff_size = sizeof(h) - 8 + w->frames * 4;
+	memcpy(h.wave, "WAVE", 4);
+	memcpy(h.fmt, "fmt ", 4);
+	h.fmt_size = 16;
+	h.format = 1;
+	h.channels = 2;
+	h.rate = w->rate;
+	h.byte_rate = w->rate * 4;
+	h.block_align = 4;
+	h.bits = 16;
+	memcpy(h.data, "data", 4);
+	h.data_size = w->frames * 4;
+
+	if (fseek(w->f, 0, SEEK_SET) < 0) {
+		return -1;
+	}
+	return fwrite(&h, sizeof(h), 1, w->f) == 1 ? 0 : -1;
+}
+
+int open_wav_out(wav_out *w, const char *path, int rate)
+{
+	w->rate = rate;
+	w->frames = 0;
+	w->underruns = 0;
+	w->f = NULL;
+	if (!path) {
+		return 0;
+	}
+
+	w->f = fopen(path, "wb");
+	if (!w->f) {
+		fprintf(stderr, "wav: Failed to open %s\n", path);
+		return -1;
+	}
+
+	if (write_header(w) < 0) {
+		fclose(w->f);
+		w->f = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+int write_wav_out(wav_out *w, const int16_t *pcm, int frames)
+{
+	if (w->f && fwrite(pcm, 4, frames, w->f) != (size_t) frames) {
+		return -1;
+	}
+	w->frames += frames;
+	return 0;
+}
+
+int pull_wav_out(wav_out *w, ring *r, int frames)
+{
+	int missing;
+
+	while (frames > 0) {
+		const int16_t *pcm;
+		int n;
+
+		pcm = ring_read_ptr(r, r->read, &n);
+		if (!n) {
+			break;
+		}
+		n = min(n, frames);
+		write_wav_out(w, pcm, n);
+		release_ring(r, n);
+		frames -= n;
+	}
+
+	missing = frames;
+	if (missing > 0) {
+		w->underruns++;
+	}
+	while (frames > 0) {
+		int n;
+
+		n = min(frames, SILENCE_LEN);
+		write_wav_out(w, g_silence, n);
+		frames -= n;
+	}
+	return missing;
+}
+
+void close_wav_out(wav_out *w)
+{
+	if (w->f) {
+		if (write_header(w) < 0) {
+			fprintf(stderr, "wav: Failed to write header\n");
+		}
+		fclose(w->f);
+		w->f = NULL;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef WAV_OUT_HPP
+#define WAV_OUT_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include "ring.hpp"
+
+/**
+ * wav_out - Output backend writing mixed audio to a WAV file 
+ * @f: File written to, NULL if output is discarded
+ * @rate: Sample rate
+ * @frames: Count of frames written
+ * @underruns: Passes pull_wav_out() could not cover
+ *
+ * With no file this is the null backend, frames are only counted.
+ */
+struct wav_out {
+	FILE *f;
+	int rate;
+	long frames;
+	int underruns;
+};
+
+/**
+ * open_wav_out() - Start writing stereo 16 bit WAV
+ * @w: Backend to open
+ * @path: Path of file, NULL to discard output
+ * @rate: Sample rate
+ *
+ * Return: Zero on success, negative on failure
+ */
+int open_wav_out(wav_out *w, const char *path, int rate);
+
+/**
+ * write_wav_out() - Write interleaved stereo PCM
+ * @w: Backend to write to
+ * @pcm: Samples to write
+ * @frames: Count of frames
+ *
+ * Return: Zero on success, negative on failure
+ */
+int write_wav_out(wav_out *w, const int16_t *pcm, int frames);
+
+/**
+ * pull_wav_out() - Play a pass of frames from ring as a device would
+ * @w: Backend to write to
+ * @r: Ring to drain, as its consumer
+ * @frames: Count of frames played by pass
+ *
+ * Stands in for the device callback on a simulated clock, where
+ * the caller decides how much time each pass covers. Frames the 
+ * ring is missing are played as silence.
+ *
+ * Return: Count of frames missing, zero if pass was covered
+ */
+int pull_wav_out(wav_out *w, ring *r, int frames);
+
+/**
+ * close_wav_out() - Finish header and close file
+ * @w: Backend to close
+ */
+void close_wav_out(wav_out *w);
+
+#endif
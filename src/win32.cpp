@@ -3,6 +3,9 @@
 
 #include "win32.hpp"
 
+typedef BOOL WINAPI prefetch_virtual_memory_fn(HANDLE, ULONG_PTR,
+		void *, ULONG);
+
 static wchar_t g_res_path[MAX_PATH];
 
 HMODULE load_procs(const char *path, 
@@ -81,3 +84,68 @@ void get_res_pathf(wchar_t *dst, const wchar_t *fmt, ...)
 	
 	get_res_path(dst, src);
 }
+
+int map_file(mapped_file *mf, const wchar_t *path)
+{
+	HANDLE file;
+	HANDLE map;
+	LARGE_INTEGER size;
+
+	mf->data = NULL;
+	mf->size = 0;
+	file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return -1;
+	}
+
+	map = NULL;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+			size.QuadPart > INT32_MAX) {
+		goto close_file;
+	}
+
+	map = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!map) {
+		goto close_file;
+	}
+
+	/*the view keeps the file open after both handles are closed*/
+	mf->data = (const uint8_t *) MapViewOfFile(map, FILE_MAP_READ,
+			0, 0, 0);
+	if (mf->data) {
+		mf->size = size.QuadPart;
+	}
+	CloseHandle(map);
+close_file:
+	CloseHandle(file);
+	return mf->data ? 0 : -1;
+}
+
+void prefetch_file(const mapped_file *mf)
+{
+	struct {
+		void *addr;
+		size_t size;
+	} range;
+
+	prefetch_virtual_memory_fn *prefetch;
+
+	prefetch = (prefetch_virtual_memory_fn *) GetProcAddress(
+			GetModuleHandleW(L"kernel32.dll"),
+			"PrefetchVirtualMemory");
+	if (prefetch && mf->data) {
+		range.addr = (void *) mf->data;
+		range.size = mf->size;
+		prefetch(GetCurrentProcess(), 1, &range, 0);
+	}
+}
+
+void unmap_file(mapped_file *mf)
+{
+	if (mf->data) {
+		UnmapViewOfFile(mf->data);
+		mf->data = NULL;
+		mf->size = 0;
+	}
+}
@@ -1,8 +1,19 @@
 #ifndef WIN32_HPP
 #define WIN32_HPP
 
+#include <stdint.h>
 #include <windows.h>
 
+/**
+ * mapped_file - Read only view of an entire file
+ * @data: Start of view, page aligned, NULL if not mapped
+ * @size: Size of file in bytes
+ */
+struct mapped_file {
+	const uint8_t *data;
+	size_t size;
+};
+
 /**
  * err_wnd() - Show generic error message box
  * @parent: Parent window 
@@ -62,4 +73,31 @@ HMODULE load_procs(const char *path, const char *const *names, FARPROC *procs);
 HMODULE load_procs_ver(const char *const *paths, 
 		const char *const *names, FARPROC *procs); 
 
+/**
+ * map_file() - Map entire file read only
+ * @mf: Mapping to initialize
+ * @path: Path to file
+ *
+ * Pages are read in as they are first touched, reading
+ * through the view needs no system calls.
+ *
+ * Return: Zero on success, negative on failure
+ */
+int map_file(mapped_file *mf, const wchar_t *path);
+
+/**
+ * prefetch_file() - Hint that mapped file will be read soon
+ * @mf: Mapped file
+ *
+ * Returns without waiting for the read. Does nothing before
+ * Windows 8, where faults still read ahead of the page touched.
+ */
+void prefetch_file(const mapped_file *mf);
+
+/**
+ * unmap_file() - Unmap file, safe to call if never mapped
+ * @mf: Mapping to free
+ */
+void unmap_file(mapped_file *mf);
+
 #endif